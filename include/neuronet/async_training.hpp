@@ -0,0 +1,96 @@
+#ifndef NN_ASYNC_TRAINING_H
+#define NN_ASYNC_TRAINING_H
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+namespace utility {
+	class TrainingData;
+}
+
+namespace neuronet {
+	class NeuralNet;
+
+	//========================================================
+	// Snapshot of the progress of an asynchronous training.
+	//
+	// epoch                - current epoch, starting at zero.
+	// passes_done          - passes trained over all epochs.
+	// passes_total         - passes of all epochs.
+	// recent_average_error - of the trained net.
+	// passes_per_second    - since the training started.
+	//========================================================
+	struct TrainingProgress {
+		size_t epoch                = 0;
+		size_t passes_done          = 0;
+		size_t passes_total         = 0;
+		double recent_average_error = 0.0;
+		double passes_per_second    = 0.0;
+	};
+
+	//========================================================
+	// Options of an asynchronous training.
+	//
+	// epochs            - passes over the whole data set.
+	// progress_interval - passes between updates of the
+	//                     progress snapshot; the hot loop only
+	//                     counts passes in between.
+	// on_progress       - called on the training thread with
+	//                     every updated snapshot if set.
+	//========================================================
+	struct TrainingOptions {
+		size_t epochs            = 1;
+		size_t progress_interval = 64;
+		std::function<void(const TrainingProgress &)> on_progress;
+	};
+
+	//========================================================
+	// Handle of a training running on its own thread that was
+	// started by NeuralNet::trainAsync.
+	//
+	// The net and the data set must outlive the training and
+	// must not be used by others until it completed.
+	// Destroying the handle cancels the training and waits for
+	// its completion.
+	// Moving a handle hands the training over: the moved-from
+	// handle ignores cancel, reports neither a cancellation
+	// nor any progress and has an invalid completion future.
+	//========================================================
+	class TrainingHandle {
+	public:
+		TrainingHandle(NeuralNet & net, const utility::TrainingData & data, TrainingOptions options);
+		~TrainingHandle();
+
+		TrainingHandle(TrainingHandle &&);
+		TrainingHandle & operator=(TrainingHandle &&) = delete;
+		TrainingHandle(const TrainingHandle &) = delete;
+		TrainingHandle & operator=(const TrainingHandle &) = delete;
+
+		// Becomes ready with the final progress once the training
+		// completed or was cancelled, or with the exception that
+		// aborted it.
+		auto completion() const -> std::shared_future<TrainingProgress>;
+
+		// Requests the training to stop after the current pass.
+		void cancel() noexcept;
+		bool isCancelled() const noexcept;
+
+		// Returns the latest progress snapshot without locking
+		// and without waiting for the training thread.
+		auto progress() const noexcept -> TrainingProgress;
+
+	private:
+		struct State;
+
+		std::unique_ptr<State> m_state;
+		std::shared_future<TrainingProgress> m_completion;
+		std::thread m_thread;
+	};
+}
+
+#endif
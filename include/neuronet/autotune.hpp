@@ -0,0 +1,94 @@
+#ifndef NN_AUTOTUNE_H
+#define NN_AUTOTUNE_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+
+#include "neuronet/neural_layer.hpp"
+#include "neuronet/kernels.hpp"
+
+namespace neuronet {
+	class NeuralNet;
+
+	//========================================================
+	// Options of the autotuner.
+	//
+	// workload    - the operation that is timed:
+	//     training  - feedForward followed by backPropagation.
+	//     inference - feedForward of a single sample.
+	//     batch     - feedForwardBatch of batch_size samples.
+	// batch_size  - samples per call of the batch workload.
+	// min_seconds - every candidate is run repeatedly for at
+	//               least this long per round; the fastest of
+	//               rounds rounds counts.
+	// cache_path  - file of earlier results keyed by cpu model,
+	//               topology, convolutions, pool size and
+	//               workload; tuning is skipped for keys found
+	//               in it and new results are added to it.
+	//               Empty disables the cache.
+	//========================================================
+	struct AutotuneOptions {
+		enum class Workload {
+			training,
+			inference,
+			batch
+		};
+
+		Workload    workload    = Workload::training;
+		size_t      batch_size  = 64;
+		double      min_seconds = 0.002;
+		size_t      rounds      = 3;
+		std::string cache_path  = "neuronet.tune";
+	};
+
+	//========================================================
+	// Configuration of a single layer chosen by the tuner and
+	// the time per call of the workload it was measured with;
+	// the time is zero for configurations read from the cache.
+	//========================================================
+	struct LayerTuning {
+		NeuralLayer::Engine engine   = NeuralLayer::Engine::reference;
+		kernels::Blocking   blocking;
+		size_t              threads  = 1;
+		double              seconds  = 0.0;
+	};
+
+	//========================================================
+	// Outcome of the autotuner: one tuning per layer starting
+	// with the first hidden layer.
+	//========================================================
+	struct AutotuneResult {
+		std::string cpu_model;
+		std::vector<uint64_t> topology;
+		std::vector<LayerTuning> layers;
+		size_t count_candidates = 0;
+		bool   from_cache       = false;
+		bool   cache_written    = false;
+	};
+
+	// Model name of the cpu as found in /proc/cpuinfo.
+	auto cpuModel() -> std::string;
+
+	//========================================================
+	// Chooses the engine, block sizes and number of workers
+	// of every layer of the given neural net by timing the
+	// candidates on a scratch net of the same topology using
+	// the same worker pool, so the weights and the state of
+	// the given net are left alone, and applies the fastest.
+	//
+	// Layers are tuned one after another from the first
+	// hidden layer on, each with the layers before it at
+	// their chosen and the layers after it at their current
+	// configuration. Only the blocked engine can use more
+	// than one worker, and only if the net has a pool.
+	//========================================================
+	auto autotune(NeuralNet & net, const AutotuneOptions & options = AutotuneOptions{})
+		-> AutotuneResult;
+
+	auto operator<<(std::ostream & os, const AutotuneResult & result) -> std::ostream &;
+}
+
+#endif
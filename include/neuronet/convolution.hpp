@@ -0,0 +1,89 @@
+#ifndef NN_CONVOLUTION_H
+#define NN_CONVOLUTION_H
+
+#include <cstddef>
+#include <ostream>
+
+namespace neuronet {
+	//========================================================
+	// Shape of a convolutional layer for image-like inputs.
+	//
+	// layer          - index of the layer within the neural
+	//                  net, the input layer having index 0.
+	// input_*        - the outputs of the previous layer read
+	//                  as input_channels planes of input_height
+	//                  rows of input_width values each.
+	// channels       - number of kernels, i.e. of planes of
+	//                  outputs of this layer.
+	// kernel_*       - extent of every kernel; each spans all
+	//                  input channels.
+	// stride_*       - distance between two neighbouring
+	//                  positions of a kernel.
+	// padding_*      - zeros added around every input plane.
+	//
+	// A 1D convolution has a height of one for the inputs and
+	// the kernels and no padding of the height.
+	// Both the inputs and the outputs are stored plane after
+	// plane, row after row, so output (c, y, x) is the neuron
+	// (c * outputHeight() + y) * outputWidth() + x.
+	//========================================================
+	struct Convolution {
+		size_t layer          = 1;
+		size_t input_channels = 1;
+		size_t input_height   = 1;
+		size_t input_width    = 1;
+		size_t channels       = 1;
+		size_t kernel_height  = 1;
+		size_t kernel_width   = 1;
+		size_t stride_height  = 1;
+		size_t stride_width   = 1;
+		size_t padding_height = 0;
+		size_t padding_width  = 0;
+
+		auto outputHeight() const -> size_t;
+		auto outputWidth() const -> size_t;
+
+		// Outputs of the previous layer read by this layer and
+		// outputs of this layer.
+		auto countInputs() const -> size_t;
+		auto countOutputs() const -> size_t;
+
+		// Weights of a kernel without its bias.
+		auto countKernelWeights() const -> size_t;
+
+		// Throws an exception if a dimension is zero or the
+		// kernel doesn't fit into the padded input.
+		void validate() const;
+	};
+
+	// Writes the fields of the convolution separated by
+	// spaces, in the order of declaration.
+	auto operator<<(std::ostream & os, const Convolution & convolution) -> std::ostream &;
+
+	//========================================================
+	// Lowers the receptive fields of the kernel positions of a
+	// convolution into the columns of a matrix, so that the
+	// convolution becomes one matrix product with the kernels.
+	//
+	// inputs stores the inputs of batchSize samples neuron
+	// after neuron with the values of all samples next to
+	// each other. columns is a countKernelWeights() x
+	// (outputHeight() * outputWidth() * batchSize) matrix whose
+	// column p * batchSize + s holds the inputs of sample s
+	// seen by the kernel at position p; zero where it covers
+	// the padding.
+	//========================================================
+	void im2col(
+		const Convolution & convolution,
+		const double * inputs, size_t batchSize,
+		double * columns);
+
+	// Adds every entry of the given columns to the input it
+	// was lowered from by im2col, the inverse scatter.
+	void col2im(
+		const Convolution & convolution,
+		const double * columns, size_t batchSize,
+		double * inputs);
+}
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef NN_DIFFERENTIAL_CHECK_H
+#define NN_DIFFERENTIAL_CHECK_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+
+namespace neuronet {
+	//========================================================
+	// Options of the differential check comparing the
+	// optimized paths of NeuralNet against the reference
+	// engine (every neuron walking its own connections).
+	//
+	// seed        - master seed; every case derives its own
+	//               seed from it which is reported on failure.
+	// cases       - number of random topologies per variant.
+	// passes      - training passes per topology; training on
+	//               random targets amplifies rounding differences
+	//               exponentially, so more passes need looser
+	//               tolerances.
+	// max_layers  - upper bound of the layers of a topology.
+	// max_width   - upper bound of the neurons of a layer.
+	// batch_size  - samples of the final batched comparison.
+	//
+	// Two values agree if they are at most max_ulps apart,
+	// or within relative_tolerance of the largest magnitude
+	// of the compared vector (outputs, gradients or weights
+	// of a layer),
+	// or within absolute_tolerance for values close to zero.
+	//========================================================
+	struct DifferentialOptions {
+		uint64_t seed               = 1;
+		size_t   cases              = 20;
+		size_t   passes             = 10;
+		size_t   max_layers         = 5;
+		size_t   max_width          = 48;
+		size_t   batch_size         = 7;
+		uint64_t max_ulps           = 64;
+		double   relative_tolerance = 1.0e-9;
+		double   absolute_tolerance = 0.0;
+	};
+
+	//========================================================
+	// Outcome of the differential check. On failure it
+	// describes the first mismatch; rerunning with seed set
+	// to case_seed and cases set to 1 reproduces it.
+	//========================================================
+	struct DifferentialResult {
+		bool     passed        = true;
+		size_t   count_checked = 0;
+		double   max_relative_error = 0.0;
+
+		std::string variant;
+		uint64_t    case_seed = 0;
+		std::vector<uint64_t> topology;
+		std::string quantity;
+		size_t      pass  = 0;
+		size_t      index = 0;
+		double      reference = 0.0;
+		double      optimized = 0.0;
+	};
+
+	// Runs randomized topologies and data through the reference
+	// engine and every optimized variant, comparing outputs,
+	// gradients and updated weights after every pass.
+	// Variants with fp16 or bf16 weights only feed forward and
+	// are compared with tolerances of their precision.
+	// Random convolutional nets, which the reference engine
+	// doesn't cover, are checked against central differences
+	// of their error and against their batched forward pass.
+	// Pruned nets must match a dense net of the weights they
+	// kept.
+	// Every reduction of an ensemble must match the forward
+	// passes of its members, and a pipeline must return the
+	// outputs of the batched forward pass in push order.
+	// A result cache must return the outputs of a fresh
+	// forward pass and drop results once training changed
+	// the weights.
+	// Progress is written to log if it is not null.
+	auto runDifferentialCheck(const DifferentialOptions & options, std::ostream * log)
+		-> DifferentialResult;
+
+	auto operator<<(std::ostream & out, const DifferentialResult & result) -> std::ostream &;
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef NN_ENSEMBLE_H
+#define NN_ENSEMBLE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace neuronet {
+	class NeuralNet;
+
+	//========================================================
+	// An inference only ensemble of neural nets of identical
+	// topology that evaluates all members with one call.
+	//
+	// The weights of every layer of all members are stacked
+	// into one matrix, member after member. The first layer
+	// of all members is computed by a single matrix vector
+	// product over the shared input, so the input is read
+	// once for the whole ensemble; deeper layers run one
+	// product per member on the stacked weights.
+	//
+	// The weights are copied on construction; later changes
+	// of the members are not seen by the ensemble.
+	//========================================================
+	class Ensemble {
+	public:
+		//========================================================
+		// Determines how the outputs of the members are combined.
+		//
+		// none - the outputs of all members one after another.
+		// mean - the average output of the members.
+		// vote - the share of members for every output of which
+		//        it is the biggest output of the member.
+		//========================================================
+		enum class Reduction {
+			none,
+			mean,
+			vote
+		};
+
+		// Throws std::invalid_argument if no members are given,
+		// their topologies differ or they have convolutional
+		// layers.
+		explicit Ensemble(const std::vector<const NeuralNet *> & members);
+
+		// Evaluates all members for the given input values and
+		// writes countOutputs(reduction) values to outputValues.
+		void predict(
+			const double * inputValues, size_t count,
+			Reduction reduction, double * outputValues);
+		auto predict(const std::vector<double> & inputValues, Reduction reduction)
+			-> std::vector<double>;
+
+		auto countMembers() const -> size_t;
+		auto countOutputs(Reduction reduction) const -> size_t;
+		auto getTopology() const -> const std::vector<uint64_t> &;
+
+	private:
+		std::vector<uint64_t> m_topology;
+		size_t                m_count_members;
+		// Stride between the activations of two members.
+		size_t                m_stride;
+		// Stacked weight matrix per layer except the input layer:
+		// rows of all neurons of all members, columns of all
+		// neurons of the previous layer followed by the bias.
+		std::vector<std::vector<double>> m_weights;
+		// The input values followed by the bias output.
+		std::vector<double>   m_input;
+		// Activations of every member followed by its bias output.
+		std::vector<double>   m_activations;
+		std::vector<double>   m_sums;
+	};
+}
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef NN_EVALUATION_H
+#define NN_EVALUATION_H
+
+#include <vector>
+#include <ostream>
+#include <cstddef>
+
+namespace neuronet {
+	//========================================================
+	// Options of NeuralNet::evaluate.
+	//
+	// batch_size - passes computed by one batched forward
+	//              pass. The data set is split into batches
+	//              of this size whatever the number of
+	//              workers, so results only depend on it.
+	// confusion  - counts the predicted class of every pass
+	//              against its expected class: the output
+	//              with the largest value, or for a single
+	//              output whether it exceeds threshold.
+	// threshold  - see confusion.
+	//========================================================
+	struct EvaluationOptions {
+		size_t batch_size = 256;
+		bool   confusion  = false;
+		double threshold  = 0.0;
+	};
+
+	//========================================================
+	// Result of NeuralNet::evaluate.
+	//
+	// passes          - passes evaluated.
+	// rms_error       - root mean square error over all
+	//                   outputs of all passes.
+	// mean_pass_error - mean of the errors of the passes as
+	//                   backPropagation computes them, i.e.
+	//                   comparable to the recent average
+	//                   error of the training.
+	// output_errors   - root mean square error per output.
+	// classes         - number of classes if confusion was
+	//                   requested, zero otherwise: the number
+	//                   of outputs, or two for one output.
+	// confusion       - classes x classes counts, row major:
+	//                   expected class by predicted class.
+	// correct         - passes on the diagonal of confusion.
+	//========================================================
+	struct EvaluationResult {
+		size_t              passes          = 0;
+		double              rms_error       = 0.0;
+		double              mean_pass_error = 0.0;
+		std::vector<double> output_errors;
+		size_t              classes         = 0;
+		std::vector<size_t> confusion;
+		size_t              correct         = 0;
+
+		// Share of correctly classified passes.
+		auto accuracy() const -> double;
+	};
+
+	auto operator<<(std::ostream & os, const EvaluationResult & result) -> std::ostream &;
+}
+
+#endif
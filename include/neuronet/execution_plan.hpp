@@ -0,0 +1,98 @@
+#ifndef NN_EXECUTION_PLAN_H
+#define NN_EXECUTION_PLAN_H
+
+#include <vector>
+#include <cstddef>
+
+#include "neuronet/memory_usage.hpp"
+
+namespace neuronet {
+	class NeuralNet;
+	class NeuralLayer;
+
+	//========================================================
+	// The object graph of a neural net lowered into a linear
+	// sequence of dense ops, one per layer after the input
+	// layer, created by NeuralNet::compile.
+	//
+	// The forward op of a layer computes
+	//     y = f(W x + b)
+	// in one pass over its weight matrix, where the bias b is
+	// the last column of the matrix and added together with
+	// the activation instead of being read as one more input
+	// of the dot products. The backward op of a layer
+	// computes the gradients of the previous layer from the
+	// columns of W only and updates W and b with momentum.
+	// The connections of the bias to the input layer, which
+	// never carry a value, are not part of the plan.
+	//
+	// The ops work on the weight matrices of the layers in
+	// place and on activation and gradient buffers allocated
+	// once by the constructor, so a pass allocates nothing
+	// and never walks neurons or connections. They follow
+	// the training rate, momentum, block sizes and workers
+	// of their layers.
+	//========================================================
+	class ExecutionPlan {
+	public:
+		// Lowers the given layers of the given neural net.
+		ExecutionPlan(const NeuralNet & net, std::vector<NeuralLayer> & layers);
+
+		//========================================================
+		// A pass split into the steps NeuralNet profiles one by
+		// one.
+		//
+		// A forward pass sets the input values and then runs the
+		// forward op of every layer in order, op l - 1 computing
+		// the activations of layer l.
+		// A backward pass computes the gradients of the output
+		// layer from the latest activations and the given target
+		// values, then those of the hidden layers, and finally
+		// updates the weights with them.
+		//========================================================
+		void setInputs(const double * inputValues);
+		void feedForward(size_t op);
+		void calculateOutputGradients(const double * targetValues);
+		void calculateHiddenGradients();
+		void updateWeights();
+
+		// Activations of the output layer of the latest pass.
+		auto getOutputs() const -> const double *;
+
+		auto countOps() const -> size_t;
+
+		// Bytes of the ops and of the buffers of the plan; the
+		// weights belong to the layers.
+		auto memoryUsage() const -> MemoryUsage;
+
+	private:
+		struct Op {
+			const NeuralLayer * layer;
+			size_t   rows;
+			size_t   cols;    // neurons of the previous layer
+			size_t   lda;     // cols + 1, the bias being last
+			double * weights;
+			double * delta_weights;
+			double * inputs;  // activations of the previous layer
+			double * outputs;
+			double * gradients;
+		};
+
+		// Runs task(first, last) on the rows [0, count) split among
+		// the workers of the layer of the given op.
+		template <typename Task>
+		void splitRows(const Op & op, size_t count, const Task & task);
+
+		const NeuralNet & m_net;
+		std::vector<Op> m_ops;
+		// The activations of every layer followed by the output
+		// of the bias, so weight updates read the bias as their
+		// last input; and the gradients of every layer but the
+		// input layer.
+		std::vector<double> m_activations;
+		std::vector<double> m_gradients;
+		std::vector<double> m_sums;
+	};
+}
+
+#endif
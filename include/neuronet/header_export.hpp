@@ -0,0 +1,46 @@
+#ifndef NN_HEADER_EXPORT_H
+#define NN_HEADER_EXPORT_H
+
+#include <string>
+#include <ostream>
+
+namespace neuronet {
+	class NeuralNet;
+
+	//========================================================
+	// Options for exporting a trained net as a standalone
+	// C++ inference header.
+	//
+	// name_space    - namespace of the generated predict
+	//                 function and weight arrays.
+	// include_guard - include guard of the generated header;
+	//                 derived from name_space if empty.
+	//========================================================
+	struct HeaderExportOptions {
+		std::string name_space = "neuronet_model";
+		std::string include_guard;
+	};
+
+	// Writes a self-contained header that depends only on the
+	// standard library and defines
+	//
+	//     void predict(const float * input, float * output);
+	//
+	// for the topology and the current weights of the given net.
+	// Weights are emitted as constexpr float arrays and every
+	// loop has a fixed bound so that compilers may fully unroll
+	// and vectorize the computation. Sums are accumulated in
+	// float, so results differ from NeuralNet::feedForward in
+	// the order of float rounding.
+	//
+	// Throws std::invalid_argument before writing anything if
+	// name_space or include_guard are no valid C++ identifiers
+	// or are C++ keywords,
+	// the net has convolutional layers or a weight isn't a
+	// finite float.
+	void exportInferenceHeader(
+		const NeuralNet & net, std::ostream & out,
+		const HeaderExportOptions & options = HeaderExportOptions{});
+}
+
+#endif
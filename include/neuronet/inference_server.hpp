@@ -0,0 +1,145 @@
+#ifndef NN_INFERENCE_SERVER_H
+#define NN_INFERENCE_SERVER_H
+
+#include <vector>
+#include <deque>
+#include <list>
+#include <string>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <condition_variable>
+#include <ostream>
+#include <cstddef>
+
+namespace neuronet {
+	class NeuralNet;
+
+	//========================================================
+	// Options of the inference server.
+	//
+	// max_batch_size - upper bound of requests computed by
+	//                  one batched forward pass.
+	// max_latency    - the longest time a request waits for
+	//                  other requests to join its batch.
+	// socket_path    - path of the unix domain socket to
+	//                  listen on; stdin and stdout are used
+	//                  if it is empty.
+	// report         - stream receiving per batch statistics;
+	//                  no statistics are written if null.
+	//========================================================
+	struct ServerOptions {
+		size_t                    max_batch_size = 64;
+		std::chrono::microseconds max_latency{1000};
+		std::string               socket_path;
+		std::ostream            * report = nullptr;
+	};
+
+	//========================================================
+	// Coalesces concurrently submitted requests into batches
+	// and computes them with one batched forward pass of the
+	// given neural net on a dedicated thread.
+	// A batch is started as soon as it is full or its oldest
+	// request waited for max_latency.
+	//========================================================
+	class BatchScheduler {
+	public:
+		explicit BatchScheduler(const NeuralNet & net, const ServerOptions & options);
+		~BatchScheduler();
+
+		BatchScheduler(const BatchScheduler &) = delete;
+		BatchScheduler & operator=(const BatchScheduler &) = delete;
+
+		// Enqueues the given input values and returns a future
+		// for the output values computed for them. The future
+		// holds an exception if the batched forward pass threw
+		// or the scheduler has been shut down.
+		auto submit(std::vector<double> inputValues) -> std::future<std::vector<double>>;
+
+		// Computes all pending requests and stops the scheduler.
+		void shutdown();
+
+	private:
+		using clock = std::chrono::steady_clock;
+
+		struct Request {
+			std::vector<double>               input;
+			std::promise<std::vector<double>> result;
+			clock::time_point                 arrival;
+		};
+
+		void run();
+		void computeBatch(std::vector<Request> & batch);
+
+		const NeuralNet     & m_net;
+		ServerOptions         m_options;
+		std::mutex            m_mutex;
+		std::condition_variable m_wakeup;
+		std::deque<Request>   m_pending;
+		bool                  m_stopped;
+		size_t                m_count_batches;
+		size_t                m_count_samples;
+		clock::duration       m_busy_time;
+		std::thread           m_worker;
+	};
+
+	//========================================================
+	// Serves the given neural net with a line based protocol.
+	// Every request is a line
+	//
+	//     input  i1 i2 ... iy
+	//
+	// which is answered with a line
+	//
+	//     output o1 o2 ... oz
+	//
+	// or with a line starting with 'error' if the request is
+	// malformed. Requests of all clients are computed in
+	// batches by a BatchScheduler.
+	//========================================================
+	class InferenceServer {
+	public:
+		explicit InferenceServer(const NeuralNet & net, ServerOptions options);
+
+		// Serves requests on stdin until end of file or on the
+		// unix domain socket until the process is terminated.
+		// If accepting a connection fails, the connections of
+		// all clients are shut down and their threads joined
+		// before the error is thrown.
+		void run();
+
+	private:
+		//========================================================
+		// A connection of the socket and the thread serving it.
+		// The socket is closed only after the thread is joined,
+		// so that it can't be reused while it is shut down.
+		//========================================================
+		struct Client {
+			explicit Client(int socket): socket{socket}, done{false} {}
+
+			int               socket;
+			std::thread       thread;
+			std::atomic<bool> done;
+		};
+
+		void serveStream();
+		void serveSocket();
+		void serveClient(int client);
+
+		// Joins and closes the clients that hung up; with force
+		// first shuts down the sockets of all other clients to
+		// make them stop, too.
+		void reapClients(bool force);
+
+		auto answer(const std::string & request) -> std::future<std::vector<double>>;
+
+		const NeuralNet & m_net;
+		ServerOptions     m_options;
+		BatchScheduler    m_scheduler;
+		std::list<Client> m_clients;
+	};
+}
+
+#endif
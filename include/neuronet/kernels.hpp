@@ -0,0 +1,127 @@
+#ifndef NN_KERNELS_H
+#define NN_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace neuronet {
+	namespace kernels {
+		//========================================================
+		// Block sizes of the blocked kernels, in doubles.
+		//
+		// vector_block - length of the slice of a vector that is
+		//                kept within the L1 cache while the rows
+		//                of a matrix are streamed over it.
+		// gemm_mc      - rows of the packed panel of A (L2).
+		// gemm_kc      - depth of the packed panels (L1).
+		// gemm_nc      - columns of the packed panel of B (L2/L3).
+		//========================================================
+		struct Blocking {
+			size_t vector_block = 1024;
+			size_t gemm_mc      = 64;
+			size_t gemm_kc      = 256;
+			size_t gemm_nc      = 512;
+		};
+
+		// Size of the register tile of the kernels: row_tile rows
+		// of a matrix are processed at once, every row with lanes
+		// independent accumulators.
+		constexpr size_t row_tile = 4;
+		constexpr size_t col_tile = 8;
+		constexpr size_t lanes    = 4;
+
+		// y = A x
+		// where A is a rows x cols matrix with a row stride of lda.
+		void gemv(
+			size_t rows, size_t cols,
+			const double * a, size_t lda,
+			const double * x, double * y,
+			const Blocking & blocking = Blocking{});
+
+		// y = A^T x
+		// where A is a rows x cols matrix with a row stride of lda,
+		// x has rows and y has cols elements.
+		void gemvTransposed(
+			size_t rows, size_t cols,
+			const double * a, size_t lda,
+			const double * x, double * y,
+			const Blocking & blocking = Blocking{});
+
+		// C = A B
+		// where A is m x k, B is k x n and C is m x n, all row major
+		// with the given row strides. Panels of A and B are packed
+		// into contiguous buffers before they are multiplied.
+		void gemm(
+			size_t m, size_t n, size_t k,
+			const double * a, size_t lda,
+			const double * b, size_t ldb,
+			double * c, size_t ldc,
+			const Blocking & blocking = Blocking{});
+
+		// A += x g^T
+		// where g has rows and x has cols elements.
+		void rankOneUpdate(
+			size_t rows, size_t cols,
+			double * a, size_t lda,
+			const double * gradients, const double * x,
+			const Blocking & blocking = Blocking{});
+
+		// Gradient descent with momentum of the weights A given
+		// their previous changes D:
+		//     D = eta * x g^T + alpha * D
+		//     A = A + D
+		void updateWithMomentum(
+			size_t rows, size_t cols,
+			double * a, double * d, size_t lda,
+			double eta, const double * gradients, const double * x,
+			double alpha,
+			const Blocking & blocking = Blocking{});
+
+		// Momentum update of the weights A with accumulated
+		// gradients G which are reset afterwards:
+		//     D = eta * G + alpha * D
+		//     A = A + D
+		//     G = 0
+		void commitWithMomentum(
+			size_t rows, size_t cols,
+			double * a, double * d, double * g, size_t lda,
+			double eta, double alpha);
+
+		//========================================================
+		// 16 bit storage formats of the mixed precision kernels.
+		//
+		// fp16 - IEEE half precision: 5 exponent, 10 mantissa bits.
+		// bf16 - bfloat16: the upper half of a float, 8 exponent
+		//        and 7 mantissa bits.
+		//========================================================
+		enum class HalfFormat {
+			fp16,
+			bf16
+		};
+
+		// Converts count values to or from the given format,
+		// rounding to nearest even.
+		void toHalf(HalfFormat format, const double * x, size_t count, uint16_t * y);
+		void fromHalf(HalfFormat format, const uint16_t * x, size_t count, double * y);
+
+		// y = A x
+		// where A is a rows x cols matrix in the given format with
+		// a row stride of lda. The weights are widened to float in
+		// registers and the products are accumulated in float.
+		// x is rounded to float, or to the format of A as well if
+		// halfInputs is set.
+		// Uses F16C/AVX2 and, for bf16 inputs, AVX512-BF16 dot
+		// products if the cpu supports them.
+		void gemvHalf(
+			HalfFormat format,
+			size_t rows, size_t cols,
+			const uint16_t * a, size_t lda,
+			const double * x, bool halfInputs, double * y);
+
+		// Name of the implementation gemvHalf uses for the given
+		// format and inputs on this cpu.
+		auto describeGemvHalf(HalfFormat format, bool halfInputs) -> const char *;
+	}
+}
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef NN_MEMORY_USAGE_H
+#define NN_MEMORY_USAGE_H
+
+#include <vector>
+#include <cstddef>
+
+namespace neuronet {
+	//========================================================
+	// Bytes allocated by a part of a neural net, split into
+	// categories. Vectors are accounted with their capacity.
+	//
+	// weights             - the weight matrices
+	// optimizer_state     - latest weight changes (momentum)
+	//                       and deferred gradient accumulators
+	// activations         - outputs and gradients of neurons
+	//                       and the buffers of the engines
+	// connection_metadata - connection objects, pointers to
+	//                       incoming connections and the
+	//                       bookkeeping of neurons and layers
+	//========================================================
+	struct MemoryUsage {
+		size_t weights             = 0;
+		size_t optimizer_state     = 0;
+		size_t activations         = 0;
+		size_t connection_metadata = 0;
+
+		auto total() const -> size_t;
+
+		MemoryUsage & operator+=(const MemoryUsage & rhs);
+	};
+
+	//========================================================
+	// Memory usage of a whole neural net.
+	//
+	// layers  - one entry per layer starting with the input
+	//           layer; connections are accounted to the layer
+	//           of their source neuron which owns them.
+	// bias    - the bias neuron and its connections to the
+	//           neurons of all layers.
+	// network - the net object itself, the weight copies
+	//           replicated per NUMA node and the buffers of
+	//           its execution plan if it is compiled.
+	//========================================================
+	struct NetMemoryUsage {
+		std::vector<MemoryUsage> layers;
+		MemoryUsage bias;
+		MemoryUsage network;
+
+		auto total() const -> MemoryUsage;
+	};
+}
+
+#endif
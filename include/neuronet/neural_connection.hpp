@@ -8,9 +8,19 @@ namespace neuronet {
 
 	class NeuralConnection {
 	public:
-		explicit NeuralConnection(Neuron & source, Neuron & target);
+		//====================================================================
+		// The weight of a connection and its latest change are owned by
+		// the weight matrices of the layer of the target neuron, the
+		// connection refers to its slots within them.
+		//====================================================================
+		explicit NeuralConnection(
+			Neuron & source, Neuron & target,
+			double & weight, double & deltaWeight);
 
 		void setWeight(double value);
+		// Sets the weight without recording a weight change,
+		// e.g. when loading a model.
+		void resetWeight(double value);
 		auto getWeight() const -> double;
 		auto getDeltaWeight() const -> double;
 
@@ -19,11 +29,14 @@ namespace neuronet {
 		      Neuron & getTarget();
 		const Neuron & getTarget() const;
 
-	private:
+		// Draws the initial weight of a connection; also used for
+		// the kernels of convolutional layers.
 		static auto randomWeight() -> double;
 
-		double m_weight;
-		double m_delta_weight;
+	private:
+
+		double * m_weight;
+		double * m_delta_weight;
 		Neuron * m_source;
 		Neuron * m_target;
 	};
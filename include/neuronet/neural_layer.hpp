@@ -4,8 +4,16 @@
 #include <vector>
 #include <cstdint>
 #include <cstddef>
+#include <functional>
 
 #include "neuronet/neuron.hpp"
+#include "neuronet/kernels.hpp"
+#include "neuronet/convolution.hpp"
+#include "neuronet/memory_usage.hpp"
+
+namespace neuronet {
+	class WorkerPool;
+}
 
 namespace neuronet {
 	class NeuralNet;
@@ -18,7 +26,56 @@ namespace neuronet {
 			hidden
 		};
 
-		explicit NeuralLayer(NeuralNet & net, uint64_t countNeurons, Kind kind);
+		//====================================================================
+		// Determines how a layer computes its forward pass, the gradients
+		// of its neurons and the updates of its incoming weights.
+		//
+		// reference - every neuron walks its own connections.
+		// blocked   - the whole layer is computed at once by the cache
+		//             blocked kernels on its weight matrix.
+		//====================================================================
+		enum class Engine {
+			reference,
+			blocked
+		};
+
+		//====================================================================
+		// Storage of the weights read by the forward pass.
+		//
+		// fp64      - the weight matrix itself.
+		// fp16/bf16 - a 16 bit copy of the weight matrix, refreshed from it
+		//             by the first forward pass after the weights changed.
+		//             The matrix stays the master copy that training
+		//             updates and backpropagation reads. Sums are
+		//             accumulated in float.
+		//====================================================================
+		enum class WeightFormat {
+			fp64,
+			fp16,
+			bf16
+		};
+
+		//====================================================================
+		// Creates a layer of countNeurons neurons whose previous layer has
+		// countPrevNeurons neurons (zero for the input layer).
+		// The weights of all incoming connections of the neurons are stored
+		// within one row major matrix owned by the layer: row i holds the
+		// weights of neuron i from all neurons of the previous layer
+		// followed by the weight from the bias.
+		//====================================================================
+		explicit NeuralLayer(NeuralNet & net, uint64_t countNeurons, uint64_t countPrevNeurons, Kind kind);
+
+		//====================================================================
+		// Creates a convolutional layer of the given shape. Its neurons
+		// have no incoming connections; every plane of outputs shares the
+		// weights of one kernel instead, stored as row c of the weight
+		// matrix: the weights of kernel c over all input channels,
+		// kernel rows and columns followed by the weight of the bias.
+		// Convolutional layers are computed by lowering their inputs with
+		// im2col, whatever the engine and weight format, and always read
+		// the fp64 weights.
+		//====================================================================
+		explicit NeuralLayer(NeuralNet & net, const Convolution & convolution, Kind kind);
 
 		//====================================================================
 		// Rule-of-three
@@ -47,11 +104,115 @@ namespace neuronet {
 
 		void feedForward();
 
+		//====================================================================
+		// Incremental evaluation keeps the weighted sums of the inputs of
+		// all neurons (their pre-activations) between forward passes.
+		// computePreActivations computes them from scratch,
+		// updatePreActivations adds the change of a single input to them
+		// and applyPreActivations sets the outputs of the neurons.
+		//====================================================================
+		void computePreActivations();
+		void updatePreActivations(size_t input, double delta);
+		void applyPreActivations();
+
+		// Computes the gradients of the neurons of this hidden layer
+		// from the gradients of the next layer.
+		void calculateHiddenGradients();
+
+		// Updates the incoming weights of this layer with the
+		// current gradients of its neurons.
+		void updateInputWeights();
+
+		void setEngine(Engine engine);
+		auto getEngine() const -> Engine;
+
+		// Training rate and momentum of the updates of the
+		// incoming weights of this layer.
+		void setTrainingRate(double eta);
+		auto getTrainingRate() const -> double;
+		void setMomentum(double alpha);
+		auto getMomentum() const -> double;
+
+		// Selects the storage of the weights of the forward pass.
+		// With halfInputs the forward pass also rounds the outputs of
+		// the previous layer to the 16 bit format, which lets bf16
+		// layers use the dot product instructions of AVX512-BF16.
+		void setWeightFormat(WeightFormat format, bool halfInputs = false);
+		auto getWeightFormat() const -> WeightFormat;
+
+		void setBlocking(const kernels::Blocking & blocking);
+		auto getBlocking() const -> const kernels::Blocking &;
+
+		// The blocked engine splits the work of this layer among
+		// the given number of workers of the pool; a null pool or
+		// a single thread keeps it on the calling thread. The
+		// buffers of this layer are not moved: they stay on the
+		// NUMA node of the thread that constructed the layer.
+		void setWorkerPool(WorkerPool * pool, size_t threads);
+		void setThreads(size_t threads);
+		auto getThreads() const -> size_t;
+
+		// Number of incoming connections of every neuron of this
+		// layer, i.e. the number of columns of the weight matrix;
+		// the weights of a kernel and its bias for convolutional
+		// layers.
+		auto countIncConnections() const -> size_t;
+
+		auto getWeights() const -> const std::vector<double> &;
+
+		// Memory owned by this layer, its neurons and their
+		// outgoing connections.
+		auto memoryUsage() const -> MemoryUsage;
+
+		// Slots of the weight and its latest change of the connection
+		// from input (a neuron of the previous layer or the bias) to
+		// the given neuron of this layer.
+		auto weightOf(size_t neuron, size_t input)      -> double &;
+		auto deltaWeightOf(size_t neuron, size_t input) -> double &;
+
+		// Computes the outputs of all neurons of this layer for
+		// batchSize samples given the outputs of the previous layer.
+		// Both buffers store the values of a neuron for all samples
+		// next to each other.
+		void feedForwardBatch(const double * prevOutputs, size_t batchSize, double * outputs) const;
+
+		// Variant reading the weights from the given copy of the weight
+		// matrix of this layer, e.g. a replica local to a NUMA node.
+		// Only the blocked engine reads from the copy.
+		void feedForwardBatch(
+			const double * prevOutputs, size_t batchSize, double * outputs,
+			const double * weights) const;
+
+		// Allocates or releases the gradient accumulators
+		// used by the deferred update mode of the neural net.
+		void setAccumulateGradients(bool enabled);
+
+		// Adds the current gradients of the incoming connections
+		// of all neurons to the accumulators without touching
+		// the weights.
+		void accumulateGradients();
+
+		// Updates the weights with the accumulated gradients
+		// multiplied by scale and resets the accumulators.
+		void commitGradients(double scale);
+
+		// Copies the accumulated gradients to the given buffer of
+		// the size of the weight matrix and resets them, or adds
+		// the given gradients to the accumulators.
+		void takeGradients(double * gradients);
+		void addGradients(const double * gradients);
+
+		// Overwrites the weight matrix, keeping the weight changes.
+		void setWeights(const double * weights);
+
 		bool isInputLayer() const;
 		bool isHiddenLayer() const;
 		bool isOutputLayer() const;
 		Kind getKind() const;
 
+		bool isConvolutional() const;
+		auto getConvolution() const -> const Convolution &;
+
 		//====================================================================
 		// Implementing forward iterator access to internal vector
 		// to enable range based for loop for instances of this class.
@@ -71,12 +232,80 @@ namespace neuronet {
 
 		size_t size() const;
 
+		// Returns the position of the given neuron within this layer.
+		auto indexOf(const Neuron & neuron) const -> size_t;
+
 	private:
+		NeuralLayer(
+			NeuralNet & net, uint64_t countNeurons, uint64_t countPrevNeurons, Kind kind,
+			const Convolution * convolution);
+
+		void gatherInputs();
+		void feedForwardHalf();
+		void gatherGradients();
+
+		//====================================================================
+		// Paths of convolutional layers.
+		//
+		// convolveKernels computes the outputs of the kernels [first, last)
+		// from countColumns lowered columns, feedForwardConvolution the
+		// outputs of the neurons and calculateKernelGradients the gradients
+		// of the weights of all kernels given the gradients of the neurons.
+		// backPropagateConvolution writes the sums of the weighted gradients
+		// of this layer to every neuron of the previous layer.
+		//====================================================================
+		void convolveKernels(
+			size_t first, size_t last,
+			const double * weights, const double * columns, size_t countColumns,
+			double * outputs) const;
+		void feedForwardConvolution();
+		void calculateKernelGradients();
+		void backPropagateConvolution(double * prevSums);
+
+		// Runs task(first, last) on the rows [0, count) of this layer,
+		// split among the workers assigned to it.
+		void splitRows(size_t count, const std::function<void(size_t, size_t)> & task);
+
 		NeuralLayer * m_prev_layer;
 		NeuralLayer * m_next_layer;
 		NeuralNet   * m_net;
 		Kind          m_kind;
+		bool          m_convolutional;
+		Convolution   m_convolution;
+		Engine        m_engine;
+		kernels::Blocking m_blocking;
+		WorkerPool  * m_pool;
+		size_t        m_threads;
+		double        m_training_rate; // [0 .. 1] overall training rate
+		double        m_momentum;      // [0 .. n] multiplier of last weight change
+		size_t        m_count_inc_connections;
 		std::vector<Neuron> m_neurons;
+		// The weight matrix and the matrix of the latest weight changes.
+		std::vector<double> m_weights;
+		std::vector<double> m_delta_weights;
+		// 16 bit copy of the weight matrix for the forward pass; empty
+		// unless used.
+		WeightFormat          m_weight_format;
+		bool                  m_half_inputs;
+		bool                  m_half_weights_stale;
+		std::vector<uint16_t> m_half_weights;
+		// One accumulator per incoming connection of every neuron,
+		// neuron after neuron; empty unless gradients are deferred.
+		std::vector<double> m_accumulated_gradients;
+		// Contiguous copies of the inputs, weighted sums and gradients
+		// of the neurons used by the blocked engine.
+		std::vector<double> m_inputs;
+		std::vector<double> m_sums;
+		std::vector<double> m_gradients;
+		// Pre-activations kept for incremental evaluation; empty unless used.
+		std::vector<double> m_pre_activations;
+		// Lowered inputs, their gradients, the gradients of the kernels
+		// and the transposed kernels of a convolutional layer; empty
+		// for other layers.
+		std::vector<double> m_columns;
+		std::vector<double> m_column_gradients;
+		std::vector<double> m_kernel_gradients;
+		std::vector<double> m_transposed_kernels;
 	};
 }
 
@@ -3,11 +3,25 @@
 
 #include <vector>
 #include <cstdint>
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <memory>
 
 #include "neuronet/neuron.hpp"
+#include "neuronet/neural_layer.hpp"
+#include "neuronet/convolution.hpp"
+#include "neuronet/memory_usage.hpp"
+#include "neuronet/async_training.hpp"
+#include "neuronet/evaluation.hpp"
 
 namespace neuronet {
 	class NeuralLayer;
+	class WorkerPool;
+	class Profiler;
+	class ExecutionPlan;
+	class Telemetry;
+	struct WeightReplicas;
 
 	//========================================================
 	// This class represents a neural network working with
@@ -21,6 +35,20 @@ namespace neuronet {
 	//========================================================
 	class NeuralNet {
 	public:
+		//========================================================
+		// Determines when backPropagation changes the weights.
+		//
+		// immediate - every backPropagation updates the weights.
+		// deferred  - backPropagation only accumulates gradients
+		//             into separate accumulators and leaves the
+		//             weights untouched; commitGradients applies
+		//             the average of the accumulated gradients.
+		//========================================================
+		enum class UpdateMode {
+			immediate,
+			deferred
+		};
+
 		//========================================================
 		// Creates a new instance of a neural net with the given
 		// amount of layers and the given amount of neurons per
@@ -28,6 +56,48 @@ namespace neuronet {
 		//========================================================
 		explicit NeuralNet(const std::vector<uint64_t> & neurons_per_layer);
 
+		//========================================================
+		// Creates a new instance of a neural net whose layers
+		// given by the convolutions are convolutional layers of
+		// their shapes; see Convolution.
+		// The number of neurons of such a layer must be the
+		// number of outputs of its convolution and the number of
+		// neurons of its previous layer the number of inputs.
+		//
+		// Throws an exception if a convolution doesn't fit.
+		//========================================================
+		explicit NeuralNet(
+			const std::vector<uint64_t> & neurons_per_layer,
+			const std::vector<Convolution> & convolutions);
+
+		//========================================================
+		// Creates a new instance of a neural net from a model
+		// previously written by save().
+		//
+		// The format of a model is as follows:
+		//
+		// topology n1 n2 ... nx
+		// convolution l ...
+		//
+		// weights  w1 w2 ... wy b
+		// ...
+		//
+		// There is one 'convolution' line for every convolutional
+		// layer holding the fields of its Convolution in their
+		// order of declaration, starting with the layer.
+		// There is one 'weights' line for every neuron of every
+		// layer except the input layer, in layer order. It holds
+		// the weights of the connections from all neurons of the
+		// previous layer followed by the weight of the bias.
+		// Convolutional layers have one 'weights' line for every
+		// kernel instead, holding its weights followed by the
+		// weight of the bias.
+		//
+		// Throws an exception if the model doesn't met the format
+		// requirements.
+		//========================================================
+		explicit NeuralNet(std::istream & model);
+
 		//====================================================================
 		// Rule-of-three
 		// =============
@@ -47,18 +117,233 @@ namespace neuronet {
 		// results() can be used to read the result of this
 		// computation.
 		void feedForward(const std::vector<double> & inputValues);
+		void feedForward(const double * inputValues, size_t count);
 
 		// Used to make this neural network adapt and learn
 		// with expected values given as parameters.
 		void backPropagation(const std::vector<double> & targetValues);
+		void backPropagation(const double * targetValues, size_t count);
+
+		// Sets the update mode of backPropagation. Switching
+		// the mode requires that no gradients are pending.
+		void setUpdateMode(UpdateMode mode);
+		auto getUpdateMode() const -> UpdateMode;
+
+		// Applies the average of the gradients accumulated by
+		// backPropagation in deferred mode since the last commit
+		// and resets the accumulators.
+		// Committing after every pass matches the immediate mode
+		// up to rounding only: the training rate scales the
+		// accumulated product of input and gradient instead of
+		// the input, so weights may differ in their last bits.
+		void commitGradients();
+
+		// Returns the number of backPropagation calls whose
+		// gradients are accumulated but not committed yet.
+		auto countPendingGradients() const -> size_t;
+
+		//========================================================
+		// Flat access to the parameters of all layers after the
+		// input layer, their weight matrices one after another,
+		// for exchanging them with other processes.
+		//
+		// takeGradients moves the gradients accumulated in
+		// deferred mode to the given buffer and returns the
+		// number of passes they sum up; addGradients adds
+		// gradients of the given number of passes as if they
+		// were accumulated by this neural net, so the next
+		// commitGradients applies them.
+		//========================================================
+		auto countParameters() const -> size_t;
+		void copyWeights(double * weights) const;
+		void setWeights(const double * weights);
+		auto takeGradients(double * gradients) -> size_t;
+		void addGradients(const double * gradients, size_t passes);
+
+		//========================================================
+		// Enables the incremental evaluation of feedForward.
+		// The pre-activations of the first hidden layer are kept
+		// between passes and only updated with the weights of
+		// the inputs that changed since the previous pass, so
+		// the cost of the first layer depends on the number of
+		// changed inputs instead of the input width.
+		// They are recomputed from scratch after the weights
+		// changed, when many inputs changed at once and
+		// periodically to bound the rounding drift.
+		// Throws std::invalid_argument when enabled for a net
+		// whose first hidden layer is convolutional.
+		//========================================================
+		void setIncremental(bool enabled);
+		bool isIncremental() const;
+
+		// Combines feedForward and backPropagation for one
+		// training pass.
+		void trainStep(
+			const std::vector<double> & inputValues,
+			const std::vector<double> & targetValues);
+		void trainStep(
+			const double * inputValues,  size_t countInputs,
+			const double * targetValues, size_t countTargets);
 
 		// Returns results in the output values of the Output Layer
 		// of the latest computation of feedForward and/or backPropagation.
+		// The pointer overload writes them to the given buffer
+		// of count values instead of allocating a new vector.
 		auto results() const -> std::vector<double>;
+		void results(double * outputValues, size_t count) const;
+
+		// Computes the output values of batchSize samples at once
+		// without touching the state of the neurons.
+		// inputValues stores the input values of the samples one
+		// after another, outputValues is resized to store their
+		// output values the same way.
+		// Every weight is read once per batch instead of once per
+		// sample.
+		void feedForwardBatch(
+			const std::vector<double> & inputValues,
+			size_t batchSize,
+			std::vector<double> & outputValues) const;
+
+		//========================================================
+		// Evaluates this neural net on the given data set with
+		// batched forward passes only, leaving its neurons, its
+		// weights and its errors untouched. The batches are
+		// split among the workers of the worker pool if there
+		// is one; the result doesn't depend on their number.
+		//
+		// Throws std::invalid_argument if the data set or any of
+		// its passes doesn't match the input and output layers,
+		// or if the batch size is zero.
+		//========================================================
+		auto evaluate(
+			const utility::TrainingData & data,
+			const EvaluationOptions & options = EvaluationOptions{}) const
+			-> EvaluationResult;
+
+		// Trains this neural net with the given data set on a new
+		// thread and returns a handle to poll its progress, to
+		// cancel it and to wait for its completion.
+		// See TrainingHandle for the lifetime requirements.
+		auto trainAsync(const utility::TrainingData & data, TrainingOptions options = TrainingOptions{})
+			-> TrainingHandle;
+
+		// Returns a number that changes whenever the weights of this
+		// neural net change, so that derived data can be invalidated.
+		auto getWeightsVersion() const -> size_t;
+
+		// Writes the topology and weights of this neural network
+		// to the given stream in the format read by the stream
+		// constructor.
+		void save(std::ostream & model) const;
 
 		auto getRecentAverageError() const -> double;
 
+		// The recent average error weighs the error of the latest
+		// pass against the previous average like
+		//     (average * window + error) / (window + 1),
+		// i.e. averages about the latest window passes. It is
+		// zero by default, making it the error of the latest pass.
+		void setErrorSmoothing(double window);
+		auto getErrorSmoothing() const -> double;
+
+		// Records every backPropagation into the given telemetry;
+		// a null telemetry stops recording.
+		void setTelemetry(std::shared_ptr<Telemetry> telemetry);
+
+		// Selects the engine computing all layers of this neural net.
+		// The blocked engine computes whole layers with the cache
+		// blocked kernels on their weight matrices.
+		void setEngine(NeuralLayer::Engine engine);
+
+		//========================================================
+		// Lowers the layers of this neural net into an execution
+		// plan of one fused op per layer with preallocated
+		// buffers (see ExecutionPlan) that feedForward and
+		// backPropagation run from now on instead of walking the
+		// layers. Only the outputs of the output layer are kept
+		// up to date in the neurons, the neurons of the other
+		// layers keep the values of the last pass before.
+		//
+		// Requires the immediate update mode, no incremental
+		// evaluation and fp64 weights; switching to any other
+		// of them discards the plan again, as does decompile.
+		// Throws std::invalid_argument if one of them is not
+		// met or if there are convolutional layers.
+		// The profiler sees the op of every layer as its
+		// forward pass and the steps of the backward pass as
+		// the phases of backPropagation.
+		//========================================================
+		void compile();
+		void decompile();
+		bool isCompiled() const;
+
+		// Selects the storage of the weights read by feedForward in
+		// all layers; see NeuralLayer::WeightFormat. feedForwardBatch
+		// and the incremental evaluation keep reading the fp64 master
+		// weights.
+		void setWeightFormat(NeuralLayer::WeightFormat format, bool halfInputs = false);
+
+		// Sets the training rate (eta) and the momentum (alpha) of
+		// the weight updates of all layers of this neural net;
+		// they default to 0.15 and 0.5.
+		void setTrainingRate(double eta);
+		auto getTrainingRate() const -> double;
+		void setMomentum(double alpha);
+		auto getMomentum() const -> double;
+
+		// Overrides the engine, block sizes and number of workers
+		// of a single layer, the input layer having index 0.
+		void setLayerEngine(size_t layer, NeuralLayer::Engine engine);
+		void setLayerBlocking(size_t layer, const kernels::Blocking & blocking);
+		void setLayerThreads(size_t layer, size_t threads);
+
+		//========================================================
+		// Makes the parallel paths of this neural net use the
+		// workers of the given pool:
+		//   - the blocked engine splits wide layers among them
+		//   - feedForwardBatch splits the batch among them with
+		//     activations local to each worker and, if the pool
+		//     asks for it, weights replicated per NUMA node.
+		//   - evaluate splits its batches among them the same
+		//     way.
+		// A null pool makes this neural net single threaded again.
+		// The weights, gradients, delta weights and accumulated
+		// gradients of a layer stay where the constructing thread
+		// first touched them: workers splitting a layer read and
+		// write their rows there, which may be a remote NUMA node.
+		// Only the worker scratch buffers and replicated weights
+		// are placed on each worker's own node.
+		//========================================================
+		void setWorkerPool(std::shared_ptr<WorkerPool> pool);
+		auto getWorkerPool() const -> const std::shared_ptr<WorkerPool> &;
+
+		//========================================================
+		// Measures the forward pass of every layer and every phase
+		// of backPropagation with the given profiler, adding one
+		// region per layer and phase to it. A null profiler turns
+		// profiling off again.
+		//========================================================
+		void setProfiler(std::shared_ptr<Profiler> profiler);
+
+		// Returns the memory allocated by this neural net per
+		// layer and per category.
+		auto memoryUsage() const -> NetMemoryUsage;
+
+		// Read access to the layers of this neural net, starting
+		// with the input layer and ending with the output layer.
+		auto getLayers() const -> const std::vector<NeuralLayer> &;
+
+		// Returns the shapes of the convolutional layers.
+		auto getConvolutions() const -> std::vector<Convolution>;
+
 	private:
+		struct Topology {
+			std::vector<uint64_t>    neurons_per_layer;
+			std::vector<Convolution> convolutions;
+		};
+
+		explicit NeuralNet(const Topology & topology);
+
 		//========================================================
 		// These are helper functions to improve code readability
 		// while accessing the input layer of a neural network.
@@ -84,16 +369,34 @@ namespace neuronet {
 		void initializeBackConnections();
 		void initializeLayers();
 
+		void feedForwardIncremental(const double * inputValues);
+
+		// Runs the given phase, measured as the given region of
+		// the profiler if there is one.
+		template <typename Phase>
+		void profile(size_t region, Phase && phase);
+
+		void feedForwardBatchSlice(
+			const double * inputValues, size_t batchSize,
+			double * outputValues,
+			double * activations, double * next,
+			const std::vector<const double *> & weights) const;
+		auto replicatedWeights(size_t node) const -> std::vector<const double *>;
+
+		static auto readTopology(std::istream & model) -> Topology;
+		void readWeights(std::istream & model);
+
 		//========================================================
 		// These private helper functions are mainly used to
 		// break down the huge back propagation function into
 		// several minor logical pieces of code.
 		//========================================================
-		void calculateOverallNetError(const std::vector<double> & targetValues);
+		void calculateOverallNetError(const double * targetValues);
 		void calculateAverageError();
-		void calculateOutputLayerGradients(const std::vector<double> & targetValues);
+		void calculateOutputLayerGradients(const double * targetValues);
 		void calculateHiddenLayerGradients();
 		void updateConnectionWeights();
+		void accumulateGradients();
 
 		//========================================================
 		// This is used by the feedForward method in order to
@@ -101,6 +404,7 @@ namespace neuronet {
 		// Note: Maybe this method is also helpful as public.
 		//========================================================
 		void setInput(const std::vector<double> &);
+		void setInput(const double * inputValues, size_t count);
 
 		//========================================================
 		// Private Members
@@ -108,11 +412,48 @@ namespace neuronet {
 		//   m_error
 		//   m_recent_avg_error
 		//   m_recent_avg_smoothing_factor
+		//   m_update_mode
+		//   m_pending_gradients - passes accumulated in deferred mode
+		//   m_weights_version - incremented whenever weights change
+		//   m_incremental - feedForward evaluates incrementally
+		//   m_incremental_version - weights version of the kept
+		//                           pre-activations
+		//   m_incremental_passes - passes since their last full
+		//                          computation
+		//   m_changed_inputs - indices of changed inputs
+		//   m_pool - workers of the parallel paths, may be null
+		//   m_replicas - per NUMA node copies of the weights
+		//   m_plan - execution plan created by compile, may be null
+		//   m_telemetry - records every pass, may be null
 		//   m_layers - stores the layers of this neural net
 		//========================================================
 		double m_error;
 		double m_recent_avg_error;
 		double m_recent_avg_smoothing_factor;
+		UpdateMode m_update_mode;
+		size_t m_pending_gradients;
+		size_t m_weights_version;
+		bool   m_incremental;
+		size_t m_incremental_version;
+		size_t m_incremental_passes;
+		std::vector<size_t> m_changed_inputs;
+		std::shared_ptr<WorkerPool> m_pool;
+		std::shared_ptr<WeightReplicas> m_replicas;
+		std::shared_ptr<ExecutionPlan> m_plan;
+		std::shared_ptr<Telemetry> m_telemetry;
+
+		// Profiler regions of the forward pass of every layer and
+		// of the phases of backPropagation.
+		enum BackPropagationPhase {
+			phase_error,
+			phase_output_gradients,
+			phase_hidden_gradients,
+			phase_weight_updates,
+			count_phases
+		};
+		std::shared_ptr<Profiler> m_profiler;
+		std::vector<size_t> m_profile_layers;
+		size_t m_profile_phases[count_phases];
 		Neuron m_bias;
 		std::vector<NeuralLayer> m_layers;
 	};
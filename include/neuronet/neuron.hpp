@@ -3,7 +3,9 @@
 
 #include <vector>
 #include <cstdint>
+#include <cstddef>
 
+#include "neuronet/memory_usage.hpp"
 #include "neuronet/neural_connection.hpp"
 #include "neuronet/neural_layer.hpp"
 
@@ -26,24 +28,42 @@ namespace neuronet {
 		auto getOutput() const -> double;
 
 		void feedForward();
+		void feedForwardBatch(const double * prevOutputs, size_t batchSize, double * outputs) const;
 		void calculateOutputGradient(double targetValue);
 		void calculateHiddenGradient();
+		// Variant for callers that already know the sum of the weighted
+		// gradients of the outgoing connections.
+		void calculateHiddenGradient(double sumDeltaOutputWeights);
+		auto getGradient() const -> double;
 		void updateInputWeights();
 
+		// Deferred counterpart of updateInputWeights: adds the gradients
+		// of the incoming connections to the given accumulators (one per
+		// incoming connection) and applies them later on.
+		void accumulateInputGradients(double * accumulators) const;
+		void commitInputGradients(double * accumulators, double scale);
+
 		void registerIncConnection(NeuralConnection & connection);
 
-	private:
-		explicit Neuron(NeuralLayer * layer, double output);
+		// Incoming connections in registration order: the neurons of the
+		// previous layer in their layer order followed by the bias.
+		auto getIncConnections() const -> const std::vector<NeuralConnection*> &;
 
-		      NeuralLayer & getLayer();
-		const NeuralLayer & getLayer() const;
+		bool isBias() const;
 
-		static double eta;   // [0 .. 1] overall net training rate
-		static double alpha; // [0 .. n] multiplier of last weight change (momentum)
+		// Memory owned by this neuron including the object itself
+		// and its outgoing connections.
+		auto memoryUsage() const -> MemoryUsage;
 
 		static auto transferFunction(double x) -> double;
 		static auto transferFunctionDerivate(double x) -> double;
 
+	private:
+		explicit Neuron(NeuralLayer * layer, double output);
+
+		      NeuralLayer & getLayer();
+		const NeuralLayer & getLayer() const;
+
 		auto sumDeltaOutputWeights() const -> double;
 
 		double m_output;
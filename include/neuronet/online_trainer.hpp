@@ -0,0 +1,104 @@
+#ifndef NN_ONLINE_TRAINER_H
+#define NN_ONLINE_TRAINER_H
+
+#include <vector>
+#include <random>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+namespace utility {
+	class TrainingStream;
+}
+
+namespace neuronet {
+	class NeuralNet;
+
+	//========================================================
+	// Progress of an online training.
+	//
+	// passes_read          - passes read from the stream.
+	// passes_trained       - training steps including replays.
+	// publications         - calls of the publish callback.
+	// recent_average_error - of the trained net.
+	//========================================================
+	struct OnlineTrainingStats {
+		size_t passes_read          = 0;
+		size_t passes_trained       = 0;
+		size_t publications         = 0;
+		double recent_average_error = 0.0;
+	};
+
+	//========================================================
+	// Options of an online training.
+	//
+	// buffer_capacity  - passes kept in the shuffle buffer;
+	//                    every arriving pass replaces a random
+	//                    buffered pass which is trained instead,
+	//                    which breaks up correlated sequences of
+	//                    the producers. While the buffer fills
+	//                    up, every arriving pass is buffered and
+	//                    a random pass of the part filled so far
+	//                    is trained, so training starts with the
+	//                    first pass. Zero trains passes in the
+	//                    order they arrive.
+	// replays          - additional training steps on random
+	//                    buffered passes per arriving pass.
+	// publish_interval - training steps between calls of
+	//                    publish; zero publishes only at the
+	//                    end of the stream.
+	// seed             - seed of the buffer's random choices.
+	// publish          - receives the net and the progress;
+	//                    called on the training thread so the
+	//                    net is not modified while it runs.
+	//========================================================
+	struct OnlineTrainingOptions {
+		size_t   buffer_capacity  = 1024;
+		size_t   replays          = 0;
+		size_t   publish_interval = 10000;
+		uint64_t seed             = 1;
+		std::function<void(const NeuralNet &, const OnlineTrainingStats &)> publish;
+	};
+
+	//========================================================
+	// Trains a neural net on passes as they arrive on a
+	// training stream. Memory stays bounded by the shuffle
+	// buffer and the work per arriving pass is constant
+	// however long the stream runs.
+	//========================================================
+	class OnlineTrainer {
+	public:
+		explicit OnlineTrainer(NeuralNet & net, OnlineTrainingOptions options);
+
+		// Trains on the passes of the given stream until it ends,
+		// then trains on the remaining buffered passes in random
+		// order and publishes the net a last time.
+		//
+		// Throws std::invalid_argument if the topology of the
+		// stream does not match the net.
+		void train(utility::TrainingStream & stream);
+
+		auto getStats() const -> const OnlineTrainingStats &;
+
+	private:
+		auto slot(size_t index) -> double *;
+		void trainOn(const double * pass);
+		void publish();
+
+		NeuralNet           & m_net;
+		OnlineTrainingOptions m_options;
+		OnlineTrainingStats   m_stats;
+		std::mt19937_64       m_random;
+		size_t                m_count_inputs;
+		size_t                m_count_outputs;
+		size_t                m_count_buffered = 0;
+		size_t                m_published_at   = 0;
+
+		// The passes of the buffer followed by the arriving pass,
+		// each stored as its input values followed by its
+		// expected values.
+		std::vector<double>   m_buffer;
+	};
+}
+
+#endif
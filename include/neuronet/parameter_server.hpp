@@ -0,0 +1,130 @@
+#ifndef NN_PARAMETER_SERVER_H
+#define NN_PARAMETER_SERVER_H
+
+#include <string>
+#include <mutex>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+
+namespace utility {
+	class TrainingData;
+}
+
+namespace neuronet {
+	class NeuralNet;
+
+	//========================================================
+	// Encoding of the gradients pushed by a training worker.
+	//
+	// none      - doubles.
+	// fp16/bf16 - rounded to 16 bit floats, a quarter of the
+	//             bytes; bf16 keeps the range of float and
+	//             doesn't flush small gradients to zero.
+	//========================================================
+	enum class GradientCompression {
+		none,
+		fp16,
+		bf16
+	};
+
+	//========================================================
+	// Options of the parameter server.
+	//
+	// address - "unix:<path>" for a unix domain socket, or
+	//           "<host>:<port>" for TCP, e.g. "127.0.0.1:7070".
+	// workers - number of workers to serve; the server stops
+	//           once all of them are done.
+	// report  - stream receiving a line per finished worker;
+	//           nothing is written if null.
+	//========================================================
+	struct ParameterServerOptions {
+		std::string    address;
+		size_t         workers = 1;
+		std::ostream * report  = nullptr;
+	};
+
+	struct ParameterServerStats {
+		uint64_t pushes         = 0;
+		uint64_t passes         = 0;
+		uint64_t bytes_received = 0;
+		uint64_t bytes_sent     = 0;
+	};
+
+	//========================================================
+	// Holds the weights of a neural net for data parallel
+	// training by worker processes (see runTrainingWorker).
+	//
+	// A worker says hello and receives the topology and the
+	// weights of the net. Then it repeatedly pushes the sum
+	// of the gradients of a batch of passes and receives the
+	// weights after the server applied them with the training
+	// rate and momentum of the net. Every worker is served by
+	// its own thread; pushes are applied one at a time as
+	// they arrive, so workers never wait for each other and
+	// compute on weights that may miss the latest pushes of
+	// the others.
+	//
+	// The messages are not portable between hosts of a
+	// different byte order.
+	//========================================================
+	class ParameterServer {
+	public:
+		// Listens on the address right away, so workers may be
+		// started as soon as the constructor returns.
+		// Switches the net to the deferred update mode.
+		// Throws std::invalid_argument for nets with
+		// convolutional layers.
+		ParameterServer(NeuralNet & net, const ParameterServerOptions & options);
+		~ParameterServer();
+
+		ParameterServer(const ParameterServer &) = delete;
+		ParameterServer & operator=(const ParameterServer &) = delete;
+
+		// Serves the workers until all of them are done.
+		auto run() -> ParameterServerStats;
+
+	private:
+		void serve(int connection, size_t worker);
+
+		NeuralNet & m_net;
+		ParameterServerOptions m_options;
+		int m_listener;
+		std::mutex m_mutex;
+		ParameterServerStats m_stats;
+	};
+
+	//========================================================
+	// Options of a training worker.
+	//
+	// address      - address of the parameter server.
+	// shard        - the worker trains on the passes whose
+	// shards         index modulo shards equals shard.
+	// epochs       - passes over the shard.
+	// batch_passes - passes whose gradients are summed up
+	//                locally before they are pushed.
+	// compression  - encoding of the pushed gradients.
+	//========================================================
+	struct TrainingWorkerOptions {
+		std::string address;
+		size_t shard        = 0;
+		size_t shards       = 1;
+		size_t epochs       = 1;
+		size_t batch_passes = 32;
+		GradientCompression compression = GradientCompression::none;
+	};
+
+	struct TrainingWorkerStats {
+		uint64_t pushes               = 0;
+		uint64_t passes               = 0;
+		uint64_t bytes_sent           = 0;
+		double   recent_average_error = 0.0;
+	};
+
+	// Trains on a shard of the given data against the
+	// parameter server at the given address.
+	auto runTrainingWorker(const utility::TrainingData & data, const TrainingWorkerOptions & options)
+		-> TrainingWorkerStats;
+}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef NN_PIPELINE_H
+#define NN_PIPELINE_H
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <cstddef>
+
+namespace neuronet {
+	class NeuralNet;
+
+	//========================================================
+	// Options of the layer pipeline.
+	//
+	// stages         - number of threads the layers are split
+	//                  among; one per layer if zero. Adjacent
+	//                  layers are grouped so that every stage
+	//                  has about the same number of weights.
+	// queue_capacity - samples in flight between two stages;
+	//                  rounded up to a power of two.
+	// cpus           - cpus the stages are pinned to, stage i
+	//                  to cpus[i % cpus.size()]; stages are not
+	//                  pinned if empty.
+	//========================================================
+	struct PipelineOptions {
+		size_t           stages         = 0;
+		size_t           queue_capacity = 64;
+		std::vector<int> cpus;
+	};
+
+	//========================================================
+	// Streams samples through the layers of a neural net with
+	// every stage of layers running on its own thread: while
+	// stage i computes its layers for sample n, stage i+1
+	// computes its layers for sample n-1. Activations are
+	// handed from stage to stage through bounded lock-free
+	// single producer single consumer queues, so the stages
+	// never take a lock.
+	//
+	// Pays off for deep nets whose layers are too narrow to
+	// be split among threads; every sample still takes the
+	// time of all its layers, but the throughput is set by
+	// the slowest stage only.
+	//
+	// One thread may push samples and one thread may pop
+	// their outputs, in the order they were pushed. The
+	// stages read the weights of the net through its const
+	// batched forward pass, so the net must not be trained
+	// while the pipeline exists.
+	//========================================================
+	class Pipeline {
+	public:
+		explicit Pipeline(const NeuralNet & net, const PipelineOptions & options = PipelineOptions{});
+
+		// Stops all stages, dropping the samples in flight.
+		~Pipeline();
+
+		Pipeline(const Pipeline &) = delete;
+		Pipeline & operator=(const Pipeline &) = delete;
+
+		// Enqueues the input values of the next sample; waits
+		// while the first stage is busy with a full queue.
+		void push(const double * inputValues, size_t count);
+		void push(const std::vector<double> & inputValues);
+
+		// Signals that no more samples will be pushed.
+		void close();
+
+		// Waits for the output values of the oldest sample not
+		// popped yet; returns false if the pipeline is closed
+		// and all outputs have been popped.
+		auto pop(double * outputValues, size_t count) -> bool;
+		auto pop(std::vector<double> & outputValues) -> bool;
+
+		auto countStages() const -> size_t;
+
+		// Index of the first layer of every stage.
+		auto getStageLayers() const -> const std::vector<size_t> &;
+
+	private:
+		struct Queue;
+
+		void runStage(size_t stage, int cpu);
+
+		const NeuralNet & m_net;
+		std::vector<size_t> m_stage_layers;
+		// m_queues[i] feeds stage i, the last one the consumer.
+		std::vector<std::unique_ptr<Queue>> m_queues;
+		std::vector<std::thread> m_threads;
+		std::atomic<bool> m_stopping;
+	};
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef NN_PROFILER_H
+#define NN_PROFILER_H
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+
+namespace neuronet {
+	//========================================================
+	// Hardware events counted by PerfCounters.
+	//========================================================
+	enum class PerfEvent {
+		cycles,
+		instructions,
+		llc_misses,
+		branch_misses
+	};
+
+	constexpr size_t count_perf_events = 4;
+
+	using PerfValues = std::array<uint64_t, count_perf_events>;
+
+	//========================================================
+	// Hardware performance counters of the calling thread
+	// read via perf_event_open on Linux; kernel and
+	// hypervisor events are excluded.
+	//
+	// The counters may be unavailable as a whole, e.g. in
+	// containers or with a restrictive perf_event_paranoid,
+	// or individually on cpus or virtual machines lacking an
+	// event. Unavailable counters read as zero and
+	// available() and has() tell them apart.
+	//========================================================
+	class PerfCounters {
+	public:
+		PerfCounters();
+		~PerfCounters();
+
+		PerfCounters(const PerfCounters &) = delete;
+		PerfCounters & operator=(const PerfCounters &) = delete;
+
+		bool available() const;
+		bool has(PerfEvent event) const;
+
+		// Why the counters are unavailable; empty if they are not.
+		auto getError() const -> const std::string &;
+
+		// Returns the current values of all counters, scaled up
+		// if the kernel multiplexed them.
+		auto read() const -> PerfValues;
+
+	private:
+		int m_leader;
+		std::array<int, count_perf_events> m_descriptors;
+		std::array<size_t, count_perf_events> m_slots;
+		size_t m_count_open;
+		std::string m_error;
+	};
+
+	//========================================================
+	// Counters and wall time accumulated by a region of a
+	// profile. weights is the number of weights the region
+	// reads per call, the base of the misses per weight.
+	//========================================================
+	struct ProfileRegion {
+		std::string name;
+		size_t      weights = 0;
+		size_t      calls   = 0;
+		double      seconds = 0.0;
+		PerfValues  values  = {};
+	};
+
+	//========================================================
+	// Accumulates hardware counters and wall time of named
+	// regions of the calling thread, e.g. the forward pass
+	// of every layer of a neural net.
+	// Work other threads do for a region (e.g. the workers of
+	// a pool) is part of its wall time but not its counters.
+	//========================================================
+	class Profiler {
+	public:
+		// Adds a region and returns its index.
+		auto addRegion(std::string name, size_t weights) -> size_t;
+
+		// Starts measuring; stop adds everything since the
+		// latest start to the given region.
+		void start();
+		void stop(size_t region);
+
+		auto getRegions()  const -> const std::vector<ProfileRegion> &;
+		auto getCounters() const -> const PerfCounters &;
+
+		// Writes one line per region with calls, wall time, IPC,
+		// LLC and branch misses and LLC misses per weight, or the
+		// wall time only if the counters are unavailable.
+		void report(std::ostream & out) const;
+
+	private:
+		PerfCounters m_counters;
+		std::vector<ProfileRegion> m_regions;
+		PerfValues m_start_values = {};
+		std::chrono::steady_clock::time_point m_start_time;
+	};
+}
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef NN_RESULT_CACHE_H
+#define NN_RESULT_CACHE_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace neuronet {
+	class NeuralNet;
+
+	//========================================================
+	// Options of the result cache.
+	//
+	// capacity     - upper bound of cached results.
+	// shards       - independently locked parts of the cache;
+	//                more shards mean less contention between
+	//                concurrent misses.
+	// quantization - inputs are keyed by their exact bits if
+	//                zero, otherwise by their values rounded to
+	//                multiples of it; a cached result then
+	//                stands for all inputs of its bucket.
+	//========================================================
+	struct ResultCacheOptions {
+		size_t capacity     = 4096;
+		size_t shards       = 16;
+		double quantization = 0.0;
+	};
+
+	//========================================================
+	// Statistics of the result cache.
+	//
+	// stale - lookups that found a result computed with
+	//         weights that changed since; counted as misses.
+	//========================================================
+	struct ResultCacheStats {
+		uint64_t hits      = 0;
+		uint64_t misses    = 0;
+		uint64_t stale     = 0;
+		uint64_t evictions = 0;
+
+		auto hitRate() const -> double;
+	};
+
+	//========================================================
+	// A bounded cache of the output values of a neural net
+	// keyed on its input values, for workloads that evaluate
+	// the same inputs again and again.
+	//
+	// Results are evicted by the CLOCK algorithm: hits only
+	// set a reference bit under a shared lock, so concurrent
+	// readers don't contend on hits. Misses are computed by
+	// the const feedForwardBatch of the net outside of any
+	// lock and inserted under the lock of their shard.
+	//
+	// Every result remembers the weights version of the net
+	// it was computed with, so results become stale as soon
+	// as backPropagation, commitGradients or reading a model
+	// change the weights. Changing the weights must not race
+	// with lookups.
+	//========================================================
+	class ResultCache {
+	public:
+		explicit ResultCache(const NeuralNet & net, const ResultCacheOptions & options = ResultCacheOptions{});
+		~ResultCache();
+
+		ResultCache(const ResultCache &) = delete;
+		ResultCache & operator=(const ResultCache &) = delete;
+
+		// Writes the output values for the given input values,
+		// taken from the cache or computed by the net.
+		// Safe to call from many threads at once.
+		void predict(const double * inputValues, size_t count, double * outputValues);
+		auto predict(const std::vector<double> & inputValues) -> std::vector<double>;
+
+		auto getStats() const -> ResultCacheStats;
+
+		// Drops all results and resets the statistics.
+		void clear();
+
+	private:
+		struct Shard;
+
+		auto keyOf(const double * inputValues, std::vector<uint64_t> & key) const -> size_t;
+
+		const NeuralNet        & m_net;
+		ResultCacheOptions       m_options;
+		std::unique_ptr<Shard[]> m_shards;
+
+		std::atomic<uint64_t> m_hits;
+		std::atomic<uint64_t> m_misses;
+		std::atomic<uint64_t> m_stale;
+		std::atomic<uint64_t> m_evictions;
+	};
+}
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef NN_SPARSE_LAYER_H
+#define NN_SPARSE_LAYER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "neuronet/memory_usage.hpp"
+
+namespace neuronet {
+	//====================================================================
+	// A layer whose incoming weights are stored in compressed sparse
+	// row (CSR) form: row i holds the non-zero weights of neuron i,
+	// their columns index the neurons of the previous layer.
+	// The bias weight of every neuron is kept dense since it is never
+	// worth to prune it away.
+	//====================================================================
+	class SparseLayer {
+	public:
+		explicit SparseLayer(size_t countInputs);
+
+		// Appends a new neuron (row) with the given bias weight.
+		// Its weights are added via addWeight afterwards.
+		void addNeuron(double biasWeight);
+		void addWeight(uint32_t column, double weight);
+
+		// Computes out = tanh(W * in + bias) where in has countInputs()
+		// and out has size() elements. On cpus with AVX2 the inputs of
+		// a row are gathered four at a time; see describeSparseGemv.
+		void feedForward(const double * in, double * out) const;
+
+		auto size()          const -> size_t;
+		auto countInputs()   const -> size_t;
+		auto countNonZeros() const -> size_t;
+
+		// The weights and biases count as weights, the columns and
+		// row offsets as connection metadata.
+		auto memoryUsage() const -> MemoryUsage;
+
+	private:
+		size_t m_count_inputs;
+		std::vector<uint32_t> m_row_offsets;
+		std::vector<uint32_t> m_columns;
+		std::vector<double>   m_weights;
+		std::vector<double>   m_bias;
+	};
+
+	// Name of the sparse kernel SparseLayer::feedForward picks
+	// on this cpu: "avx2-gather" or "scalar".
+	auto describeSparseGemv() -> const char *;
+}
+
+#endif
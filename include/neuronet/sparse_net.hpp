@@ -0,0 +1,67 @@
+#ifndef NN_SPARSE_NET_H
+#define NN_SPARSE_NET_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "neuronet/sparse_layer.hpp"
+
+namespace neuronet {
+	class NeuralNet;
+
+	//========================================================
+	// Options for the magnitude pruning of a trained net.
+	//
+	// threshold - drops every weight with an absolute value
+	//             below the threshold.
+	// top_k     - keeps only the keep_per_neuron weights with
+	//             the biggest absolute values of every neuron.
+	//========================================================
+	struct PruningOptions {
+		enum class Strategy {
+			threshold,
+			top_k
+		};
+
+		Strategy strategy       = Strategy::threshold;
+		double   threshold      = 0.0;
+		size_t   keep_per_neuron = 0;
+	};
+
+	//========================================================
+	// An inference only representation of a neural net
+	// with sparse connectivity between its layers.
+	// Instances are created by pruning a trained NeuralNet.
+	//========================================================
+	class SparseNet {
+	public:
+		explicit SparseNet(size_t countInputs, std::vector<SparseLayer> layers);
+
+		// Computes the output values for the given input values.
+		// results() can be used to read the result of this
+		// computation.
+		void feedForward(const std::vector<double> & inputValues);
+
+		auto results() const -> std::vector<double>;
+
+		auto getLayers()     const -> const std::vector<SparseLayer> &;
+		auto countNonZeros() const -> size_t;
+		auto memoryUsage()   const -> MemoryUsage;
+
+	private:
+		size_t m_count_inputs;
+		std::vector<SparseLayer> m_layers;
+		std::vector<double> m_input;
+		std::vector<double> m_output;
+	};
+
+	// Removes all weights of the given net that are dispensable
+	// according to the given options and returns the remaining
+	// weights in sparse form.
+	// Throws std::invalid_argument if the net has convolutional
+	// layers.
+	auto prune(const NeuralNet & net, const PruningOptions & options) -> SparseNet;
+}
+
+#endif
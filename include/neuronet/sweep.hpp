@@ -0,0 +1,78 @@
+#ifndef NN_SWEEP_H
+#define NN_SWEEP_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+
+namespace utility {
+	class TrainingData;
+}
+
+namespace neuronet {
+	class NeuralNet;
+	class WorkerPool;
+
+	//========================================================
+	// Topology and hyperparameters of one model of a sweep.
+	// The input and output layers of the topology must match
+	// the training data.
+	//========================================================
+	struct SweepConfig {
+		std::vector<uint64_t> topology;
+		double training_rate = 0.15;
+		double momentum      = 0.5;
+	};
+
+	//========================================================
+	// Options of a sweep.
+	//
+	// epochs          - passes over the whole data set.
+	// record_interval - passes between the samples of the
+	//                   error curves; zero records once at
+	//                   the end of every epoch.
+	//========================================================
+	struct SweepOptions {
+		size_t epochs          = 1;
+		size_t record_interval = 0;
+	};
+
+	//========================================================
+	// Outcome of the training of one model of a sweep.
+	//
+	// error_curve - recent average error at every sample.
+	// seconds     - wall time of the training of this model.
+	// net         - the trained model.
+	//========================================================
+	struct SweepResult {
+		SweepConfig                config;
+		std::vector<double>        error_curve;
+		double                     seconds = 0.0;
+		std::unique_ptr<NeuralNet> net;
+	};
+
+	//========================================================
+	// Trains one model per config concurrently on the workers
+	// of the given pool. All models read the same data set,
+	// which is loaded and held once for the whole sweep.
+	// Workers pick up the next untrained model when they are
+	// done, so models of different sizes balance out.
+	//
+	// Throws std::invalid_argument if a topology does not
+	// match the data set; rethrows exceptions of trainings.
+	//========================================================
+	auto runSweep(
+		const utility::TrainingData     & data,
+		const std::vector<SweepConfig>  & configs,
+		const SweepOptions              & options,
+		WorkerPool                      & pool
+	) -> std::vector<SweepResult>;
+
+	// Writes one line per model with its hyperparameters,
+	// final error and wall time followed by its error curve.
+	void reportSweep(std::ostream & out, const std::vector<SweepResult> & results);
+}
+
+#endif
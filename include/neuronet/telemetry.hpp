@@ -0,0 +1,157 @@
+#ifndef NN_TELEMETRY_H
+#define NN_TELEMETRY_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+
+namespace neuronet {
+	class NeuralNet;
+
+	//========================================================
+	// A sample of the training telemetry.
+	//
+	// pass              - backPropagation calls recorded so
+	//                     far, including this one.
+	// seconds           - since the first recorded pass.
+	// error             - error of the pass, or the mean error
+	//                     of all passes of the window.
+	// smoothed_error    - recent average error of the net.
+	// passes_per_second - of the window; zero for passes.
+	// weight_norms      - Frobenius norm of the weight matrix
+	//                     of every layer after the input layer
+	//                     at the end of the window; empty for
+	//                     passes.
+	//========================================================
+	struct TelemetrySample {
+		enum class Kind {
+			pass,
+			window
+		};
+
+		Kind     kind              = Kind::pass;
+		uint64_t pass              = 0;
+		double   seconds           = 0.0;
+		double   error             = 0.0;
+		double   smoothed_error    = 0.0;
+		double   passes_per_second = 0.0;
+		std::vector<double> weight_norms;
+	};
+
+	// Writes the sample as a single line of JSON.
+	auto operator<<(std::ostream & os, const TelemetrySample & sample) -> std::ostream &;
+
+	//========================================================
+	// Options of the telemetry.
+	//
+	// capacity      - samples the ring buffer holds until they
+	//                 are drained; rounded up to a power of two.
+	// window        - passes summarized by every window sample.
+	// record_passes - records a sample for every pass on top
+	//                 of the window samples.
+	//========================================================
+	struct TelemetryOptions {
+		size_t capacity      = 4096;
+		size_t window        = 1000;
+		bool   record_passes = true;
+	};
+
+	//========================================================
+	// Telemetry of a neural net under training, attached with
+	// NeuralNet::setTelemetry.
+	//
+	// The training thread records samples into a bounded
+	// single producer single consumer ring buffer without
+	// locks or allocations once every slot has been used,
+	// and one monitoring thread at a time drains them. The
+	// trainer never waits for the monitor: samples arriving
+	// while the ring is full are dropped and counted.
+	//========================================================
+	class Telemetry {
+	public:
+		explicit Telemetry(const TelemetryOptions & options = TelemetryOptions{});
+		~Telemetry();
+
+		Telemetry(const Telemetry &) = delete;
+		Telemetry & operator=(const Telemetry &) = delete;
+
+		// Records the pass that just computed the given error.
+		// Called by the training thread.
+		void record(const NeuralNet & net, double error);
+
+		// Appends up to maxCount recorded samples, oldest first,
+		// and returns their number. Called by the monitor.
+		auto drain(std::vector<TelemetrySample> & samples, size_t maxCount = SIZE_MAX) -> size_t;
+
+		// Samples dropped because the ring was full.
+		auto countDropped() const -> uint64_t;
+
+		auto getOptions() const -> const TelemetryOptions &;
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct Ring;
+
+		void push(const TelemetrySample & sample);
+
+		TelemetryOptions      m_options;
+		std::unique_ptr<Ring> m_ring;
+		std::atomic<uint64_t> m_dropped;
+		// State of the training thread.
+		uint64_t          m_passes;
+		double            m_window_error;
+		Clock::time_point m_start;
+		Clock::time_point m_window_start;
+		TelemetrySample   m_sample;
+	};
+
+	//========================================================
+	// Drains a telemetry on its own thread every interval and
+	// writes its samples as lines of JSON to a target:
+	//   - "unix:<path>" connects to a unix domain stream socket
+	//     a collector listens on,
+	//   - anything else is a file the samples are appended to.
+	// Throws if the target can't be opened. If writing fails
+	// later on the exporter stops and getError reports why.
+	// Destruction writes the samples left in the telemetry.
+	//========================================================
+	class TelemetryExporter {
+	public:
+		TelemetryExporter(
+			std::shared_ptr<Telemetry> telemetry,
+			const std::string & target,
+			std::chrono::milliseconds interval = std::chrono::milliseconds{100});
+		~TelemetryExporter();
+
+		TelemetryExporter(const TelemetryExporter &) = delete;
+		TelemetryExporter & operator=(const TelemetryExporter &) = delete;
+
+		auto getError() const -> std::string;
+
+	private:
+		void run();
+		bool flush();
+
+		std::shared_ptr<Telemetry> m_telemetry;
+		std::chrono::milliseconds  m_interval;
+		int                        m_fd;
+		bool                       m_socket;
+		std::vector<TelemetrySample> m_samples;
+		mutable std::mutex      m_mutex;
+		std::condition_variable m_wakeup;
+		bool                    m_stopping;
+		std::string             m_error;
+		std::thread             m_thread;
+	};
+}
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef NN_WORKER_POOL_H
+#define NN_WORKER_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <ostream>
+#include <cstddef>
+
+namespace neuronet {
+	//========================================================
+	// Options of a worker pool.
+	//
+	// threads           - number of workers; all cpus that this
+	//                     process may run on if zero.
+	// placement         - how workers are pinned to cpus:
+	//     none    - workers are not pinned at all.
+	//     compact - fills up the cpus of one NUMA node before
+	//               the next node is used.
+	//     spread  - distributes workers round robin over the
+	//               NUMA nodes.
+	// replicate_weights - neural nets using the pool keep one
+	//                     copy of their weights per NUMA node
+	//                     for batched inference.
+	//========================================================
+	struct WorkerPoolOptions {
+		enum class Placement {
+			none,
+			compact,
+			spread
+		};
+
+		size_t    threads           = 0;
+		Placement placement         = Placement::compact;
+		bool      replicate_weights = false;
+	};
+
+	//========================================================
+	// A fixed set of worker threads pinned to cpus according
+	// to the NUMA topology of the host as found in sysfs.
+	//
+	// Memory a worker touches first is placed on its local
+	// node by the kernel, so all per worker buffers are
+	// allocated and initialized by the workers themselves.
+	//========================================================
+	class WorkerPool {
+	public:
+		explicit WorkerPool(const WorkerPoolOptions & options = WorkerPoolOptions{});
+		~WorkerPool();
+
+		WorkerPool(const WorkerPool &) = delete;
+		WorkerPool & operator=(const WorkerPool &) = delete;
+
+		auto size()       const -> size_t;
+		auto countNodes() const -> size_t;
+		auto getOptions() const -> const WorkerPoolOptions &;
+
+		// NUMA node and cpu of the given worker;
+		// the cpu is -1 if the worker is not pinned.
+		auto nodeOf(size_t worker) const -> size_t;
+		auto cpuOf(size_t worker)  const -> int;
+
+		// Runs task(worker) on the first count workers and waits
+		// until all of them are done. Calls from within a task of
+		// this pool run the tasks one after another on the caller.
+		void run(size_t count, const std::function<void(size_t)> & task);
+
+		// Splits [0, total) into count contiguous chunks and runs
+		// task(first, last, worker) for each of them.
+		void parallelFor(
+			size_t total, size_t count,
+			const std::function<void(size_t, size_t, size_t)> & task);
+
+		// Returns true if called from within a task of this pool.
+		bool runsOnWorker() const;
+
+		// Returns the slot-th scratch buffer of the given worker with
+		// at least count elements. Must only be called from within a
+		// task running on that worker, so that the buffer is placed
+		// on the node local to it.
+		auto scratch(size_t worker, size_t slot, size_t count) -> double *;
+
+		// Writes the NUMA topology and the chosen placement.
+		void describePlacement(std::ostream & out) const;
+
+	private:
+		struct Worker {
+			int    cpu;
+			size_t node;
+			std::vector<std::vector<double>> scratch;
+		};
+
+		void work(size_t worker);
+
+		WorkerPoolOptions   m_options;
+		size_t              m_count_nodes;
+		std::vector<Worker> m_workers;
+		std::vector<std::thread> m_threads;
+
+		std::mutex              m_run_mutex;
+		std::mutex              m_mutex;
+		std::condition_variable m_start;
+		std::condition_variable m_done;
+		const std::function<void(size_t)> * m_task;
+		size_t m_count_active;
+		size_t m_count_running;
+		size_t m_generation;
+		bool   m_stopped;
+	};
+}
+
+#endif
@@ -0,0 +1,177 @@
+#ifndef NN_COMPRESSED_TRAINING_DATA_H
+#define NN_COMPRESSED_TRAINING_DATA_H
+
+#include <vector>
+#include <future>
+#include <cstdint>
+#include <cstddef>
+
+#include "utility/training_data.hpp"
+#include "utility/training_stream.hpp"
+
+namespace utility {
+	//========================================================
+	// Options of the compressed storage of training data.
+	//
+	// block_passes      - passes encoded together; every
+	//                     column of a block picks its own
+	//                     encoding.
+	// quantization_bits - 0 keeps all values exactly. 8 or
+	//                     16 lets a column be quantized to
+	//                     that many bits over its range within
+	//                     the block if that takes at most half
+	//                     the bytes of its exact encoding.
+	//========================================================
+	struct CompressionOptions {
+		size_t block_passes      = 4096;
+		size_t quantization_bits = 0;
+	};
+
+	//========================================================
+	// Training data held in memory in compressed form and
+	// decoded on demand, pass range by pass range, into
+	// buffers of the caller.
+	//
+	// Every input and expected value is a column. Within a
+	// block of passes a column is stored exactly, whichever
+	// takes fewest bytes, as
+	//   - a single value if it is constant,
+	//   - 8 or 16 bit codes into a dictionary of its distinct
+	//     values if there are at most 256 or 65536 of them,
+	//   - doubles,
+	// or as 8 or 16 bit codes quantized over its range if the
+	// options allow it. Low cardinality data like 0/1 or -1/+1
+	// values thus takes a byte per value or less instead of
+	// eight plus the vectors of a TrainingPass.
+	//========================================================
+	class CompressedTrainingData {
+	public:
+		class Reader;
+
+		// Throws std::invalid_argument for invalid options.
+		explicit CompressedTrainingData(
+			const TrainingData & data,
+			const CompressionOptions & options = CompressionOptions{});
+
+		// Reads all passes of the given stream, keeping no more
+		// than one block of them uncompressed. Throws like
+		// TrainingStream::next.
+		explicit CompressedTrainingData(
+			TrainingStream & stream,
+			const CompressionOptions & options = CompressionOptions{});
+
+		auto getTopology() const -> const std::vector<uint64_t> &;
+		auto countPasses() const -> size_t;
+
+		// Decodes count passes starting with pass first. The
+		// input and expected values of the passes are written
+		// one pass after another, as NeuralNet::feedForwardBatch
+		// reads them.
+		void decode(size_t first, size_t count, double * inputValues, double * expectedValues) const;
+
+		auto memoryUsage() const -> DatasetMemoryUsage;
+
+	private:
+		enum class Encoding : uint8_t {
+			constant,
+			dictionary8,
+			dictionary16,
+			quantized8,
+			quantized16,
+			raw
+		};
+
+		//====================================================================
+		// Encoding of a column within a block: its codes start at offset
+		// within the bytes of the block and its dictionary at dictionary
+		// within the dictionary values of the block; quantized codes c
+		// stand for base + c * scale.
+		//====================================================================
+		struct Column {
+			Encoding encoding;
+			uint32_t offset;
+			uint32_t dictionary;
+			double   base;
+			double   scale;
+		};
+
+		struct Block {
+			size_t               first;
+			size_t               count;
+			std::vector<Column>  columns;
+			std::vector<uint8_t> bytes;
+			std::vector<double>  dictionary;
+		};
+
+		void initialize(const std::vector<uint64_t> & topology);
+
+		// Encodes count passes of the given values, stored column
+		// after column, as a new block.
+		void encodeBlock(const double * values, size_t count);
+
+		void decodeBlock(
+			const Block & block, size_t first, size_t count,
+			double * inputValues, double * expectedValues) const;
+
+		CompressionOptions    m_options;
+		std::vector<uint64_t> m_topology;
+		size_t                m_count_inputs;
+		size_t                m_count_expected;
+		size_t                m_count_passes;
+		std::vector<Block>    m_blocks;
+	};
+
+	//========================================================
+	// Walks compressed training data batch by batch with two
+	// buffers: with prefetch, while the caller trains on the
+	// current batch the next one is decoded on another thread,
+	// hiding the decoding behind the forward passes. Starting
+	// that thread costs about as much as decoding a batch of
+	// narrow passes, so without spare cpus batches are better
+	// decoded by next itself.
+	//
+	// The data must outlive the reader.
+	//========================================================
+	class CompressedTrainingData::Reader {
+	public:
+		explicit Reader(
+			const CompressedTrainingData & data,
+			size_t batchPasses = 1024,
+			bool   prefetch    = true);
+		~Reader();
+
+		Reader(const Reader &) = delete;
+		Reader & operator=(const Reader &) = delete;
+
+		// Makes the next batch current and returns its number of
+		// passes, zero after the last one.
+		auto next() -> size_t;
+
+		// Starts over with the first pass.
+		void rewind();
+
+		// Values of the passes of the current batch, pass after
+		// pass.
+		auto getInputValues()    const -> const double *;
+		auto getExpectedValues() const -> const double *;
+
+	private:
+		struct Buffer {
+			std::vector<double> inputs;
+			std::vector<double> expected;
+			size_t              count = 0;
+		};
+
+		void decodeNext();
+
+		const CompressedTrainingData & m_data;
+		size_t            m_batch_passes;
+		bool              m_prefetch;
+		size_t            m_next_pass;
+		Buffer            m_current;
+		Buffer            m_pending;
+		std::future<void> m_decoding;
+	};
+}
+
+#endif
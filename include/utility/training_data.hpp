@@ -4,8 +4,27 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <cstddef>
 
 namespace utility {
+	//========================================================
+	// Bytes allocated by a data set.
+	//
+	// payload            - the input and expected values.
+	// container_overhead - the topology, pass objects with
+	//                      their vector headers and unused
+	//                      capacity of all vectors.
+	// allocations        - number of heap blocks; allocators
+	//                      add their own overhead per block.
+	//========================================================
+	struct DatasetMemoryUsage {
+		size_t payload            = 0;
+		size_t container_overhead = 0;
+		size_t allocations        = 0;
+
+		auto total() const -> size_t;
+	};
+
 	class TrainingPass {
 	public:
 		explicit TrainingPass(
@@ -15,6 +34,10 @@ namespace utility {
 		auto getInputValues()    const -> const std::vector<double> &;
 		auto getExpectedValues() const -> const std::vector<double> &;
 
+		// Memory of the values of this pass excluding the
+		// pass object itself.
+		auto memoryUsage() const -> DatasetMemoryUsage;
+
 	private:
 		std::vector<double> m_input;
 		std::vector<double> m_expected;
@@ -66,6 +89,8 @@ namespace utility {
 
 		auto getTopology() const -> const std::vector<uint64_t> &;
 
+		auto memoryUsage() const -> DatasetMemoryUsage;
+
 		//====================================================================
 		// Implementing forward iterator access to internal vector
 		// to enable range based for loop for instances of this class.
@@ -0,0 +1,52 @@
+#ifndef NN_TRAINING_STREAM_H
+#define NN_TRAINING_STREAM_H
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <cstdint>
+#include <cstddef>
+
+namespace utility {
+	//========================================================
+	// Reads training passes one by one from a stream in the
+	// format of TrainingData files, e.g. from stdin or a fifo
+	// that producers keep writing to.
+	//
+	// Unlike TrainingData no pass is kept: every pass is
+	// parsed into buffers of the caller and the only memory
+	// held is the current line.
+	//========================================================
+	class TrainingStream {
+	public:
+		// Reads the topology line of the given stream.
+		// Throws std::invalid_argument if it is missing.
+		explicit TrainingStream(std::istream & input);
+
+		auto getTopology() const -> const std::vector<uint64_t> &;
+
+		// Reads the next pass into the given buffers that hold
+		// as many values as the input and the output layer of
+		// the topology have neurons.
+		// Blocks until a pass is complete and returns false at
+		// the end of the stream.
+		//
+		// Throws std::invalid_argument if the pass does not meet
+		// the format or has the wrong amount of values.
+		bool next(double * inputValues, double * expectedValues);
+
+		auto countPasses() const -> size_t;
+
+	private:
+		bool nextLine();
+		void parseValues(const char * keyword, size_t count, double * values);
+
+		std::istream        & m_input;
+		std::string           m_line;
+		size_t                m_line_number = 0;
+		size_t                m_count_passes = 0;
+		std::vector<uint64_t> m_topology;
+	};
+}
+
+#endif
@@ -1,7 +1,16 @@
 #include <cstddef>
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
+#include <fstream>
 #include <cassert>
 #include <chrono>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <memory>
+#include <random>
+#include <thread>
 
 #include <vector>
 
@@ -9,8 +18,21 @@
 #include "neuronet/neural_layer.hpp"
 #include "neuronet/neural_net.hpp"
 #include "neuronet/neuron.hpp"
+#include "neuronet/inference_server.hpp"
+#include "neuronet/worker_pool.hpp"
+#include "neuronet/differential_check.hpp"
+#include "neuronet/header_export.hpp"
+#include "neuronet/online_trainer.hpp"
+#include "neuronet/sweep.hpp"
+#include "neuronet/profiler.hpp"
+#include "neuronet/autotune.hpp"
+#include "neuronet/telemetry.hpp"
+#include "neuronet/parameter_server.hpp"
+#include "neuronet/sparse_net.hpp"
 
 #include "utility/training_data.hpp"
+#include "utility/training_stream.hpp"
+#include "utility/compressed_training_data.hpp"
 #include "utility/print_vector.hpp"
 
 neuronet::NeuralNet constructNeuralNet(const std::vector<uint64_t> & topology) {
@@ -20,25 +42,124 @@ neuronet::NeuralNet constructNeuralNet(const std::vector<uint64_t> & topology) {
 	return net3;
 }
 
-int main(int argc, const char ** argv) {
-	if (argc < 2) throw std::runtime_error{"too few parameters passed to program!"};
-	auto data = utility::TrainingData{argv[1]};
-	auto net  = neuronet::NeuralNet{data.getTopology()};
-	std::cout << "Input Topology = " << data.getTopology() << '\n' << '\n';
+//========================================================
+// Parses the fields of a convolution separated by commas
+// in their order of declaration; the strides and paddings
+// may be left out.
+//========================================================
+auto parseConvolution(const std::string & spec) -> neuronet::Convolution {
+	auto convolution = neuronet::Convolution{};
+	size_t * fields[] = {
+		&convolution.layer,
+		&convolution.input_channels, &convolution.input_height, &convolution.input_width,
+		&convolution.channels, &convolution.kernel_height, &convolution.kernel_width,
+		&convolution.stride_height, &convolution.stride_width,
+		&convolution.padding_height, &convolution.padding_width
+	};
+	auto stream = std::istringstream{spec};
+	auto count  = size_t{0};
+	for (auto field : fields) {
+		if (!(stream >> *field)) break;
+		++count;
+		if (stream.peek() == ',') stream.ignore();
+	}
+	if ((count != 7 && count != 11) || !stream.eof()) {
+		throw std::invalid_argument{"invalid convolution: " + spec};
+	}
+	return convolution;
+}
+
+//========================================================
+// neuronet <training-data> [model] [--profile] [--compile]
+//                          [--convolution <fields>]...
+//                          [--compress] [--quantize 8|16]
+//
+// Trains a new neural net with the given training data
+// and writes the trained model to the optional path.
+// --profile reports hardware counters of the forward pass
+// of every layer and of the backpropagation phases.
+// --compile trains with the execution plan of the net.
+// --convolution makes a layer of the topology of the
+// training data a convolutional layer, e.g. 1,1,28,28,8,5,5
+// for a layer of 8 kernels of 5x5 over a 28x28 image; see
+// parseConvolution.
+// --compress keeps the training data compressed in memory
+// and decodes it batch by batch while training; --quantize
+// additionally lets it quantize columns with many distinct
+// values to the given number of bits.
+//========================================================
+int train(int argc, const char ** argv) {
+	using namespace std::string_literals;
+	auto profiling    = false;
+	auto compiling    = false;
+	auto compressing  = false;
+	auto compression  = utility::CompressionOptions{};
+	auto convolutions = std::vector<neuronet::Convolution>{};
+	for (; argc >= 3; --argc) {
+		if      (argv[argc - 1] == "--profile"s)  profiling   = true;
+		else if (argv[argc - 1] == "--compile"s)  compiling   = true;
+		else if (argv[argc - 1] == "--compress"s) compressing = true;
+		else if (argc >= 4 && argv[argc - 2] == "--convolution"s) {
+			convolutions.insert(convolutions.begin(), parseConvolution(argv[argc - 1]));
+			--argc;
+		}
+		else if (argc >= 4 && argv[argc - 2] == "--quantize"s) {
+			compressing = true;
+			compression.quantization_bits = std::stoul(argv[argc - 1]);
+			--argc;
+		}
+		else break;
+	}
+	auto data       = std::unique_ptr<utility::TrainingData>{};
+	auto compressed = std::unique_ptr<utility::CompressedTrainingData>{};
+	if (compressing) {
+		std::ifstream file{argv[1]};
+		utility::TrainingStream stream{file};
+		compressed = std::make_unique<utility::CompressedTrainingData>(stream, compression);
+	}
+	else {
+		data = std::make_unique<utility::TrainingData>(argv[1]);
+	}
+	const auto& topology = compressed != nullptr ? compressed->getTopology() : data->getTopology();
+	auto net  = neuronet::NeuralNet{topology, convolutions};
+	auto profiler = profiling ? std::make_shared<neuronet::Profiler>() : nullptr;
+	net.setProfiler(profiler);
+	if (compiling) net.compile();
+	std::cout << "Input Topology = " << topology << '\n' << '\n';
+	if (compressed != nullptr) {
+		const auto values = compressed->countPasses() * (topology.front() + topology.back());
+		std::cout << "Compressed " << compressed->countPasses() << " passes of "
+		          << values * sizeof(double) << " bytes to "
+		          << compressed->memoryUsage().total() << " bytes\n\n";
+	}
 	//auto net = constructNeuralNet(data.getTopology()); // doesn't seem to work ... :/
 
 	const auto start = std::chrono::steady_clock::now();
 
-	for (auto i = 0u; i < 1; ++i) {
-		for (auto&& pass : data) {
-			//std::cout << "InputValues    = " << pass.getInputValues() << '\n';
-			//std::cout << "ExpectedValues = " << pass.getExpectedValues() << '\n';
-			net.feedForward(pass.getInputValues());
-			net.backPropagation(pass.getExpectedValues());
-			//auto results = net.results();
-			//std::cout << "Results        = " << results << '\n';
-			//std::cout << "Recent average error = " << net.getRecentAverageError() << "\n";
-			//std::cout << "Passes: " << ++i << '\n';
+	if (compressed != nullptr) {
+		const auto countInputs   = topology.front();
+		const auto countExpected = topology.back();
+		const auto prefetch = std::thread::hardware_concurrency() > 1;
+		utility::CompressedTrainingData::Reader reader{*compressed, 1024, prefetch};
+		while (const auto count = reader.next()) {
+			for (auto pass = size_t{0}; pass < count; ++pass) {
+				net.feedForward(reader.getInputValues() + pass * countInputs, countInputs);
+				net.backPropagation(reader.getExpectedValues() + pass * countExpected, countExpected);
+			}
+		}
+	}
+	else {
+		for (auto i = 0u; i < 1; ++i) {
+			for (auto&& pass : *data) {
+				//std::cout << "InputValues    = " << pass.getInputValues() << '\n';
+				//std::cout << "ExpectedValues = " << pass.getExpectedValues() << '\n';
+				net.feedForward(pass.getInputValues());
+				net.backPropagation(pass.getExpectedValues());
+				//auto results = net.results();
+				//std::cout << "Results        = " << results << '\n';
+				//std::cout << "Recent average error = " << net.getRecentAverageError() << "\n";
+				//std::cout << "Passes: " << ++i << '\n';
+			}
 		}
 	}
 
@@ -47,5 +168,479 @@ int main(int argc, const char ** argv) {
 	std::cout << "\ttime required: " <<
 		std::chrono::duration<double, std::milli>(diff).count() << '\n';
 
+	if (profiling) profiler->report(std::cout);
+
+	if (argc >= 3) {
+		std::ofstream model{argv[2]};
+		net.save(model);
+	}
+
+	return 0;
+}
+
+//========================================================
+// neuronet serve <model> [--socket <path>]
+//                        [--max-batch <n>]
+//                        [--max-latency-us <n>]
+//                        [--threads <n>]
+//                        [--placement none|compact|spread]
+//                        [--replicate-weights yes|no]
+//                        [--autotune <cache-file>]
+//
+// Serves the given model on stdin/stdout or on a unix
+// domain socket and reports the statistics of every batch
+// on stderr. With more than one thread batches are split
+// among the workers of a NUMA aware worker pool whose
+// placement is reported on stderr.
+// --autotune picks the engine, block sizes and workers of
+// every layer for batches of the maximum size, reusing the
+// choices stored in the cache file by earlier runs.
+//========================================================
+int serve(int argc, const char ** argv) {
+	using namespace std::string_literals;
+	if (argc < 3) throw std::runtime_error{"serve requires the path to a model!"};
+	using Placement = neuronet::WorkerPoolOptions::Placement;
+	auto options     = neuronet::ServerOptions{};
+	auto poolOptions = neuronet::WorkerPoolOptions{};
+	auto tuneCache   = ""s;
+	poolOptions.threads = 1;
+	options.report      = &std::cerr;
+	for (auto i = 3; i + 1 < argc; i += 2) {
+		if      (argv[i] == "--socket"s)         options.socket_path    = argv[i + 1];
+		else if (argv[i] == "--max-batch"s)      options.max_batch_size = std::stoul(argv[i + 1]);
+		else if (argv[i] == "--max-latency-us"s) options.max_latency    = std::chrono::microseconds{std::stol(argv[i + 1])};
+		else if (argv[i] == "--threads"s)        poolOptions.threads    = std::stoul(argv[i + 1]);
+		else if (argv[i] == "--placement"s) {
+			if      (argv[i + 1] == "none"s)    poolOptions.placement = Placement::none;
+			else if (argv[i + 1] == "compact"s) poolOptions.placement = Placement::compact;
+			else if (argv[i + 1] == "spread"s)  poolOptions.placement = Placement::spread;
+			else throw std::runtime_error{"unknown placement: "s + argv[i + 1]};
+		}
+		else if (argv[i] == "--replicate-weights"s) poolOptions.replicate_weights = argv[i + 1] == "yes"s;
+		else if (argv[i] == "--autotune"s) tuneCache = argv[i + 1];
+		else throw std::runtime_error{"unknown option passed to serve: "s + argv[i]};
+	}
+	std::ifstream model{argv[2]};
+	if (!model) throw std::runtime_error{"can't open the model: "s + argv[2]};
+	auto net = neuronet::NeuralNet{model};
+	net.setEngine(neuronet::NeuralLayer::Engine::blocked);
+	if (poolOptions.threads != 1) {
+		auto pool = std::make_shared<neuronet::WorkerPool>(poolOptions);
+		pool->describePlacement(std::cerr);
+		net.setWorkerPool(std::move(pool));
+	}
+	if (!tuneCache.empty()) {
+		auto tuneOptions = neuronet::AutotuneOptions{};
+		tuneOptions.workload   = neuronet::AutotuneOptions::Workload::batch;
+		tuneOptions.batch_size = options.max_batch_size;
+		tuneOptions.cache_path = tuneCache;
+		std::cerr << neuronet::autotune(net, tuneOptions);
+	}
+	neuronet::InferenceServer server{net, options};
+	server.run();
+	return 0;
+}
+
+//========================================================
+// neuronet evaluate <model> <data> [--threads <n>]
+//                                  [--batch <n>]
+//                                  [--confusion yes|no]
+//                                  [--threshold <x>]
+//
+// Reports the errors of the given model on the given data
+// set without training it and, with --confusion yes, its
+// accuracy and confusion matrix. With more than one thread
+// the batches are split among the workers of a worker
+// pool.
+//========================================================
+int evaluate(int argc, const char ** argv) {
+	using namespace std::string_literals;
+	if (argc < 4) throw std::runtime_error{"evaluate requires the paths to a model and a data set!"};
+	auto options     = neuronet::EvaluationOptions{};
+	auto poolOptions = neuronet::WorkerPoolOptions{};
+	poolOptions.threads = 1;
+	for (auto i = 4; i + 1 < argc; i += 2) {
+		if      (argv[i] == "--threads"s)   poolOptions.threads = std::stoul(argv[i + 1]);
+		else if (argv[i] == "--batch"s)     options.batch_size  = std::stoul(argv[i + 1]);
+		else if (argv[i] == "--confusion"s) options.confusion   = argv[i + 1] == "yes"s;
+		else if (argv[i] == "--threshold"s) options.threshold   = std::stod(argv[i + 1]);
+		else throw std::runtime_error{"unknown option passed to evaluate: "s + argv[i]};
+	}
+	std::ifstream model{argv[2]};
+	if (!model) throw std::runtime_error{"can't open the model: "s + argv[2]};
+	auto net = neuronet::NeuralNet{model};
+	net.setEngine(neuronet::NeuralLayer::Engine::blocked);
+	if (poolOptions.threads != 1) {
+		net.setWorkerPool(std::make_shared<neuronet::WorkerPool>(poolOptions));
+	}
+	const auto data = utility::TrainingData{argv[3]};
+	std::cout << net.evaluate(data, options);
+	return 0;
+}
+
+//========================================================
+// neuronet verify [--seed <n>] [--cases <n>]
+//                 [--passes <n>] [--max-ulps <n>]
+//                 [--rel-tol <x>] [--abs-tol <x>]
+//
+// Runs random topologies through the reference engine and
+// every optimized path and exits with 1 reporting the
+// first mismatch and its seed if they disagree.
+//========================================================
+int verify(int argc, const char ** argv) {
+	using namespace std::string_literals;
+	auto options = neuronet::DifferentialOptions{};
+	for (auto i = 2; i + 1 < argc; i += 2) {
+		if      (argv[i] == "--seed"s)     options.seed               = std::stoull(argv[i + 1]);
+		else if (argv[i] == "--cases"s)    options.cases              = std::stoul(argv[i + 1]);
+		else if (argv[i] == "--passes"s)   options.passes             = std::stoul(argv[i + 1]);
+		else if (argv[i] == "--max-ulps"s) options.max_ulps           = std::stoull(argv[i + 1]);
+		else if (argv[i] == "--rel-tol"s)  options.relative_tolerance = std::stod(argv[i + 1]);
+		else if (argv[i] == "--abs-tol"s)  options.absolute_tolerance = std::stod(argv[i + 1]);
+		else throw std::runtime_error{"unknown option passed to verify: "s + argv[i]};
+	}
+	const auto result = neuronet::runDifferentialCheck(options, &std::cout);
+	std::cout << result << '\n';
+	return result.passed ? 0 : 1;
+}
+
+//========================================================
+// neuronet export <model> <header> [--namespace <name>]
+//
+// Writes a standalone C++ header with a constexpr copy of
+// the weights of the given model and a predict function
+// that does not depend on this library.
+//========================================================
+int exportHeader(int argc, const char ** argv) {
+	using namespace std::string_literals;
+	if (argc < 4) throw std::runtime_error{"export requires the paths to a model and a header!"};
+	auto options = neuronet::HeaderExportOptions{};
+	for (auto i = 4; i + 1 < argc; i += 2) {
+		if (argv[i] == "--namespace"s) options.name_space = argv[i + 1];
+		else throw std::runtime_error{"unknown option passed to export: "s + argv[i]};
+	}
+	std::ifstream model{argv[2]};
+	if (!model) throw std::runtime_error{"can't open the model: "s + argv[2]};
+	const auto net = neuronet::NeuralNet{model};
+	std::ofstream header{argv[3]};
+	if (!header) throw std::runtime_error{"can't create the header: "s + argv[3]};
+	neuronet::exportInferenceHeader(net, header, options);
+	return 0;
+}
+
+//========================================================
+// neuronet prune <model> [--threshold <x> | --top-k <n>]
+//                        [--samples <n>]
+//
+// Prunes the given model by the magnitude of its weights
+// and reports the non-zero weights, the bytes and the time
+// per sample of the dense and the sparse forward pass on
+// random inputs. Without options weights below 0.01 are
+// dropped.
+//========================================================
+int pruneModel(int argc, const char ** argv) {
+	using namespace std::string_literals;
+	using Strategy = neuronet::PruningOptions::Strategy;
+	if (argc < 3) throw std::runtime_error{"prune requires the path to a model!"};
+	auto options = neuronet::PruningOptions{};
+	auto samples = size_t{10000};
+	options.threshold = 0.01;
+	for (auto i = 3; i + 1 < argc; i += 2) {
+		if (argv[i] == "--threshold"s) {
+			options.strategy  = Strategy::threshold;
+			options.threshold = std::stod(argv[i + 1]);
+		}
+		else if (argv[i] == "--top-k"s) {
+			options.strategy        = Strategy::top_k;
+			options.keep_per_neuron = std::stoul(argv[i + 1]);
+		}
+		else if (argv[i] == "--samples"s) samples = std::stoul(argv[i + 1]);
+		else throw std::runtime_error{"unknown option passed to prune: "s + argv[i]};
+	}
+	if (samples == 0) throw std::runtime_error{"prune needs at least one sample!"};
+	std::ifstream model{argv[2]};
+	if (!model) throw std::runtime_error{"can't open the model: "s + argv[2]};
+	auto net = neuronet::NeuralNet{model};
+	net.setEngine(neuronet::NeuralLayer::Engine::blocked);
+	auto sparse = neuronet::prune(net, options);
+
+	auto random = std::mt19937_64{1};
+	auto value  = std::uniform_real_distribution<double>{-1.0, 1.0};
+	auto inputs = std::vector<std::vector<double>>(std::min<size_t>(samples, 256));
+	for (auto& input : inputs) {
+		input.resize(net.getLayers().front().size());
+		for (auto& x : input) x = value(random);
+	}
+	// Returns the seconds per sample of the given forward pass.
+	const auto time = [&](auto && feedForward) {
+		const auto start = std::chrono::steady_clock::now();
+		for (auto sample = size_t{0}; sample < samples; ++sample) {
+			feedForward(inputs[sample % inputs.size()]);
+		}
+		const auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double>(end - start).count() / samples;
+	};
+	const auto denseTime  = time([&](const std::vector<double> & input) { net.feedForward(input); });
+	const auto sparseTime = time([&](const std::vector<double> & input) { sparse.feedForward(input); });
+
+	auto denseWeights = size_t{0};
+	for (auto l = size_t{1}; l < net.getLayers().size(); ++l) {
+		denseWeights += net.getLayers()[l].size() * net.getLayers()[l - 1].size();
+	}
+	std::cout << "dense:  " << denseWeights << " weights, "
+	          << net.memoryUsage().total().total() << " bytes, "
+	          << denseTime * 1.0e6 << " us per sample\n"
+	          << "sparse: " << sparse.countNonZeros() << " weights, "
+	          << sparse.memoryUsage().total() << " bytes, "
+	          << sparseTime * 1.0e6 << " us per sample ("
+	          << neuronet::describeSparseGemv() << ")\n";
+	return 0;
+}
+
+//========================================================
+// neuronet stream <model> [--initial <model>]
+//                         [--buffer <n>] [--replays <n>]
+//                         [--publish-every <n>]
+//                         [--seed <n>]
+//                         [--smoothing <passes>]
+//                         [--telemetry <file|unix:path>]
+//                         [--telemetry-window <passes>]
+//
+// Trains on the passes arriving on stdin in the format of
+// training data files and periodically publishes the model
+// to the given path. Every publication replaces the model
+// file atomically so readers never see a partial model.
+// --telemetry streams one JSON line per window of passes
+// with the error, throughput and weight norms to a file or
+// to a collector listening on a unix domain socket.
+//========================================================
+int stream(int argc, const char ** argv) {
+	using namespace std::string_literals;
+	if (argc < 3) throw std::runtime_error{"stream requires the path to publish the model to!"};
+	auto options = neuronet::OnlineTrainingOptions{};
+	auto initial = ""s;
+	auto target  = ""s;
+	auto smoothing        = 0.0;
+	auto telemetryOptions = neuronet::TelemetryOptions{};
+	telemetryOptions.record_passes = false;
+	for (auto i = 3; i + 1 < argc; i += 2) {
+		if      (argv[i] == "--initial"s)       initial                  = argv[i + 1];
+		else if (argv[i] == "--smoothing"s)     smoothing                = std::stod(argv[i + 1]);
+		else if (argv[i] == "--telemetry"s)     target                   = argv[i + 1];
+		else if (argv[i] == "--telemetry-window"s) telemetryOptions.window = std::stoul(argv[i + 1]);
+		else if (argv[i] == "--buffer"s)        options.buffer_capacity  = std::stoul(argv[i + 1]);
+		else if (argv[i] == "--replays"s)       options.replays          = std::stoul(argv[i + 1]);
+		else if (argv[i] == "--publish-every"s) options.publish_interval = std::stoul(argv[i + 1]);
+		else if (argv[i] == "--seed"s)          options.seed             = std::stoull(argv[i + 1]);
+		else throw std::runtime_error{"unknown option passed to stream: "s + argv[i]};
+	}
+	const auto path = std::string{argv[2]};
+	options.publish = [&path](const neuronet::NeuralNet & net, const neuronet::OnlineTrainingStats & stats) {
+		const auto temporary = path + ".tmp";
+		{
+			std::ofstream model{temporary};
+			if (!model) throw std::runtime_error{"can't create the model: "s + temporary};
+			net.save(model);
+		}
+		if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+			throw std::runtime_error{"can't publish the model to: "s + path};
+		}
+		std::cerr << "published after " << stats.passes_read << " passes read and "
+		          << stats.passes_trained << " trained, recent average error "
+		          << stats.recent_average_error << '\n';
+	};
+
+	auto data = utility::TrainingStream{std::cin};
+	auto net  = std::unique_ptr<neuronet::NeuralNet>{};
+	if (initial.empty()) {
+		net = std::make_unique<neuronet::NeuralNet>(data.getTopology());
+	}
+	else {
+		std::ifstream model{initial};
+		if (!model) throw std::runtime_error{"can't open the model: "s + initial};
+		net = std::make_unique<neuronet::NeuralNet>(model);
+	}
+	net->setErrorSmoothing(smoothing);
+	auto exporter = std::unique_ptr<neuronet::TelemetryExporter>{};
+	if (!target.empty()) {
+		auto telemetry = std::make_shared<neuronet::Telemetry>(telemetryOptions);
+		net->setTelemetry(telemetry);
+		exporter = std::make_unique<neuronet::TelemetryExporter>(telemetry, target);
+	}
+	auto trainer = neuronet::OnlineTrainer{*net, std::move(options)};
+	trainer.train(data);
+	return 0;
+}
+
+// Parses a comma separated list like "0.1,0.15,0.2".
+template <typename T, typename Parse>
+auto parseList(const std::string & text, Parse parse)
+	-> std::vector<T>
+{
+	auto values = std::vector<T>{};
+	auto first  = size_t{0};
+	while (first <= text.size()) {
+		const auto last = std::min(text.find(',', first), text.size());
+		values.push_back(parse(text.substr(first, last - first)));
+		first = last + 1;
+	}
+	return values;
+}
+
+//========================================================
+// neuronet sweep <training-data> [--epochs <n>]
+//                                [--threads <n>]
+//                                [--record-every <n>]
+//                                [--hidden <n1,n2,...>]...
+//                                [--eta <x1,x2,...>]
+//                                [--alpha <x1,x2,...>]
+//
+// Loads the training data once and trains one model for
+// every combination of hidden layers, training rate and
+// momentum concurrently. --hidden may be repeated, 0 means
+// no hidden layers; the hidden layers of the training data
+// are used if it is not given.
+//========================================================
+int sweep(int argc, const char ** argv) {
+	using namespace std::string_literals;
+	if (argc < 3) throw std::runtime_error{"sweep requires the path to training data!"};
+	const auto parseCount  = [](const std::string & text) { return static_cast<uint64_t>(std::stoull(text)); };
+	const auto parseDouble = [](const std::string & text) { return std::stod(text); };
+	auto options     = neuronet::SweepOptions{};
+	auto poolOptions = neuronet::WorkerPoolOptions{};
+	auto hidden      = std::vector<std::vector<uint64_t>>{};
+	auto etas        = std::vector<double>{0.15};
+	auto alphas      = std::vector<double>{0.5};
+	for (auto i = 3; i + 1 < argc; i += 2) {
+		if      (argv[i] == "--epochs"s)       options.epochs          = std::stoul(argv[i + 1]);
+		else if (argv[i] == "--threads"s)      poolOptions.threads     = std::stoul(argv[i + 1]);
+		else if (argv[i] == "--record-every"s) options.record_interval = std::stoul(argv[i + 1]);
+		else if (argv[i] == "--eta"s)          etas                    = parseList<double>(argv[i + 1], parseDouble);
+		else if (argv[i] == "--alpha"s)        alphas                  = parseList<double>(argv[i + 1], parseDouble);
+		else if (argv[i] == "--hidden"s) {
+			auto layers = parseList<uint64_t>(argv[i + 1], parseCount);
+			if (layers == std::vector<uint64_t>{0}) layers.clear();
+			hidden.push_back(std::move(layers));
+		}
+		else throw std::runtime_error{"unknown option passed to sweep: "s + argv[i]};
+	}
+
+	const auto parseStart = std::chrono::steady_clock::now();
+	const auto data = utility::TrainingData{argv[2]};
+	const auto parseTime = std::chrono::steady_clock::now() - parseStart;
+	const auto& topology = data.getTopology();
+	if (hidden.empty()) {
+		hidden.emplace_back(topology.begin() + 1, topology.end() - 1);
+	}
+	auto configs = std::vector<neuronet::SweepConfig>{};
+	for (auto& layers : hidden) {
+		for (auto eta : etas) {
+			for (auto alpha : alphas) {
+				auto config = neuronet::SweepConfig{};
+				config.topology.push_back(topology.front());
+				config.topology.insert(config.topology.end(), layers.begin(), layers.end());
+				config.topology.push_back(topology.back());
+				config.training_rate = eta;
+				config.momentum      = alpha;
+				configs.push_back(std::move(config));
+			}
+		}
+	}
+
+	neuronet::WorkerPool pool{poolOptions};
+	const auto start   = std::chrono::steady_clock::now();
+	const auto results = neuronet::runSweep(data, configs, options, pool);
+	const auto end     = std::chrono::steady_clock::now();
+	neuronet::reportSweep(std::cout, results);
+	std::cout << configs.size() << " models on " << pool.size() << " threads"
+	          << ", parse time " << std::chrono::duration<double, std::milli>(parseTime).count() << " ms"
+	          << ", wall time " << std::chrono::duration<double, std::milli>(end - start).count() << " ms\n";
 	return 0;
 }
+
+//========================================================
+// neuronet ps-server <training-data> <model>
+//                    --listen <unix:path|host:port>
+//                    [--workers <n>]
+//
+// Creates a neural net of the topology of the training data,
+// serves its weights to the given number of training workers
+// and writes the trained model once all of them are done.
+//========================================================
+int parameterServer(int argc, const char ** argv) {
+	using namespace std::string_literals;
+	if (argc < 4) throw std::runtime_error{"ps-server requires the paths to training data and a model!"};
+	auto options = neuronet::ParameterServerOptions{};
+	options.report = &std::cerr;
+	for (auto i = 4; i + 1 < argc; i += 2) {
+		if      (argv[i] == "--listen"s)  options.address = argv[i + 1];
+		else if (argv[i] == "--workers"s) options.workers = std::stoul(argv[i + 1]);
+		else throw std::runtime_error{"unknown option passed to ps-server: "s + argv[i]};
+	}
+	const auto data = utility::TrainingData{argv[2]};
+	auto net = neuronet::NeuralNet{data.getTopology()};
+	neuronet::ParameterServer server{net, options};
+	const auto start = std::chrono::steady_clock::now();
+	const auto stats = server.run();
+	const auto end   = std::chrono::steady_clock::now();
+	std::cerr << stats.pushes << " pushes of " << stats.passes << " passes, "
+	          << stats.bytes_received << " bytes received, " << stats.bytes_sent << " bytes sent in "
+	          << std::chrono::duration<double, std::milli>(end - start).count() << " ms\n";
+	std::ofstream model{argv[3]};
+	if (!model) throw std::runtime_error{"can't create the model: "s + argv[3]};
+	net.save(model);
+	return 0;
+}
+
+//========================================================
+// neuronet ps-worker <training-data>
+//                    --connect <unix:path|host:port>
+//                    [--shard <i>] [--shards <n>]
+//                    [--epochs <n>] [--batch <n>]
+//                    [--compression none|fp16|bf16]
+//
+// Trains on every shards-th pass of the training data
+// starting with the shard-th one, pushing the gradients of
+// every batch of passes to the parameter server.
+//========================================================
+int parameterWorker(int argc, const char ** argv) {
+	using namespace std::string_literals;
+	using Compression = neuronet::GradientCompression;
+	if (argc < 3) throw std::runtime_error{"ps-worker requires the path to training data!"};
+	auto options = neuronet::TrainingWorkerOptions{};
+	for (auto i = 3; i + 1 < argc; i += 2) {
+		if      (argv[i] == "--connect"s) options.address      = argv[i + 1];
+		else if (argv[i] == "--shard"s)   options.shard        = std::stoul(argv[i + 1]);
+		else if (argv[i] == "--shards"s)  options.shards       = std::stoul(argv[i + 1]);
+		else if (argv[i] == "--epochs"s)  options.epochs       = std::stoul(argv[i + 1]);
+		else if (argv[i] == "--batch"s)   options.batch_passes = std::stoul(argv[i + 1]);
+		else if (argv[i] == "--compression"s) {
+			if      (argv[i + 1] == "none"s) options.compression = Compression::none;
+			else if (argv[i + 1] == "fp16"s) options.compression = Compression::fp16;
+			else if (argv[i + 1] == "bf16"s) options.compression = Compression::bf16;
+			else throw std::runtime_error{"unknown compression: "s + argv[i + 1]};
+		}
+		else throw std::runtime_error{"unknown option passed to ps-worker: "s + argv[i]};
+	}
+	const auto data  = utility::TrainingData{argv[2]};
+	const auto stats = neuronet::runTrainingWorker(data, options);
+	std::cout << "shard " << options.shard << ": " << stats.passes << " passes, "
+	          << stats.pushes << " pushes, " << stats.bytes_sent << " bytes sent, "
+	          << "recent average error " << stats.recent_average_error << '\n';
+	return 0;
+}
+
+int main(int argc, const char ** argv) {
+	using namespace std::string_literals;
+	if (argc < 2) throw std::runtime_error{"too few parameters passed to program!"};
+	if (argv[1] == "serve"s)  return serve(argc, argv);
+	if (argv[1] == "verify"s) return verify(argc, argv);
+	if (argv[1] == "evaluate"s) return evaluate(argc, argv);
+	if (argv[1] == "export"s) return exportHeader(argc, argv);
+	if (argv[1] == "prune"s)  return pruneModel(argc, argv);
+	if (argv[1] == "stream"s) return stream(argc, argv);
+	if (argv[1] == "sweep"s)  return sweep(argc, argv);
+	if (argv[1] == "ps-server"s) return parameterServer(argc, argv);
+	if (argv[1] == "ps-worker"s) return parameterWorker(argc, argv);
+	return train(argc, argv);
+}
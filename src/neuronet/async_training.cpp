@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <utility>
+
+#include "neuronet/async_training.hpp"
+#include "neuronet/neural_net.hpp"
+
+#include "utility/training_data.hpp"
+
+namespace neuronet {
+	//====================================================================
+	// State shared by a handle and its training thread.
+	//
+	// The progress snapshot is a seqlock: the training thread makes the
+	// sequence odd while it writes the fields and even again afterwards,
+	// readers retry until they read the same even sequence before and
+	// after reading the fields. So neither side ever blocks and the
+	// training thread only pays a few relaxed stores per snapshot.
+	//====================================================================
+	struct TrainingHandle::State {
+		State(NeuralNet & net, const utility::TrainingData & data, TrainingOptions options):
+			net(net),
+			data(data),
+			options(std::move(options))
+		{}
+
+		void run();
+		void publish(const TrainingProgress & progress) noexcept;
+		auto read() const noexcept -> TrainingProgress;
+
+		NeuralNet                   & net;
+		const utility::TrainingData & data;
+		TrainingOptions               options;
+		std::promise<TrainingProgress> promise;
+		std::atomic<bool>             cancelled{false};
+
+		std::atomic<uint64_t> sequence{0};
+		std::atomic<size_t>   epoch{0};
+		std::atomic<size_t>   passes_done{0};
+		std::atomic<size_t>   passes_total{0};
+		std::atomic<double>   recent_average_error{0.0};
+		std::atomic<double>   passes_per_second{0.0};
+	};
+
+	void TrainingHandle::State::publish(const TrainingProgress & progress) noexcept {
+		const auto current = sequence.load(std::memory_order_relaxed);
+		sequence.store(current + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		epoch.store(progress.epoch, std::memory_order_relaxed);
+		passes_done.store(progress.passes_done, std::memory_order_relaxed);
+		passes_total.store(progress.passes_total, std::memory_order_relaxed);
+		recent_average_error.store(progress.recent_average_error, std::memory_order_relaxed);
+		passes_per_second.store(progress.passes_per_second, std::memory_order_relaxed);
+		sequence.store(current + 2, std::memory_order_release);
+	}
+
+	auto TrainingHandle::State::read() const noexcept
+		-> TrainingProgress
+	{
+		auto progress = TrainingProgress{};
+		auto before   = uint64_t{0};
+		do {
+			before = sequence.load(std::memory_order_acquire);
+			progress.epoch                = epoch.load(std::memory_order_relaxed);
+			progress.passes_done          = passes_done.load(std::memory_order_relaxed);
+			progress.passes_total         = passes_total.load(std::memory_order_relaxed);
+			progress.recent_average_error = recent_average_error.load(std::memory_order_relaxed);
+			progress.passes_per_second    = passes_per_second.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+		} while ((before & 1) != 0 || before != sequence.load(std::memory_order_relaxed));
+		return progress;
+	}
+
+	void TrainingHandle::State::run() {
+		using clock = std::chrono::steady_clock;
+		const auto start    = clock::now();
+		const auto interval = std::max<size_t>(1, options.progress_interval);
+		auto progress = TrainingProgress{};
+		progress.passes_total = options.epochs * static_cast<size_t>(data.end() - data.begin());
+		const auto update = [&] {
+			const auto elapsed = std::chrono::duration<double>(clock::now() - start).count();
+			progress.recent_average_error = net.getRecentAverageError();
+			progress.passes_per_second    = elapsed > 0.0 ? progress.passes_done / elapsed : 0.0;
+			publish(progress);
+			if (options.on_progress) options.on_progress(progress);
+		};
+		try {
+			update();
+			for (auto epoch = size_t{0}; epoch < options.epochs; ++epoch) {
+				progress.epoch = epoch;
+				for (auto& pass : data) {
+					if (cancelled.load(std::memory_order_relaxed)) break;
+					net.trainStep(pass.getInputValues(), pass.getExpectedValues());
+					if (++progress.passes_done % interval == 0) update();
+				}
+				if (cancelled.load(std::memory_order_relaxed)) break;
+			}
+			if (net.getUpdateMode() == NeuralNet::UpdateMode::deferred
+				&& net.countPendingGradients() > 0)
+			{
+				net.commitGradients();
+			}
+			update();
+			promise.set_value(progress);
+		}
+		catch (...) {
+			promise.set_exception(std::current_exception());
+		}
+	}
+
+	TrainingHandle::TrainingHandle(
+		NeuralNet & net, const utility::TrainingData & data, TrainingOptions options
+	):
+		m_state{std::make_unique<State>(net, data, std::move(options))},
+		m_completion{m_state->promise.get_future().share()},
+		m_thread{[state = m_state.get()] { state->run(); }}
+	{}
+
+	TrainingHandle::TrainingHandle(TrainingHandle &&) = default;
+
+	TrainingHandle::~TrainingHandle() {
+		if (!m_thread.joinable()) return;
+		cancel();
+		m_thread.join();
+	}
+
+	auto TrainingHandle::completion() const
+		-> std::shared_future<TrainingProgress>
+	{
+		return m_completion;
+	}
+
+	void TrainingHandle::cancel() noexcept {
+		if (m_state == nullptr) return;
+		m_state->cancelled.store(true, std::memory_order_relaxed);
+	}
+
+	bool TrainingHandle::isCancelled() const noexcept {
+		return m_state != nullptr && m_state->cancelled.load(std::memory_order_relaxed);
+	}
+
+	auto TrainingHandle::progress() const noexcept
+		-> TrainingProgress
+	{
+		return m_state == nullptr ? TrainingProgress{} : m_state->read();
+	}
+}
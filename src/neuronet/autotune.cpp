@@ -0,0 +1,378 @@
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <algorithm>
+#include <string>
+#include <unistd.h>
+
+#include "neuronet/autotune.hpp"
+#include "neuronet/neural_net.hpp"
+#include "neuronet/worker_pool.hpp"
+
+namespace neuronet {
+	namespace {
+		using Clock = std::chrono::steady_clock;
+
+		auto workloadName(AutotuneOptions::Workload workload)
+			-> const char *
+		{
+			switch (workload) {
+				case AutotuneOptions::Workload::training:  return "training";
+				case AutotuneOptions::Workload::inference: return "inference";
+				case AutotuneOptions::Workload::batch:     return "batch";
+			}
+			return "unknown";
+		}
+
+		auto engineName(NeuralLayer::Engine engine)
+			-> const char *
+		{
+			return engine == NeuralLayer::Engine::blocked ? "blocked" : "reference";
+		}
+
+		auto topologyOf(const NeuralNet & net)
+			-> std::vector<uint64_t>
+		{
+			auto topology = std::vector<uint64_t>{};
+			for (auto& layer : net.getLayers()) {
+				topology.push_back(layer.size());
+			}
+			return topology;
+		}
+
+		//====================================================================
+		// Key of the results of a tuning within the cache file: everything
+		// the choice depends on, separated by tabs.
+		//====================================================================
+		auto cacheKey(
+			const AutotuneResult & result, const std::vector<Convolution> & convolutions,
+			size_t poolSize, const AutotuneOptions & options)
+			-> std::string
+		{
+			auto key = std::ostringstream{};
+			key << result.cpu_model << '\t';
+			for (auto i = size_t{0}; i < result.topology.size(); ++i) {
+				key << (i == 0 ? "" : ",") << result.topology[i];
+			}
+			// Keys of dense nets stay as they were before convolutions.
+			for (auto& convolution : convolutions) {
+				key << '/' << convolution;
+			}
+			key << '\t' << poolSize << '\t' << workloadName(options.workload);
+			if (options.workload == AutotuneOptions::Workload::batch) {
+				key << ':' << options.batch_size;
+			}
+			return key.str();
+		}
+
+		// Parses "engine:vector_block:gemm_mc:gemm_kc:gemm_nc:threads".
+		auto parseTuning(const std::string & text, LayerTuning & tuning)
+			-> bool
+		{
+			auto fields = std::istringstream{text};
+			auto engine = std::string{};
+			auto colon  = char{};
+			if (!std::getline(fields, engine, ':')) return false;
+			if      (engine == "blocked")   tuning.engine = NeuralLayer::Engine::blocked;
+			else if (engine == "reference") tuning.engine = NeuralLayer::Engine::reference;
+			else return false;
+			fields >> tuning.blocking.vector_block >> colon >> tuning.blocking.gemm_mc >> colon
+			       >> tuning.blocking.gemm_kc >> colon >> tuning.blocking.gemm_nc >> colon
+			       >> tuning.threads;
+			return !fields.fail() && tuning.threads >= 1
+				&& tuning.blocking.vector_block > 0 && tuning.blocking.gemm_mc > 0
+				&& tuning.blocking.gemm_kc > 0 && tuning.blocking.gemm_nc > 0;
+		}
+
+		auto formatTuning(const LayerTuning & tuning)
+			-> std::string
+		{
+			auto text = std::ostringstream{};
+			text << engineName(tuning.engine) << ':' << tuning.blocking.vector_block << ':'
+			     << tuning.blocking.gemm_mc << ':' << tuning.blocking.gemm_kc << ':'
+			     << tuning.blocking.gemm_nc << ':' << tuning.threads;
+			return text.str();
+		}
+
+		auto readCacheLines(const std::string & path)
+			-> std::vector<std::string>
+		{
+			auto lines = std::vector<std::string>{};
+			auto file  = std::ifstream{path};
+			auto line  = std::string{};
+			while (std::getline(file, line)) {
+				if (!line.empty()) lines.push_back(std::move(line));
+			}
+			return lines;
+		}
+
+		//====================================================================
+		// Looks up the tunings of the given key; the cache is only a hint,
+		// so missing files and malformed lines count as misses.
+		//====================================================================
+		auto lookup(const std::vector<std::string> & lines, const std::string & key, size_t countLayers)
+			-> std::vector<LayerTuning>
+		{
+			for (auto& line : lines) {
+				if (line.compare(0, key.size(), key) != 0 || line.size() == key.size()
+					|| line[key.size()] != '\t') continue;
+				auto tunings = std::vector<LayerTuning>{};
+				auto fields  = std::istringstream{line.substr(key.size() + 1)};
+				auto field   = std::string{};
+				while (std::getline(fields, field, '\t')) {
+					auto tuning = LayerTuning{};
+					if (!parseTuning(field, tuning)) return {};
+					tunings.push_back(tuning);
+				}
+				return tunings.size() == countLayers ? tunings : std::vector<LayerTuning>{};
+			}
+			return {};
+		}
+
+		// Replaces the line of the given key and writes the cache
+		// atomically, so concurrent runs never read a partial file.
+		// Every process writes its own temporary file; the last
+		// rename wins.
+		auto store(
+			const std::string & path, std::vector<std::string> lines,
+			const std::string & key, const std::vector<LayerTuning> & tunings)
+			-> bool
+		{
+			lines.erase(std::remove_if(lines.begin(), lines.end(), [&key](const std::string & line) {
+				return line.compare(0, key.size(), key) == 0 && line.size() > key.size() && line[key.size()] == '\t';
+			}), lines.end());
+			auto line = key;
+			for (auto& tuning : tunings) {
+				line += '\t' + formatTuning(tuning);
+			}
+			lines.push_back(std::move(line));
+			const auto temporary = path + ".tmp." + std::to_string(::getpid());
+			{
+				auto file = std::ofstream{temporary};
+				for (auto& entry : lines) {
+					file << entry << '\n';
+				}
+				file.close();
+				if (!file) {
+					std::remove(temporary.c_str());
+					return false;
+				}
+			}
+			if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+				std::remove(temporary.c_str());
+				return false;
+			}
+			return true;
+		}
+
+		void apply(NeuralNet & net, size_t layer, const LayerTuning & tuning) {
+			net.setLayerEngine(layer, tuning.engine);
+			net.setLayerBlocking(layer, tuning.blocking);
+			net.setLayerThreads(layer, tuning.threads);
+		}
+
+		auto currentTuning(const NeuralLayer & layer)
+			-> LayerTuning
+		{
+			auto tuning = LayerTuning{};
+			tuning.engine   = layer.getEngine();
+			tuning.blocking = layer.getBlocking();
+			tuning.threads  = layer.getThreads();
+			return tuning;
+		}
+
+		//====================================================================
+		// Candidate configurations of a layer of rows neurons with cols
+		// incoming connections each: the reference engine and the blocked
+		// engine with a few block sizes around the defaults on every power
+		// of two number of workers that leaves each some rows.
+		//====================================================================
+		auto candidatesOf(size_t rows, size_t cols, size_t poolSize)
+			-> std::vector<LayerTuning>
+		{
+			auto candidates = std::vector<LayerTuning>{};
+			candidates.push_back(LayerTuning{});
+			auto blockings = std::vector<kernels::Blocking>{kernels::Blocking{}};
+			for (auto vectorBlock : {size_t{256}, size_t{4096}}) {
+				// Blocks at least as long as the rows change nothing.
+				if (std::min(vectorBlock, cols) == std::min(kernels::Blocking{}.vector_block, cols)) continue;
+				auto blocking = kernels::Blocking{};
+				blocking.vector_block = vectorBlock;
+				blocking.gemm_kc      = std::min(blocking.gemm_kc, vectorBlock);
+				blockings.push_back(blocking);
+			}
+			for (auto threads = size_t{1}; threads <= std::max(poolSize, size_t{1}); threads *= 2) {
+				if (threads > 1 && rows < threads * kernels::row_tile) break;
+				for (auto& blocking : blockings) {
+					auto candidate = LayerTuning{};
+					candidate.engine   = NeuralLayer::Engine::blocked;
+					candidate.blocking = blocking;
+					candidate.threads  = threads;
+					candidates.push_back(candidate);
+				}
+			}
+			return candidates;
+		}
+
+		//====================================================================
+		// Random inputs and targets of the timed workload, fixed for all
+		// candidates.
+		//====================================================================
+		struct Samples {
+			std::vector<double> inputs;
+			std::vector<double> targets;
+			std::vector<double> outputs;
+		};
+
+		auto makeSamples(const std::vector<uint64_t> & topology, size_t count)
+			-> Samples
+		{
+			auto random = std::mt19937_64{1};
+			auto value  = std::uniform_real_distribution<double>{-1.0, 1.0};
+			auto samples = Samples{};
+			samples.inputs.resize(topology.front() * count);
+			samples.targets.resize(topology.back());
+			for (auto& input  : samples.inputs)  input  = value(random);
+			for (auto& target : samples.targets) target = value(random);
+			return samples;
+		}
+
+		// Best time per call of the workload over all rounds.
+		auto measure(NeuralNet & net, Samples & samples, const AutotuneOptions & options)
+			-> double
+		{
+			const auto countInputs = net.getLayers().front().size();
+			const auto firstInputs = std::vector<double>(
+				samples.inputs.begin(), samples.inputs.begin() + countInputs);
+			const auto run = [&] {
+				switch (options.workload) {
+					case AutotuneOptions::Workload::training:
+						net.feedForward(firstInputs);
+						net.backPropagation(samples.targets);
+						break;
+					case AutotuneOptions::Workload::inference:
+						net.feedForward(firstInputs);
+						break;
+					case AutotuneOptions::Workload::batch:
+						net.feedForwardBatch(samples.inputs, options.batch_size, samples.outputs);
+						break;
+				}
+			};
+			run();
+			auto best = 0.0;
+			for (auto round = size_t{0}; round < options.rounds; ++round) {
+				const auto start = Clock::now();
+				auto calls   = size_t{0};
+				auto elapsed = 0.0;
+				do {
+					run();
+					++calls;
+					elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+				} while (elapsed < options.min_seconds);
+				const auto perCall = elapsed / calls;
+				if (round == 0 || perCall < best) best = perCall;
+			}
+			return best;
+		}
+	}
+
+	auto cpuModel()
+		-> std::string
+	{
+		auto cpuinfo = std::ifstream{"/proc/cpuinfo"};
+		auto line    = std::string{};
+		while (std::getline(cpuinfo, line)) {
+			if (line.compare(0, 10, "model name") != 0) continue;
+			const auto colon = line.find(':');
+			if (colon == std::string::npos) break;
+			const auto first = line.find_first_not_of(' ', colon + 1);
+			return first == std::string::npos ? "unknown" : line.substr(first);
+		}
+		return "unknown";
+	}
+
+	auto autotune(NeuralNet & net, const AutotuneOptions & options)
+		-> AutotuneResult
+	{
+		assert(options.rounds >= 1 &&
+			"the autotuner needs at least one round per candidate.");
+		assert(options.batch_size >= 1 &&
+			"the batch workload needs at least one sample.");
+		const auto& pool     = net.getWorkerPool();
+		const auto  poolSize = pool == nullptr ? size_t{1} : pool->size();
+		const auto  countLayers = net.getLayers().size();
+
+		auto result = AutotuneResult{};
+		result.cpu_model = cpuModel();
+		result.topology  = topologyOf(net);
+
+		const auto key   = cacheKey(result, net.getConvolutions(), poolSize, options);
+		const auto lines = options.cache_path.empty()
+			? std::vector<std::string>{}
+			: readCacheLines(options.cache_path);
+		result.layers = lookup(lines, key, countLayers - 1);
+		if (!result.layers.empty()) {
+			result.from_cache = true;
+			for (auto layer = size_t{1}; layer < countLayers; ++layer) {
+				apply(net, layer, result.layers[layer - 1]);
+			}
+			return result;
+		}
+
+		NeuralNet scratch{result.topology, net.getConvolutions()};
+		scratch.setWorkerPool(pool);
+		for (auto layer = size_t{1}; layer < countLayers; ++layer) {
+			apply(scratch, layer, currentTuning(net.getLayers()[layer]));
+		}
+		auto samples = makeSamples(result.topology,
+			options.workload == AutotuneOptions::Workload::batch ? options.batch_size : 1);
+
+		for (auto layer = size_t{1}; layer < countLayers; ++layer) {
+			const auto& shape = scratch.getLayers()[layer];
+			auto best = LayerTuning{};
+			for (auto& candidate : candidatesOf(shape.size(), shape.countIncConnections(), poolSize)) {
+				apply(scratch, layer, candidate);
+				const auto seconds = measure(scratch, samples, options);
+				++result.count_candidates;
+				if (best.seconds == 0.0 || seconds < best.seconds) {
+					best = candidate;
+					best.seconds = seconds;
+				}
+			}
+			apply(scratch, layer, best);
+			apply(net, layer, best);
+			result.layers.push_back(best);
+		}
+
+		if (!options.cache_path.empty()) {
+			result.cache_written = store(options.cache_path, lines, key, result.layers);
+		}
+		return result;
+	}
+
+	auto operator<<(std::ostream & os, const AutotuneResult & result) -> std::ostream & {
+		os << "autotuned for " << result.cpu_model;
+		if (result.from_cache) os << " (cached)";
+		else os << " (" << result.count_candidates << " candidates)";
+		os << '\n';
+		for (auto layer = size_t{0}; layer < result.layers.size(); ++layer) {
+			const auto& tuning = result.layers[layer];
+			os << "\tlayer " << (layer + 1) << " (" << result.topology[layer + 1] << "x"
+			   << (result.topology[layer] + 1) << "): " << engineName(tuning.engine);
+			if (tuning.engine == NeuralLayer::Engine::blocked) {
+				os << ", vector block " << tuning.blocking.vector_block
+				   << ", gemm " << tuning.blocking.gemm_mc << 'x' << tuning.blocking.gemm_kc
+				   << 'x' << tuning.blocking.gemm_nc
+				   << ", " << tuning.threads << " threads";
+			}
+			if (tuning.seconds > 0.0) {
+				os << ", " << tuning.seconds * 1.0e6 << " us per call";
+			}
+			os << '\n';
+		}
+		return os;
+	}
+}
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "neuronet/convolution.hpp"
+
+namespace neuronet {
+	auto Convolution::outputHeight() const
+		-> size_t
+	{
+		return (input_height + 2 * padding_height - kernel_height) / stride_height + 1;
+	}
+
+	auto Convolution::outputWidth() const
+		-> size_t
+	{
+		return (input_width + 2 * padding_width - kernel_width) / stride_width + 1;
+	}
+
+	auto Convolution::countInputs() const
+		-> size_t
+	{
+		return input_channels * input_height * input_width;
+	}
+
+	auto Convolution::countOutputs() const
+		-> size_t
+	{
+		return channels * outputHeight() * outputWidth();
+	}
+
+	auto Convolution::countKernelWeights() const
+		-> size_t
+	{
+		return input_channels * kernel_height * kernel_width;
+	}
+
+	void Convolution::validate() const {
+		if (layer == 0) {
+			throw std::invalid_argument{"the input layer can't be a convolutional layer."};
+		}
+		if (input_channels == 0 || input_height == 0 || input_width == 0
+			|| channels == 0 || kernel_height == 0 || kernel_width == 0
+			|| stride_height == 0 || stride_width == 0)
+		{
+			throw std::invalid_argument{"the dimensions of a convolution must not be zero."};
+		}
+		if (kernel_height > input_height + 2 * padding_height
+			|| kernel_width > input_width + 2 * padding_width)
+		{
+			throw std::invalid_argument{"the kernel of a convolution must fit into its padded input."};
+		}
+	}
+
+	auto operator<<(std::ostream & os, const Convolution & convolution) -> std::ostream & {
+		return os
+			<< convolution.layer          << ' '
+			<< convolution.input_channels << ' '
+			<< convolution.input_height   << ' '
+			<< convolution.input_width    << ' '
+			<< convolution.channels       << ' '
+			<< convolution.kernel_height  << ' '
+			<< convolution.kernel_width   << ' '
+			<< convolution.stride_height  << ' '
+			<< convolution.stride_width   << ' '
+			<< convolution.padding_height << ' '
+			<< convolution.padding_width;
+	}
+
+	namespace {
+		//====================================================================
+		// Calls visit(row, column, input) for every entry of the lowered
+		// matrix that covers an input rather than the padding, with the
+		// offsets of the values of the first sample.
+		//====================================================================
+		template <typename Visit>
+		void forEachReceptiveField(const Convolution & c, size_t batchSize, Visit && visit) {
+			const auto outputHeight = c.outputHeight();
+			const auto outputWidth  = c.outputWidth();
+			const auto countColumns = outputHeight * outputWidth * batchSize;
+			auto row = size_t{0};
+			for (auto channel = size_t{0}; channel < c.input_channels; ++channel) {
+				for (auto ky = size_t{0}; ky < c.kernel_height; ++ky) {
+					for (auto kx = size_t{0}; kx < c.kernel_width; ++kx, ++row) {
+						auto column = row * countColumns;
+						for (auto oy = size_t{0}; oy < outputHeight; ++oy) {
+							// Coordinates within the padded input.
+							const auto y = oy * c.stride_height + ky;
+							const auto rowInside = y >= c.padding_height
+							                    && y <  c.padding_height + c.input_height;
+							for (auto ox = size_t{0}; ox < outputWidth; ++ox, column += batchSize) {
+								const auto x = ox * c.stride_width + kx;
+								if (!rowInside || x < c.padding_width || x >= c.padding_width + c.input_width) {
+									continue;
+								}
+								const auto input =
+									((channel * c.input_height + y - c.padding_height) * c.input_width
+									+ x - c.padding_width) * batchSize;
+								visit(column, input);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void im2col(
+		const Convolution & convolution,
+		const double * inputs, size_t batchSize,
+		double * columns
+	) {
+		const auto count = convolution.countKernelWeights()
+		                 * convolution.outputHeight() * convolution.outputWidth() * batchSize;
+		std::fill(columns, columns + count, 0.0);
+		forEachReceptiveField(convolution, batchSize, [=](size_t column, size_t input) {
+			std::copy(inputs + input, inputs + input + batchSize, columns + column);
+		});
+	}
+
+	void col2im(
+		const Convolution & convolution,
+		const double * columns, size_t batchSize,
+		double * inputs
+	) {
+		forEachReceptiveField(convolution, batchSize, [=](size_t column, size_t input) {
+			for (auto sample = size_t{0}; sample < batchSize; ++sample) {
+				inputs[input + sample] += columns[column + sample];
+			}
+		});
+	}
+}
@@ -0,0 +1,931 @@
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+
+#include "neuronet/differential_check.hpp"
+#include "neuronet/neural_net.hpp"
+#include "neuronet/neural_layer.hpp"
+#include "neuronet/worker_pool.hpp"
+#include "neuronet/sparse_net.hpp"
+#include "neuronet/ensemble.hpp"
+#include "neuronet/pipeline.hpp"
+#include "neuronet/result_cache.hpp"
+
+namespace neuronet {
+	namespace {
+		//====================================================================
+		// An optimized variant of the neural net under test.
+		//
+		// configure - switches a freshly loaded net to the variant.
+		// passes    - train: every pass trains both nets on new inputs.
+		//             sparse: the passes feed forward inputs of which few
+		//             change per pass and train every fourth pass.
+		//             forward: the passes only feed forward new inputs.
+		// deferred  - both nets accumulate gradients and commit them
+		//             every third pass.
+		// tolerance - lower bound of the relative and the absolute
+		//             tolerance for variants that round more than the
+		//             summation order does, zero for none.
+		//====================================================================
+		struct Variant {
+			enum class Passes {
+				train,
+				sparse,
+				forward
+			};
+
+			const char * name;
+			std::function<void(NeuralNet &, size_t)> configure;
+			Passes passes;
+			bool   deferred;
+			double tolerance = 0.0;
+		};
+
+		//====================================================================
+		// A family of random convolutional nets. shape draws the layers and
+		// the convolutions of a net of the family.
+		//====================================================================
+		struct ConvolutionVariant {
+			const char * name;
+			std::function<void(std::mt19937_64 &, std::vector<uint64_t> &, std::vector<Convolution> &)> shape;
+		};
+
+		// Central differences of the squared error with this step agree
+		// with the gradients to about 1e-10, the rounding of the error
+		// divided by the step; the tolerances leave room for strongly
+		// curved neurons and tiny gradients.
+		constexpr auto finiteDifferenceStep      = 1.0e-6;
+		constexpr auto finiteDifferenceTolerance = 1.0e-6;
+		constexpr auto finiteDifferenceAbsolute  = 1.0e-8;
+		constexpr auto maxFiniteDifferences      = size_t{48};
+
+		auto ulpDistance(double lhs, double rhs)
+			-> uint64_t
+		{
+			if (lhs == rhs) return 0;
+			if (std::isnan(lhs) || std::isnan(rhs)) {
+				return std::numeric_limits<uint64_t>::max();
+			}
+			// Maps the bits of doubles to integers of the same order.
+			const auto ordered = [](double value) {
+				auto bits = int64_t{0};
+				std::memcpy(&bits, &value, sizeof(bits));
+				return bits < 0 ? std::numeric_limits<int64_t>::min() - bits : bits;
+			};
+			const auto a = static_cast<uint64_t>(ordered(lhs));
+			const auto b = static_cast<uint64_t>(ordered(rhs));
+			return static_cast<int64_t>(a - b) > 0 ? a - b : b - a;
+		}
+
+		//====================================================================
+		// Compares values of the reference and the optimized net and keeps
+		// track of the first mismatch.
+		//====================================================================
+		class Comparison {
+		public:
+			Comparison(const DifferentialOptions & options, DifferentialResult & result):
+				m_options(options),
+				m_result(result)
+			{}
+
+			// Values are compared relative to the given scale of the vector
+			// they belong to since summing in another order may cancel
+			// differently for elements much smaller than the rest.
+			bool check(
+				const char * quantity, size_t pass, size_t index,
+				double reference, double optimized, double scale
+			) {
+				++m_result.count_checked;
+				const auto difference = std::abs(reference - optimized);
+				const auto magnitude  = std::max({std::abs(reference), std::abs(optimized), scale});
+				if (magnitude > 0.0) {
+					m_result.max_relative_error =
+						std::max(m_result.max_relative_error, difference / magnitude);
+				}
+				if (ulpDistance(reference, optimized) <= m_options.max_ulps
+					|| difference <= m_options.absolute_tolerance
+					|| difference <= m_options.relative_tolerance * magnitude)
+				{
+					return true;
+				}
+				m_result.passed    = false;
+				m_result.quantity  = quantity;
+				m_result.pass      = pass;
+				m_result.index     = index;
+				m_result.reference = reference;
+				m_result.optimized = optimized;
+				return false;
+			}
+
+			bool outputs(size_t pass, const NeuralNet & reference, const NeuralNet & optimized) {
+				const auto expected = reference.results();
+				const auto actual   = optimized.results();
+				const auto scale    = scaleOf(expected);
+				for (auto i = size_t{0}; i < expected.size(); ++i) {
+					if (!check("output", pass, i, expected[i], actual[i], scale)) return false;
+				}
+				return true;
+			}
+
+			bool gradients(size_t pass, const NeuralNet & reference, const NeuralNet & optimized) {
+				auto index = size_t{0};
+				for (auto l = size_t{1}; l < reference.getLayers().size(); ++l) {
+					auto expected = std::vector<double>{};
+					for (auto& neuron : reference.getLayers()[l]) {
+						expected.push_back(neuron.getGradient());
+					}
+					const auto scale = scaleOf(expected);
+					auto       value = expected.begin();
+					for (auto& neuron : optimized.getLayers()[l]) {
+						if (!check("gradient", pass, index++, *value++, neuron.getGradient(), scale)) {
+							return false;
+						}
+					}
+				}
+				return true;
+			}
+
+			bool weights(size_t pass, const NeuralNet & reference, const NeuralNet & optimized) {
+				auto index = size_t{0};
+				for (auto l = size_t{1}; l < reference.getLayers().size(); ++l) {
+					const auto& expected = reference.getLayers()[l].getWeights();
+					const auto& actual   = optimized.getLayers()[l].getWeights();
+					const auto  scale    = scaleOf(expected);
+					for (auto i = size_t{0}; i < expected.size(); ++i) {
+						if (!check("weight", pass, index++, expected[i], actual[i], scale)) return false;
+					}
+				}
+				return true;
+			}
+
+			static auto scaleOf(const std::vector<double> & values)
+				-> double
+			{
+				auto scale = 0.0;
+				for (auto value : values) {
+					scale = std::max(scale, std::abs(value));
+				}
+				return scale;
+			}
+
+		private:
+			const DifferentialOptions & m_options;
+			DifferentialResult        & m_result;
+		};
+
+		auto randomTopology(std::mt19937_64 & random, const DifferentialOptions & options)
+			-> std::vector<uint64_t>
+		{
+			auto layers = std::uniform_int_distribution<size_t>{2, std::max<size_t>(2, options.max_layers)};
+			auto width  = std::uniform_int_distribution<uint64_t>{1, std::max<uint64_t>(1, options.max_width)};
+			auto topology = std::vector<uint64_t>(layers(random));
+			for (auto& count : topology) {
+				count = width(random);
+			}
+			return topology;
+		}
+
+		//====================================================================
+		// Writes a model of the given topology with seeded random weights
+		// scaled by the fan-in so that the neurons do not saturate.
+		//====================================================================
+		auto randomModel(std::mt19937_64 & random, const std::vector<uint64_t> & topology)
+			-> std::string
+		{
+			auto model = std::ostringstream{};
+			model.precision(std::numeric_limits<double>::max_digits10);
+			model << "topology";
+			for (auto count : topology) {
+				model << ' ' << count;
+			}
+			model << '\n';
+			for (auto l = size_t{1}; l < topology.size(); ++l) {
+				const auto fanIn  = topology[l - 1] + 1;
+				const auto bound  = 2.0 / std::sqrt(static_cast<double>(fanIn));
+				auto       weight = std::uniform_real_distribution<double>{-bound, bound};
+				for (auto neuron = uint64_t{0}; neuron < topology[l]; ++neuron) {
+					model << "weights";
+					for (auto input = uint64_t{0}; input < fanIn; ++input) {
+						model << ' ' << weight(random);
+					}
+					model << '\n';
+				}
+			}
+			return model.str();
+		}
+
+		auto loadNet(const std::string & model)
+			-> std::unique_ptr<NeuralNet>
+		{
+			auto stream = std::istringstream{model};
+			return std::make_unique<NeuralNet>(stream);
+		}
+
+		bool runCase(
+			const DifferentialOptions & options, const Variant & variant,
+			uint64_t caseSeed, DifferentialResult & result
+		) {
+			auto random    = std::mt19937_64{caseSeed};
+			auto value     = std::uniform_real_distribution<double>{-1.0, 1.0};
+			const auto topology = randomTopology(random, options);
+			const auto model    = randomModel(random, topology);
+			auto reference = loadNet(model);
+			auto optimized = loadNet(model);
+			variant.configure(*optimized, topology.size());
+			if (variant.deferred) {
+				reference->setUpdateMode(NeuralNet::UpdateMode::deferred);
+				optimized->setUpdateMode(NeuralNet::UpdateMode::deferred);
+			}
+			result.variant   = variant.name;
+			result.case_seed = caseSeed;
+			result.topology  = topology;
+
+			auto tolerances = options;
+			tolerances.relative_tolerance =
+				std::max(options.relative_tolerance, variant.tolerance);
+			tolerances.absolute_tolerance =
+				std::max(options.absolute_tolerance, variant.tolerance);
+			auto compare = Comparison{tolerances, result};
+			auto input   = std::vector<double>(topology.front());
+			auto target  = std::vector<double>(topology.back());
+			auto which   = std::uniform_int_distribution<size_t>{0, input.size() - 1};
+			for (auto& x : input) x = value(random);
+			for (auto pass = size_t{0}; pass < options.passes; ++pass) {
+				if (variant.passes == Variant::Passes::sparse) {
+					input[which(random)] = value(random);
+				}
+				else {
+					for (auto& x : input) x = value(random);
+				}
+				for (auto& t : target) t = value(random);
+				reference->feedForward(input);
+				optimized->feedForward(input);
+				if (!compare.outputs(pass, *reference, *optimized)) return false;
+				const auto train = variant.passes == Variant::Passes::train
+				                || (variant.passes == Variant::Passes::sparse && pass % 4 == 3);
+				if (train) {
+					reference->backPropagation(target);
+					optimized->backPropagation(target);
+					if (variant.deferred && pass % 3 == 2) {
+						reference->commitGradients();
+						optimized->commitGradients();
+					}
+					// A compiled net keeps its gradients within its plan,
+					// they are checked through the weights.
+					if (!optimized->isCompiled() && !compare.gradients(pass, *reference, *optimized)) {
+						return false;
+					}
+					if (!compare.weights(pass, *reference, *optimized))   return false;
+				}
+			}
+			if (variant.deferred) {
+				reference->commitGradients();
+				optimized->commitGradients();
+				if (!compare.weights(options.passes, *reference, *optimized)) return false;
+			}
+
+			// The batched forward pass of the optimized net has to agree
+			// with single passes of the reference.
+			auto batch   = std::vector<double>(options.batch_size * input.size());
+			auto outputs = std::vector<double>{};
+			for (auto& x : batch) x = value(random);
+			optimized->feedForwardBatch(batch, options.batch_size, outputs);
+			for (auto sample = size_t{0}; sample < options.batch_size; ++sample) {
+				const auto first = batch.begin() + sample * input.size();
+				reference->feedForward(std::vector<double>(first, first + input.size()));
+				const auto expected = reference->results();
+				const auto scale    = Comparison::scaleOf(expected);
+				for (auto o = size_t{0}; o < expected.size(); ++o) {
+					if (!compare.check("batched output", options.passes, sample * expected.size() + o,
+						expected[o], outputs[sample * expected.size() + o], scale))
+					{
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+
+		//====================================================================
+		// Draws a convolution reading the given number of planes of the
+		// given extent, with random kernels, strides and padding if allowed.
+		//====================================================================
+		auto randomConvolution(
+			std::mt19937_64 & random, size_t layer,
+			size_t channels, size_t height, size_t width, bool strided
+		)
+			-> Convolution
+		{
+			const auto draw = [&](size_t low, size_t high) {
+				return std::uniform_int_distribution<size_t>{low, high}(random);
+			};
+			auto convolution = Convolution{};
+			convolution.layer          = layer;
+			convolution.input_channels = channels;
+			convolution.input_height   = height;
+			convolution.input_width    = width;
+			convolution.channels       = draw(1, 3);
+			convolution.padding_height = strided ? draw(0, 1) : 0;
+			convolution.padding_width  = strided ? draw(0, 1) : 0;
+			convolution.kernel_height  = draw(1, std::min<size_t>(3, height + 2 * convolution.padding_height));
+			convolution.kernel_width   = draw(1, std::min<size_t>(3, width  + 2 * convolution.padding_width));
+			convolution.stride_height  = strided ? draw(1, 2) : 1;
+			convolution.stride_width   = strided ? draw(1, 2) : 1;
+			return convolution;
+		}
+
+		//====================================================================
+		// Checks a random net of the given convolutional variant: with both
+		// engines and after every training pass the gradients accumulated
+		// by backpropagation have to agree with central differences of the
+		// squared error, and batched forward passes with single ones.
+		//====================================================================
+		bool runConvolutionCase(
+			const DifferentialOptions & options, const ConvolutionVariant & variant,
+			uint64_t caseSeed, DifferentialResult & result
+		) {
+			using Engine = NeuralLayer::Engine;
+			auto random   = std::mt19937_64{caseSeed};
+			auto value    = std::uniform_real_distribution<double>{-1.0, 1.0};
+			auto topology     = std::vector<uint64_t>{};
+			auto convolutions = std::vector<Convolution>{};
+			variant.shape(random, topology, convolutions);
+			result.variant   = variant.name;
+			result.case_seed = caseSeed;
+			result.topology  = topology;
+
+			auto finite = options;
+			finite.relative_tolerance = std::max(options.relative_tolerance, finiteDifferenceTolerance);
+			finite.absolute_tolerance = std::max(options.absolute_tolerance, finiteDifferenceAbsolute);
+			auto compareBatch  = Comparison{options, result};
+			auto compareFinite = Comparison{finite, result};
+
+			auto net = std::make_unique<NeuralNet>(topology, convolutions);
+			net->setUpdateMode(NeuralNet::UpdateMode::deferred);
+			const auto countParameters = net->countParameters();
+			auto weights   = std::vector<double>(countParameters);
+			auto gradients = std::vector<double>(countParameters);
+			auto numeric   = std::vector<double>(countParameters);
+			auto input     = std::vector<double>(topology.front());
+			auto target    = std::vector<double>(topology.back());
+			net->copyWeights(weights.data());
+			// Scales the weights by the fan-in of their layer, as randomModel
+			// does, so that the neurons do not saturate.
+			auto parameter = weights.begin();
+			for (auto l = size_t{1}; l < topology.size(); ++l) {
+				const auto& layer = net->getLayers()[l];
+				const auto  bound = 2.0 / std::sqrt(static_cast<double>(layer.countIncConnections()));
+				auto        draw  = std::uniform_real_distribution<double>{-bound, bound};
+				for (auto i = size_t{0}; i < layer.getWeights().size(); ++i) {
+					*parameter++ = draw(random);
+				}
+			}
+			net->setWeights(weights.data());
+
+			const auto squaredError = [&] {
+				net->feedForward(input);
+				const auto outputs = net->results();
+				auto error = 0.0;
+				for (auto o = size_t{0}; o < outputs.size(); ++o) {
+					error += 0.5 * (target[o] - outputs[o]) * (target[o] - outputs[o]);
+				}
+				return error;
+			};
+
+			for (auto engine : {Engine::reference, Engine::blocked}) {
+				net->setEngine(engine);
+				for (auto pass = size_t{0}; pass < options.passes; ++pass) {
+					for (auto& x : input)  x = value(random);
+					for (auto& t : target) t = value(random);
+					net->copyWeights(weights.data());
+					net->feedForward(input);
+					net->backPropagation(target);
+					net->takeGradients(gradients.data());
+					// The gradients are the negated derivatives of the error.
+					// Every pass checks every stride-th parameter from a
+					// random offset on to bound the cost of wide nets.
+					const auto stride = (countParameters + maxFiniteDifferences - 1) / maxFiniteDifferences;
+					const auto offset = std::uniform_int_distribution<size_t>{0, stride - 1}(random);
+					std::fill(numeric.begin(), numeric.end(), 0.0);
+					for (auto i = offset; i < countParameters; i += stride) {
+						const auto original = weights[i];
+						weights[i] = original + finiteDifferenceStep;
+						net->setWeights(weights.data());
+						const auto above = squaredError();
+						weights[i] = original - finiteDifferenceStep;
+						net->setWeights(weights.data());
+						const auto below = squaredError();
+						weights[i] = original;
+						numeric[i] = (below - above) / (2.0 * finiteDifferenceStep);
+					}
+					net->setWeights(weights.data());
+					const auto scale = Comparison::scaleOf(numeric);
+					for (auto i = offset; i < countParameters; i += stride) {
+						if (!compareFinite.check("weight gradient", pass, i, numeric[i], gradients[i], scale)) {
+							return false;
+						}
+					}
+					// Trains on the pass so that later passes see other weights.
+					net->addGradients(gradients.data(), 1);
+					net->commitGradients();
+				}
+
+				auto batch   = std::vector<double>(options.batch_size * input.size());
+				auto outputs = std::vector<double>{};
+				for (auto& x : batch) x = value(random);
+				net->feedForwardBatch(batch, options.batch_size, outputs);
+				for (auto sample = size_t{0}; sample < options.batch_size; ++sample) {
+					const auto first = batch.begin() + sample * input.size();
+					net->feedForward(std::vector<double>(first, first + input.size()));
+					const auto expected = net->results();
+					const auto scale    = Comparison::scaleOf(expected);
+					for (auto o = size_t{0}; o < expected.size(); ++o) {
+						if (!compareBatch.check("batched output", options.passes, sample * expected.size() + o,
+							expected[o], outputs[sample * expected.size() + o], scale))
+						{
+							return false;
+						}
+					}
+				}
+			}
+			return true;
+		}
+	}
+
+	namespace {
+		//====================================================================
+		// Prunes a random net and compares the forward passes of the sparse
+		// net with a dense net of the weights it kept: the net itself for a
+		// threshold of zero, which keeps every weight, or a copy with all
+		// but the keep largest weights of every neuron zeroed for top k.
+		//====================================================================
+		bool runPruningCase(
+			const DifferentialOptions & options, const char * name, PruningOptions::Strategy strategy,
+			uint64_t caseSeed, DifferentialResult & result
+		) {
+			auto random    = std::mt19937_64{caseSeed};
+			auto value     = std::uniform_real_distribution<double>{-1.0, 1.0};
+			const auto topology = randomTopology(random, options);
+			const auto model    = randomModel(random, topology);
+			auto dense = loadNet(model);
+			result.variant   = name;
+			result.case_seed = caseSeed;
+			result.topology  = topology;
+
+			auto pruning = PruningOptions{};
+			pruning.strategy = strategy;
+			auto countKept = size_t{0};
+			if (strategy == PruningOptions::Strategy::threshold) {
+				pruning.threshold = 0.0;
+				for (auto l = size_t{1}; l < topology.size(); ++l) {
+					countKept += topology[l] * topology[l - 1];
+				}
+			}
+			else {
+				const auto widest = *std::max_element(topology.begin(), topology.end());
+				pruning.keep_per_neuron = std::uniform_int_distribution<size_t>{1, widest}(random);
+				auto weights = std::vector<double>(dense->countParameters());
+				dense->copyWeights(weights.data());
+				auto row = weights.begin();
+				auto magnitudes = std::vector<double>{};
+				for (auto l = size_t{1}; l < topology.size(); ++l) {
+					const auto cols = topology[l - 1];
+					for (auto neuron = uint64_t{0}; neuron < topology[l]; ++neuron, row += cols + 1) {
+						if (cols <= pruning.keep_per_neuron) {
+							countKept += cols;
+							continue;
+						}
+						magnitudes.clear();
+						std::transform(row, row + cols, std::back_inserter(magnitudes),
+							[](double weight) { return std::abs(weight); });
+						std::nth_element(
+							magnitudes.begin(), magnitudes.begin() + (pruning.keep_per_neuron - 1),
+							magnitudes.end(), std::greater<double>{});
+						const auto smallest = magnitudes[pruning.keep_per_neuron - 1];
+						std::replace_if(row, row + cols,
+							[smallest](double weight) { return std::abs(weight) < smallest; }, 0.0);
+						countKept += pruning.keep_per_neuron;
+					}
+				}
+				dense->setWeights(weights.data());
+			}
+			auto sparse = prune(*dense, pruning);
+
+			auto compare = Comparison{options, result};
+			if (!compare.check("non-zero weights", 0, 0,
+				static_cast<double>(countKept), static_cast<double>(sparse.countNonZeros()), 0.0))
+			{
+				return false;
+			}
+			auto input = std::vector<double>(topology.front());
+			for (auto pass = size_t{0}; pass < options.passes; ++pass) {
+				for (auto& x : input) x = value(random);
+				dense->feedForward(input);
+				sparse.feedForward(input);
+				const auto expected = dense->results();
+				const auto actual   = sparse.results();
+				const auto scale    = Comparison::scaleOf(expected);
+				for (auto o = size_t{0}; o < expected.size(); ++o) {
+					if (!compare.check("sparse output", pass, o, expected[o], actual[o], scale)) {
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+
+		//====================================================================
+		// Evaluates an ensemble of random nets of one topology and compares
+		// every reduction with the forward passes of its members: none with
+		// their outputs one after another, mean with their average and vote
+		// with the share of members whose biggest output is each output.
+		//====================================================================
+		bool runEnsembleCase(
+			const DifferentialOptions & options, uint64_t caseSeed, DifferentialResult & result
+		) {
+			auto random    = std::mt19937_64{caseSeed};
+			auto value     = std::uniform_real_distribution<double>{-1.0, 1.0};
+			const auto topology = randomTopology(random, options);
+			auto members   = std::vector<std::unique_ptr<NeuralNet>>{};
+			auto pointers  = std::vector<const NeuralNet *>{};
+			const auto countMembers = std::uniform_int_distribution<size_t>{1, 4}(random);
+			for (auto m = size_t{0}; m < countMembers; ++m) {
+				members.push_back(loadNet(randomModel(random, topology)));
+				pointers.push_back(members.back().get());
+			}
+			auto ensemble  = Ensemble{pointers};
+			result.variant   = "ensemble";
+			result.case_seed = caseSeed;
+			result.topology  = topology;
+
+			using Reduction = Ensemble::Reduction;
+			auto compare  = Comparison{options, result};
+			auto input    = std::vector<double>(topology.front());
+			const auto countOutputs = topology.back();
+			auto outputs  = std::vector<double>{};
+			auto mean     = std::vector<double>(countOutputs);
+			auto vote     = std::vector<double>(countOutputs);
+			const auto share = 1.0 / countMembers;
+			const auto checkAll = [&](const char * quantity, size_t pass,
+				const std::vector<double> & expected, const std::vector<double> & actual)
+			{
+				const auto scale = Comparison::scaleOf(expected);
+				for (auto i = size_t{0}; i < expected.size(); ++i) {
+					if (!compare.check(quantity, pass, i, expected[i], actual[i], scale)) return false;
+				}
+				return true;
+			};
+			for (auto pass = size_t{0}; pass < options.passes; ++pass) {
+				for (auto& x : input) x = value(random);
+				outputs.clear();
+				std::fill(mean.begin(), mean.end(), 0.0);
+				std::fill(vote.begin(), vote.end(), 0.0);
+				for (auto& member : members) {
+					member->feedForward(input);
+					const auto memberOutputs = member->results();
+					outputs.insert(outputs.end(), memberOutputs.begin(), memberOutputs.end());
+					for (auto o = size_t{0}; o < countOutputs; ++o) {
+						mean[o] += memberOutputs[o] * share;
+					}
+					vote[std::max_element(memberOutputs.begin(), memberOutputs.end())
+						- memberOutputs.begin()] += share;
+				}
+				if (!checkAll("ensemble output", pass, outputs, ensemble.predict(input, Reduction::none))
+					|| !checkAll("ensemble mean", pass, mean, ensemble.predict(input, Reduction::mean))
+					|| !checkAll("ensemble vote", pass, vote, ensemble.predict(input, Reduction::vote)))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		//====================================================================
+		// Streams random samples through a pipeline of a random number of
+		// stages and compares the outputs, in the order the samples were
+		// pushed, with the batched forward pass of all samples. At most
+		// queue capacity samples are in flight so that pushing never waits
+		// for the same thread to pop.
+		//====================================================================
+		bool runPipelineCase(
+			const DifferentialOptions & options, uint64_t caseSeed, DifferentialResult & result
+		) {
+			auto random    = std::mt19937_64{caseSeed};
+			auto value     = std::uniform_real_distribution<double>{-1.0, 1.0};
+			const auto topology = randomTopology(random, options);
+			const auto net = loadNet(randomModel(random, topology));
+			auto pipelineOptions = PipelineOptions{};
+			pipelineOptions.stages         = std::uniform_int_distribution<size_t>{0, topology.size() - 1}(random);
+			pipelineOptions.queue_capacity = size_t{1} << std::uniform_int_distribution<size_t>{0, 3}(random);
+			result.variant   = "pipeline";
+			result.case_seed = caseSeed;
+			result.topology  = topology;
+
+			const auto countSamples = options.passes * options.batch_size;
+			auto inputs = std::vector<double>(countSamples * topology.front());
+			for (auto& x : inputs) x = value(random);
+			auto expected = std::vector<double>{};
+			net->feedForwardBatch(inputs, countSamples, expected);
+
+			auto actual = std::vector<double>(expected.size());
+			{
+				Pipeline pipeline{*net, pipelineOptions};
+				auto popped = size_t{0};
+				const auto pop = [&] {
+					if (!pipeline.pop(actual.data() + popped * topology.back(), topology.back())) {
+						return false;
+					}
+					++popped;
+					return true;
+				};
+				for (auto sample = size_t{0}; sample < countSamples; ++sample) {
+					if (sample - popped == pipelineOptions.queue_capacity) pop();
+					pipeline.push(inputs.data() + sample * topology.front(), topology.front());
+				}
+				pipeline.close();
+				while (pop()) {}
+				auto compare = Comparison{options, result};
+				if (!compare.check("pipeline samples", 0, 0,
+					static_cast<double>(countSamples), static_cast<double>(popped), 0.0))
+				{
+					return false;
+				}
+			}
+			auto compare = Comparison{options, result};
+			for (auto sample = size_t{0}; sample < countSamples; ++sample) {
+				const auto first = expected.begin() + sample * topology.back();
+				const auto scale = Comparison::scaleOf(std::vector<double>(first, first + topology.back()));
+				for (auto o = size_t{0}; o < topology.back(); ++o) {
+					const auto i = sample * topology.back() + o;
+					if (!compare.check("pipeline output", sample, o, expected[i], actual[i], scale)) {
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+
+		//====================================================================
+		// Looks up a few random inputs again and again in a result cache
+		// too small for all of them and compares every result with a fresh
+		// forward pass of the net; looking up the same input again must be
+		// a hit. Every third pass trains the net: the cached result of the
+		// trained input must then count as stale after an immediate
+		// backPropagation or after commitGradients, while a deferred
+		// backPropagation alone leaves it a hit.
+		//====================================================================
+		bool runResultCacheCase(
+			const DifferentialOptions & options, uint64_t caseSeed, DifferentialResult & result
+		) {
+			auto random    = std::mt19937_64{caseSeed};
+			auto value     = std::uniform_real_distribution<double>{-1.0, 1.0};
+			const auto topology = randomTopology(random, options);
+			auto net       = loadNet(randomModel(random, topology));
+			auto cacheOptions = ResultCacheOptions{};
+			cacheOptions.capacity = std::max<size_t>(1, options.batch_size / 2);
+			cacheOptions.shards   = 1;
+			ResultCache cache{*net, cacheOptions};
+			result.variant   = "result cache";
+			result.case_seed = caseSeed;
+			result.topology  = topology;
+
+			auto inputs = std::vector<std::vector<double>>(options.batch_size);
+			for (auto& input : inputs) {
+				input.resize(topology.front());
+				for (auto& x : input) x = value(random);
+			}
+			auto target  = std::vector<double>(topology.back());
+			auto which   = std::uniform_int_distribution<size_t>{0, inputs.size() - 1};
+			auto compare = Comparison{options, result};
+			const auto lookup = [&](const char * quantity, size_t pass, const std::vector<double> & input) {
+				net->feedForward(input);
+				const auto expected = net->results();
+				const auto actual   = cache.predict(input);
+				const auto scale    = Comparison::scaleOf(expected);
+				for (auto o = size_t{0}; o < expected.size(); ++o) {
+					if (!compare.check(quantity, pass, o, expected[o], actual[o], scale)) return false;
+				}
+				return true;
+			};
+			const auto counts = [&](const char * quantity, size_t pass, uint64_t expected, uint64_t actual) {
+				return compare.check(quantity, pass, 0,
+					static_cast<double>(expected), static_cast<double>(actual), 0.0);
+			};
+			for (auto pass = size_t{0}; pass < options.passes; ++pass) {
+				const auto& input = inputs[which(random)];
+				if (!lookup("cached output", pass, input)) return false;
+				auto before = cache.getStats();
+				if (!lookup("cache hit", pass, input)
+					|| !counts("cache hits", pass, before.hits + 1, cache.getStats().hits))
+				{
+					return false;
+				}
+				if (pass % 3 != 2) continue;
+
+				const auto deferred = pass % 2 == 1;
+				for (auto& x : target) x = value(random);
+				net->setUpdateMode(deferred
+					? NeuralNet::UpdateMode::deferred : NeuralNet::UpdateMode::immediate);
+				net->feedForward(input);
+				net->backPropagation(target);
+				if (deferred) {
+					before = cache.getStats();
+					if (!lookup("cache hit before commit", pass, input)
+						|| !counts("cache hits before commit", pass, before.hits + 1, cache.getStats().hits))
+					{
+						return false;
+					}
+					net->commitGradients();
+				}
+				before = cache.getStats();
+				if (!lookup("output after training", pass, input)
+					|| !counts("stale lookups", pass, before.stale + 1, cache.getStats().stale))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+	}
+
+	auto runDifferentialCheck(const DifferentialOptions & options, std::ostream * log)
+		-> DifferentialResult
+	{
+		using Engine = NeuralLayer::Engine;
+		auto poolOptions = WorkerPoolOptions{};
+		poolOptions.threads   = 3;
+		poolOptions.placement = WorkerPoolOptions::Placement::none;
+		const auto pool = std::make_shared<WorkerPool>(poolOptions);
+
+		// Tiny blocks make every kernel run through its remainder paths.
+		auto tiny = kernels::Blocking{};
+		tiny.vector_block = 3;
+		tiny.gemm_mc      = 5;
+		tiny.gemm_kc      = 7;
+		tiny.gemm_nc      = 9;
+
+		// fp16 and bf16 keep 11 and 8 significant bits of the weights, and
+		// the sums of a layer add up the rounding of all their terms.
+		const auto fp16Tolerance = 5.0e-3;
+		const auto bf16Tolerance = 5.0e-2;
+
+		const auto variants = std::vector<Variant>{
+			{"blocked", [](NeuralNet & net, size_t) {
+				net.setEngine(Engine::blocked);
+			}, Variant::Passes::train, false},
+			{"blocked with tiny blocks", [tiny](NeuralNet & net, size_t layers) {
+				net.setEngine(Engine::blocked);
+				for (auto l = size_t{0}; l < layers; ++l) net.setLayerBlocking(l, tiny);
+			}, Variant::Passes::train, false},
+			{"blocked on worker pool", [pool](NeuralNet & net, size_t layers) {
+				net.setEngine(Engine::blocked);
+				net.setWorkerPool(pool);
+				for (auto l = size_t{0}; l < layers; ++l) net.setLayerThreads(l, pool->size());
+			}, Variant::Passes::train, false},
+			{"blocked with deferred updates", [](NeuralNet & net, size_t) {
+				net.setEngine(Engine::blocked);
+			}, Variant::Passes::train, true},
+			{"compiled", [](NeuralNet & net, size_t) {
+				net.compile();
+			}, Variant::Passes::train, false},
+			{"compiled on worker pool", [pool](NeuralNet & net, size_t layers) {
+				net.setWorkerPool(pool);
+				for (auto l = size_t{0}; l < layers; ++l) net.setLayerThreads(l, pool->size());
+				net.compile();
+			}, Variant::Passes::train, false},
+			{"incremental", [](NeuralNet & net, size_t) {
+				net.setIncremental(true);
+			}, Variant::Passes::sparse, false},
+			{"fp16", [](NeuralNet & net, size_t) {
+				net.setEngine(Engine::blocked);
+				net.setWeightFormat(NeuralLayer::WeightFormat::fp16);
+			}, Variant::Passes::forward, false, fp16Tolerance},
+			{"bf16", [](NeuralNet & net, size_t) {
+				net.setEngine(Engine::blocked);
+				net.setWeightFormat(NeuralLayer::WeightFormat::bf16);
+			}, Variant::Passes::forward, false, bf16Tolerance},
+			{"bf16 with half inputs", [](NeuralNet & net, size_t) {
+				net.setEngine(Engine::blocked);
+				net.setWeightFormat(NeuralLayer::WeightFormat::bf16, true);
+			}, Variant::Passes::forward, false, bf16Tolerance},
+		};
+
+		const auto convolutionVariants = std::vector<ConvolutionVariant>{
+			{"convolutional stacked", [](std::mt19937_64 & random, std::vector<uint64_t> & topology, std::vector<Convolution> & convolutions) {
+				auto planes = std::uniform_int_distribution<size_t>{3, 6};
+				auto first  = randomConvolution(random, 1, 2, planes(random), planes(random), false);
+				auto second = randomConvolution(
+					random, 2, first.channels, first.outputHeight(), first.outputWidth(), false);
+				topology     = {first.countInputs(), first.countOutputs(), second.countOutputs(), 2};
+				convolutions = {first, second};
+			}},
+			{"convolutional padded and strided", [](std::mt19937_64 & random, std::vector<uint64_t> & topology, std::vector<Convolution> & convolutions) {
+				auto planes      = std::uniform_int_distribution<size_t>{3, 7};
+				auto convolution = randomConvolution(random, 1, 2, planes(random), planes(random), true);
+				topology     = {convolution.countInputs(), convolution.countOutputs(), 3};
+				convolutions = {convolution};
+			}},
+			{"dense to convolutional", [](std::mt19937_64 & random, std::vector<uint64_t> & topology, std::vector<Convolution> & convolutions) {
+				auto planes      = std::uniform_int_distribution<size_t>{3, 5};
+				auto convolution = randomConvolution(random, 2, 2, planes(random), planes(random), true);
+				topology     = {5, convolution.countInputs(), convolution.countOutputs(), 2};
+				convolutions = {convolution};
+			}},
+		};
+
+		auto result = DifferentialResult{};
+		auto seeds  = std::mt19937_64{options.seed};
+		const auto runCases = [&](const char * name, const std::function<bool(uint64_t)> & run) {
+			const auto checkedBefore = result.count_checked;
+			auto maxError = 0.0;
+			// Every variant runs the same cases.
+			seeds.seed(options.seed);
+			for (auto i = size_t{0}; i < options.cases; ++i) {
+				// The first case uses the master seed itself so that a
+				// reported case seed reproduces the case on its own.
+				const auto caseSeed = i == 0 ? options.seed : seeds();
+				result.max_relative_error = 0.0;
+				if (!run(caseSeed)) {
+					return false;
+				}
+				maxError = std::max(maxError, result.max_relative_error);
+			}
+			result.max_relative_error = maxError;
+			if (log != nullptr) {
+				*log << name << ": " << options.cases << " cases, "
+				     << result.count_checked - checkedBefore << " values agree, "
+				     << "max relative error " << maxError << '\n';
+			}
+			return true;
+		};
+		for (auto& variant : variants) {
+			if (!runCases(variant.name, [&](uint64_t caseSeed) {
+				return runCase(options, variant, caseSeed, result);
+			})) {
+				return result;
+			}
+		}
+		for (auto strategy : {PruningOptions::Strategy::threshold, PruningOptions::Strategy::top_k}) {
+			const auto name = strategy == PruningOptions::Strategy::threshold
+				? "pruned with threshold 0" : "pruned to top k";
+			if (!runCases(name, [&](uint64_t caseSeed) {
+				return runPruningCase(options, name, strategy, caseSeed, result);
+			})) {
+				return result;
+			}
+		}
+		if (!runCases("ensemble", [&](uint64_t caseSeed) {
+			return runEnsembleCase(options, caseSeed, result);
+		})) {
+			return result;
+		}
+		if (!runCases("pipeline", [&](uint64_t caseSeed) {
+			return runPipelineCase(options, caseSeed, result);
+		})) {
+			return result;
+		}
+		if (!runCases("result cache", [&](uint64_t caseSeed) {
+			return runResultCacheCase(options, caseSeed, result);
+		})) {
+			return result;
+		}
+		for (auto& variant : convolutionVariants) {
+			if (!runCases(variant.name, [&](uint64_t caseSeed) {
+				return runConvolutionCase(options, variant, caseSeed, result);
+			})) {
+				return result;
+			}
+		}
+		result.variant.clear();
+		result.topology.clear();
+		return result;
+	}
+
+	auto operator<<(std::ostream & out, const DifferentialResult & result)
+		-> std::ostream &
+	{
+		if (result.passed) {
+			return out << "passed, " << result.count_checked << " values agree";
+		}
+		const auto precision = out.precision(std::numeric_limits<double>::max_digits10);
+		out << "FAILED: variant '" << result.variant << "'"
+		    << ", case seed " << result.case_seed
+		    << ", topology";
+		for (auto count : result.topology) {
+			out << ' ' << count;
+		}
+		out << ", pass " << result.pass
+		    << ", " << result.quantity << " #" << result.index
+		    << ": reference " << result.reference
+		    << " vs optimized " << result.optimized;
+		out.precision(precision);
+		return out;
+	}
+}
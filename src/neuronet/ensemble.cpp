@@ -0,0 +1,137 @@
+#include <cassert>
+#include <algorithm>
+#include <stdexcept>
+
+#include "neuronet/ensemble.hpp"
+#include "neuronet/neural_net.hpp"
+#include "neuronet/neural_layer.hpp"
+#include "neuronet/kernels.hpp"
+
+namespace neuronet {
+	Ensemble::Ensemble(const std::vector<const NeuralNet *> & members):
+		m_count_members{members.size()},
+		m_stride{0}
+	{
+		if (members.empty()) {
+			throw std::invalid_argument{"an ensemble needs at least one member."};
+		}
+		for (auto& layer : members.front()->getLayers()) {
+			m_topology.push_back(layer.size());
+		}
+		for (auto member : members) {
+			const auto& layers = member->getLayers();
+			if (std::any_of(layers.begin(), layers.end(),
+				[](const NeuralLayer & layer) { return layer.isConvolutional(); }))
+			{
+				throw std::invalid_argument{"the members of an ensemble can't have convolutional layers."};
+			}
+			if (layers.size() != m_topology.size()
+				|| !std::equal(layers.begin(), layers.end(), m_topology.begin(),
+					[](const NeuralLayer & layer, uint64_t count) { return layer.size() == count; }))
+			{
+				throw std::invalid_argument{"all members of an ensemble must have the same topology."};
+			}
+		}
+
+		m_weights.resize(m_topology.size() - 1);
+		auto maxRows = size_t{0};
+		for (auto l = size_t{1}; l < m_topology.size(); ++l) {
+			auto& stacked = m_weights[l - 1];
+			stacked.reserve(m_count_members * m_topology[l] * (m_topology[l - 1] + 1));
+			for (auto member : members) {
+				const auto& weights = member->getLayers()[l].getWeights();
+				stacked.insert(stacked.end(), weights.begin(), weights.end());
+			}
+			m_stride = std::max<size_t>(m_stride, m_topology[l] + 1);
+			maxRows  = std::max<size_t>(maxRows, m_topology[l]);
+		}
+		m_input.resize(m_topology.front() + 1);
+		m_activations.resize(m_count_members * m_stride);
+		m_sums.resize(m_count_members * maxRows);
+	}
+
+	void Ensemble::predict(
+		const double * inputValues, size_t count,
+		Reduction reduction, double * outputValues
+	) {
+		assert(count == m_topology.front() &&
+			"inputValues must have the same size as the input layer of the members.");
+		(void) count;
+		std::copy(inputValues, inputValues + m_topology.front(), m_input.begin());
+		m_input.back() = 1.0;
+
+		for (auto l = size_t{1}; l < m_topology.size(); ++l) {
+			const auto rows    = m_topology[l];
+			const auto cols    = m_topology[l - 1] + 1;
+			const auto weights = m_weights[l - 1].data();
+			if (l == 1) {
+				// All members share the input: one product over the
+				// rows of all members.
+				kernels::gemv(m_count_members * rows, cols, weights, cols, m_input.data(), m_sums.data());
+			}
+			else {
+				for (auto member = size_t{0}; member < m_count_members; ++member) {
+					kernels::gemv(
+						rows, cols, weights + member * rows * cols, cols,
+						m_activations.data() + member * m_stride, m_sums.data() + member * rows);
+				}
+			}
+			for (auto member = size_t{0}; member < m_count_members; ++member) {
+				const auto sums        = m_sums.data() + member * rows;
+				const auto activations = m_activations.data() + member * m_stride;
+				std::transform(sums, sums + rows, activations, Neuron::transferFunction);
+				activations[rows] = 1.0;
+			}
+		}
+
+		const auto countOutputs = m_topology.back();
+		if (reduction == Reduction::none) {
+			for (auto member = size_t{0}; member < m_count_members; ++member) {
+				const auto outputs = m_activations.data() + member * m_stride;
+				std::copy(outputs, outputs + countOutputs, outputValues + member * countOutputs);
+			}
+			return;
+		}
+		std::fill(outputValues, outputValues + countOutputs, 0.0);
+		const auto share = 1.0 / m_count_members;
+		for (auto member = size_t{0}; member < m_count_members; ++member) {
+			const auto outputs = m_activations.data() + member * m_stride;
+			if (reduction == Reduction::mean) {
+				for (auto o = size_t{0}; o < countOutputs; ++o) {
+					outputValues[o] += outputs[o] * share;
+				}
+			}
+			else {
+				outputValues[std::max_element(outputs, outputs + countOutputs) - outputs] += share;
+			}
+		}
+	}
+
+	auto Ensemble::predict(const std::vector<double> & inputValues, Reduction reduction)
+		-> std::vector<double>
+	{
+		auto outputValues = std::vector<double>(countOutputs(reduction));
+		predict(inputValues.data(), inputValues.size(), reduction, outputValues.data());
+		return outputValues;
+	}
+
+	auto Ensemble::countMembers() const
+		-> size_t
+	{
+		return m_count_members;
+	}
+
+	auto Ensemble::countOutputs(Reduction reduction) const
+		-> size_t
+	{
+		return reduction == Reduction::none
+			? m_count_members * m_topology.back()
+			: m_topology.back();
+	}
+
+	auto Ensemble::getTopology() const
+		-> const std::vector<uint64_t> &
+	{
+		return m_topology;
+	}
+}
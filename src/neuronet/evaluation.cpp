@@ -0,0 +1,31 @@
+#include "neuronet/evaluation.hpp"
+
+namespace neuronet {
+	auto EvaluationResult::accuracy() const
+		-> double
+	{
+		return passes == 0 ? 0.0 : static_cast<double>(correct) / passes;
+	}
+
+	auto operator<<(std::ostream & os, const EvaluationResult & result) -> std::ostream & {
+		os << "evaluated " << result.passes << " passes\n"
+		   << "\trms error: " << result.rms_error << '\n'
+		   << "\tmean pass error: " << result.mean_pass_error << '\n';
+		for (auto output = size_t{0}; output < result.output_errors.size(); ++output) {
+			os << "\toutput " << output << " rms error: " << result.output_errors[output] << '\n';
+		}
+		if (result.classes > 0) {
+			os << "\taccuracy: " << result.accuracy()
+			   << " (" << result.correct << " of " << result.passes << ")\n"
+			   << "\tconfusion (expected by predicted):\n";
+			for (auto expected = size_t{0}; expected < result.classes; ++expected) {
+				os << '\t';
+				for (auto predicted = size_t{0}; predicted < result.classes; ++predicted) {
+					os << '\t' << result.confusion[expected * result.classes + predicted];
+				}
+				os << '\n';
+			}
+		}
+		return os;
+	}
+}
@@ -0,0 +1,153 @@
+#include <cassert>
+#include <algorithm>
+
+#include "neuronet/execution_plan.hpp"
+#include "neuronet/neural_net.hpp"
+#include "neuronet/neural_layer.hpp"
+#include "neuronet/neural_connection.hpp"
+#include "neuronet/neuron.hpp"
+#include "neuronet/worker_pool.hpp"
+#include "neuronet/kernels.hpp"
+
+namespace neuronet {
+	ExecutionPlan::ExecutionPlan(const NeuralNet & net, std::vector<NeuralLayer> & layers):
+		m_net(net)
+	{
+		auto countActivations = size_t{0};
+		auto countGradients   = size_t{0};
+		auto widest           = size_t{0};
+		for (auto& layer : layers) {
+			countActivations += layer.size() + 1;
+			widest = std::max(widest, layer.size());
+			if (!layer.isInputLayer()) countGradients += layer.size();
+		}
+		m_activations.resize(countActivations);
+		m_gradients.resize(countGradients);
+		m_sums.resize(widest);
+
+		auto inputs    = m_activations.data();
+		auto gradients = m_gradients.data();
+		for (auto l = size_t{1}; l < layers.size(); ++l) {
+			auto& layer = layers[l];
+			auto op = Op{};
+			op.layer         = &layer;
+			op.rows          = layer.size();
+			op.cols          = layers[l - 1].size();
+			op.lda           = layer.countIncConnections();
+			op.weights       = &layer.weightOf(0, 0);
+			op.delta_weights = &layer.deltaWeightOf(0, 0);
+			op.inputs        = inputs;
+			op.outputs       = inputs + op.cols + 1;
+			op.gradients     = gradients;
+			assert(op.lda == op.cols + 1 &&
+				"the bias must be the last column of the weight matrix of a layer.");
+			// Every layer is followed by the constant output of the bias.
+			const auto& bias = layer.begin()->getIncConnections().back()->getSource();
+			inputs[op.cols] = bias.getOutput();
+			m_ops.push_back(op);
+			inputs     = op.outputs;
+			gradients += op.rows;
+		}
+	}
+
+	template <typename Task>
+	void ExecutionPlan::splitRows(const Op & op, size_t count, const Task & task) {
+		const auto& pool   = m_net.getWorkerPool();
+		const auto threads = op.layer->getThreads();
+		if (pool == nullptr || threads <= 1) {
+			task(0, count);
+			return;
+		}
+		pool->parallelFor(count, threads, [&task](size_t first, size_t last, size_t) {
+			task(first, last);
+		});
+	}
+
+	void ExecutionPlan::setInputs(const double * inputValues) {
+		std::copy(inputValues, inputValues + m_ops.front().cols, m_activations.begin());
+	}
+
+	void ExecutionPlan::feedForward(size_t index) {
+		assert(index < m_ops.size() && "there is no op of this index.");
+		auto& op = m_ops[index];
+		splitRows(op, op.rows, [&op](size_t first, size_t last) {
+			const auto weights = op.weights + first * op.lda;
+			kernels::gemv(
+				last - first, op.cols,
+				weights, op.lda,
+				op.inputs, op.outputs + first,
+				op.layer->getBlocking());
+			const auto bias = op.inputs[op.cols];
+			for (auto row = first; row < last; ++row) {
+				const auto biasWeight = op.weights[row * op.lda + op.cols];
+				op.outputs[row] = Neuron::transferFunction(op.outputs[row] + biasWeight * bias);
+			}
+		});
+	}
+
+	void ExecutionPlan::calculateOutputGradients(const double * targetValues) {
+		const auto& output = m_ops.back();
+		for (auto row = size_t{0}; row < output.rows; ++row) {
+			const auto delta = targetValues[row] - output.outputs[row];
+			output.gradients[row] = delta * Neuron::transferFunctionDerivate(output.outputs[row]);
+		}
+	}
+
+	void ExecutionPlan::calculateHiddenGradients() {
+		// The gradients of a hidden layer are the transposed product of
+		// the weights of the next layer with its gradients; the bias
+		// column of the next layer has no gradient to receive.
+		for (auto i = m_ops.size() - 1; i > 0; --i) {
+			auto& next = m_ops[i];
+			auto& op   = m_ops[i - 1];
+			splitRows(op, op.rows, [this, &next](size_t first, size_t last) {
+				kernels::gemvTransposed(
+					next.rows, last - first,
+					next.weights + first, next.lda,
+					next.gradients, m_sums.data() + first,
+					next.layer->getBlocking());
+			});
+			for (auto row = size_t{0}; row < op.rows; ++row) {
+				op.gradients[row] = m_sums[row] * Neuron::transferFunctionDerivate(op.outputs[row]);
+			}
+		}
+	}
+
+	void ExecutionPlan::updateWeights() {
+		for (auto& op : m_ops) {
+			const auto eta   = op.layer->getTrainingRate();
+			const auto alpha = op.layer->getMomentum();
+			splitRows(op, op.rows, [&op, eta, alpha](size_t first, size_t last) {
+				const auto offset = first * op.lda;
+				kernels::updateWithMomentum(
+					last - first, op.lda,
+					op.weights + offset, op.delta_weights + offset, op.lda,
+					eta, op.gradients + first, op.inputs,
+					alpha,
+					op.layer->getBlocking());
+			});
+		}
+	}
+
+	auto ExecutionPlan::getOutputs() const
+		-> const double *
+	{
+		return m_ops.back().outputs;
+	}
+
+	auto ExecutionPlan::countOps() const
+		-> size_t
+	{
+		return m_ops.size();
+	}
+
+	auto ExecutionPlan::memoryUsage() const
+		-> MemoryUsage
+	{
+		auto usage = MemoryUsage{};
+		usage.activations = (m_activations.capacity() + m_gradients.capacity() + m_sums.capacity())
+		                  * sizeof(double);
+		usage.connection_metadata = sizeof(ExecutionPlan) + m_ops.capacity() * sizeof(Op);
+		return usage;
+	}
+}
@@ -0,0 +1,312 @@
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#include <immintrin.h>
+	#define NN_HALF_KERNELS_X86 1
+#else
+	#define NN_HALF_KERNELS_X86 0
+#endif
+
+#include "neuronet/kernels.hpp"
+
+namespace neuronet {
+	namespace kernels {
+		namespace {
+			auto bitsOf(float value)
+				-> uint32_t
+			{
+				auto bits = uint32_t{0};
+				std::memcpy(&bits, &value, sizeof(bits));
+				return bits;
+			}
+
+			auto floatOf(uint32_t bits)
+				-> float
+			{
+				auto value = 0.0f;
+				std::memcpy(&value, &bits, sizeof(value));
+				return value;
+			}
+
+			//====================================================================
+			// Rounds a float to the nearest half precision value, ties to even.
+			// Values too small for a normal half are rounded by the float unit
+			// itself: adding 0.5 moves them to where the ulp of the float is
+			// the ulp of a subnormal half.
+			//====================================================================
+			auto floatToFp16(float value)
+				-> uint16_t
+			{
+				auto bits       = bitsOf(value);
+				const auto sign = (bits >> 16) & 0x8000u;
+				bits &= 0x7fffffffu;
+				if (bits >= 0x7f800000u) {
+					// Infinity stays infinity, NaN stays a quiet NaN.
+					return static_cast<uint16_t>(sign | (bits > 0x7f800000u ? 0x7e00u : 0x7c00u));
+				}
+				if (bits >= 0x477ff000u) {
+					// Rounds to a value beyond the biggest half.
+					return static_cast<uint16_t>(sign | 0x7c00u);
+				}
+				if (bits < 0x38800000u) {
+					const auto rounded = floatOf(bits) + 0.5f;
+					return static_cast<uint16_t>(sign | (bitsOf(rounded) - 0x3f000000u));
+				}
+				const auto odd = (bits >> 13) & 1u;
+				// Rebiases the exponent from 127 to 15 and rounds the
+				// 13 dropped mantissa bits.
+				bits += ((15u - 127u) << 23) + 0xfffu + odd;
+				return static_cast<uint16_t>(sign | (bits >> 13));
+			}
+
+			auto fp16ToFloat(uint16_t half)
+				-> float
+			{
+				const auto sign     = static_cast<uint32_t>(half & 0x8000u) << 16;
+				const auto exponent = (half >> 10) & 0x1fu;
+				const auto mantissa = static_cast<uint32_t>(half & 0x3ffu);
+				if (exponent == 0) {
+					const auto value = static_cast<float>(mantissa) * floatOf(0x33800000u); // 2^-24
+					return floatOf(sign | bitsOf(value));
+				}
+				if (exponent == 0x1fu) {
+					return floatOf(sign | 0x7f800000u | (mantissa << 13));
+				}
+				return floatOf(sign | ((exponent + 127u - 15u) << 23) | (mantissa << 13));
+			}
+
+			auto floatToBf16(float value)
+				-> uint16_t
+			{
+				const auto bits = bitsOf(value);
+				if ((bits & 0x7fffffffu) > 0x7f800000u) {
+					return static_cast<uint16_t>((bits >> 16) | 0x40u);
+				}
+				return static_cast<uint16_t>((bits + 0x7fffu + ((bits >> 16) & 1u)) >> 16);
+			}
+
+			auto bf16ToFloat(uint16_t half)
+				-> float
+			{
+				return floatOf(static_cast<uint32_t>(half) << 16);
+			}
+
+			auto toHalf(HalfFormat format, float value)
+				-> uint16_t
+			{
+				return format == HalfFormat::fp16 ? floatToFp16(value) : floatToBf16(value);
+			}
+
+			auto toFloat(HalfFormat format, uint16_t half)
+				-> float
+			{
+				return format == HalfFormat::fp16 ? fp16ToFloat(half) : bf16ToFloat(half);
+			}
+
+			//====================================================================
+			// Input vector of gemvHalf as floats, rounded through the 16 bit
+			// format for halfInputs and padded with zeros to whole vectors.
+			//====================================================================
+			constexpr size_t input_padding = 32;
+
+			auto floatInputs(HalfFormat format, const double * x, size_t cols, bool halfInputs)
+				-> const float *
+			{
+				thread_local std::vector<float> inputs;
+				inputs.assign(cols + input_padding, 0.0f);
+				for (auto column = size_t{0}; column < cols; ++column) {
+					const auto value = static_cast<float>(x[column]);
+					inputs[column] = halfInputs ? toFloat(format, toHalf(format, value)) : value;
+				}
+				return inputs.data();
+			}
+
+			void gemvScalar(
+				HalfFormat format,
+				size_t rows, size_t cols,
+				const uint16_t * a, size_t lda,
+				const float * x, double * y
+			) {
+				for (auto row = size_t{0}; row < rows; ++row) {
+					const auto weights = a + row * lda;
+					float sums[lanes] = {};
+					auto column = size_t{0};
+					for (; column + lanes <= cols; column += lanes) {
+						for (auto lane = size_t{0}; lane < lanes; ++lane) {
+							sums[lane] += toFloat(format, weights[column + lane]) * x[column + lane];
+						}
+					}
+					for (; column < cols; ++column) {
+						sums[0] += toFloat(format, weights[column]) * x[column];
+					}
+					y[row] = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+				}
+			}
+
+#if NN_HALF_KERNELS_X86
+			__attribute__((target("avx2,fma,f16c")))
+			auto widen(HalfFormat format, const uint16_t * values)
+				-> __m256
+			{
+				const auto halves = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values));
+				if (format == HalfFormat::fp16) {
+					return _mm256_cvtph_ps(halves);
+				}
+				return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(halves), 16));
+			}
+
+			__attribute__((target("avx2,fma,f16c")))
+			auto horizontalSum(__m256 sums)
+				-> float
+			{
+				const auto halves = _mm_add_ps(_mm256_castps256_ps128(sums), _mm256_extractf128_ps(sums, 1));
+				const auto pairs  = _mm_add_ps(halves, _mm_movehl_ps(halves, halves));
+				return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+			}
+
+			//====================================================================
+			// Widens 8 weights of row_tile rows at once with F16C or, for bf16,
+			// by shifting them into the upper half of a float and multiplies
+			// them with the float inputs.
+			//====================================================================
+			__attribute__((target("avx2,fma,f16c")))
+			void gemvAvx2(
+				HalfFormat format,
+				size_t rows, size_t cols,
+				const uint16_t * a, size_t lda,
+				const float * x, double * y
+			) {
+				constexpr auto width = size_t{8};
+				auto row = size_t{0};
+				for (; row + row_tile <= rows; row += row_tile) {
+					__m256 sums[row_tile];
+					for (auto i = size_t{0}; i < row_tile; ++i) sums[i] = _mm256_setzero_ps();
+					auto column = size_t{0};
+					for (; column + width <= cols; column += width) {
+						const auto inputs = _mm256_loadu_ps(x + column);
+						for (auto i = size_t{0}; i < row_tile; ++i) {
+							sums[i] = _mm256_fmadd_ps(widen(format, a + (row + i) * lda + column), inputs, sums[i]);
+						}
+					}
+					for (auto i = size_t{0}; i < row_tile; ++i) {
+						auto sum = horizontalSum(sums[i]);
+						for (auto rest = column; rest < cols; ++rest) {
+							sum += toFloat(format, a[(row + i) * lda + rest]) * x[rest];
+						}
+						y[row + i] = sum;
+					}
+				}
+				gemvScalar(format, rows - row, cols, a + row * lda, lda, x, y + row);
+			}
+
+			//====================================================================
+			// Multiplies pairs of bf16 weights with pairs of bf16 inputs and
+			// accumulates them in float, 32 products per instruction.
+			//====================================================================
+			__attribute__((target("avx512f,avx512bw,avx512bf16")))
+			void gemvAvx512Bf16(
+				size_t rows, size_t cols,
+				const uint16_t * a, size_t lda,
+				const float * x, double * y
+			) {
+				constexpr auto width = size_t{32};
+				thread_local std::vector<uint16_t> inputs;
+				inputs.resize(cols + input_padding);
+				for (auto column = size_t{0}; column < inputs.size(); ++column) {
+					inputs[column] = floatToBf16(x[column]);
+				}
+				for (auto row = size_t{0}; row < rows; ++row) {
+					const auto weights = a + row * lda;
+					auto sums   = _mm512_setzero_ps();
+					auto column = size_t{0};
+					for (; column + width <= cols; column += width) {
+						const auto w = _mm512_loadu_si512(weights + column);
+						const auto v = _mm512_loadu_si512(inputs.data() + column);
+						sums = _mm512_dpbf16_ps(sums, (__m512bh) w, (__m512bh) v);
+					}
+					alignas(64) float partial[16];
+					_mm512_store_ps(partial, sums);
+					auto sum = 0.0f;
+					for (auto value : partial) sum += value;
+					for (; column < cols; ++column) {
+						sum += bf16ToFloat(weights[column]) * x[column];
+					}
+					y[row] = sum;
+				}
+			}
+#endif
+
+			enum class Implementation {
+				scalar,
+				avx2,
+				avx512_bf16
+			};
+
+			auto chooseImplementation(HalfFormat format, bool halfInputs)
+				-> Implementation
+			{
+#if NN_HALF_KERNELS_X86
+				if (format == HalfFormat::bf16 && halfInputs
+					&& __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+					&& __builtin_cpu_supports("avx512bf16"))
+				{
+					return Implementation::avx512_bf16;
+				}
+				if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")
+					&& __builtin_cpu_supports("f16c"))
+				{
+					return Implementation::avx2;
+				}
+#endif
+				(void) format;
+				(void) halfInputs;
+				return Implementation::scalar;
+			}
+		}
+
+		void toHalf(HalfFormat format, const double * x, size_t count, uint16_t * y) {
+			for (auto i = size_t{0}; i < count; ++i) {
+				y[i] = toHalf(format, static_cast<float>(x[i]));
+			}
+		}
+
+		void fromHalf(HalfFormat format, const uint16_t * x, size_t count, double * y) {
+			for (auto i = size_t{0}; i < count; ++i) {
+				y[i] = toFloat(format, x[i]);
+			}
+		}
+
+		void gemvHalf(
+			HalfFormat format,
+			size_t rows, size_t cols,
+			const uint16_t * a, size_t lda,
+			const double * x, bool halfInputs, double * y
+		) {
+			const auto inputs = floatInputs(format, x, cols, halfInputs);
+			switch (chooseImplementation(format, halfInputs)) {
+#if NN_HALF_KERNELS_X86
+				case Implementation::avx512_bf16:
+					gemvAvx512Bf16(rows, cols, a, lda, inputs, y);
+					return;
+				case Implementation::avx2:
+					gemvAvx2(format, rows, cols, a, lda, inputs, y);
+					return;
+#endif
+				default:
+					gemvScalar(format, rows, cols, a, lda, inputs, y);
+			}
+		}
+
+		auto describeGemvHalf(HalfFormat format, bool halfInputs)
+			-> const char *
+		{
+			switch (chooseImplementation(format, halfInputs)) {
+				case Implementation::avx512_bf16: return "avx512-bf16";
+				case Implementation::avx2:        return "avx2-f16c";
+				default:                          return "scalar";
+			}
+		}
+	}
+}
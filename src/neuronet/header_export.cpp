@@ -0,0 +1,182 @@
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <limits>
+
+#include "neuronet/header_export.hpp"
+#include "neuronet/neural_net.hpp"
+#include "neuronet/neural_layer.hpp"
+
+namespace neuronet {
+	namespace {
+		//====================================================================
+		// The keywords and alternative tokens of C++ up to C++20, which are
+		// spelled like identifiers but can't name a namespace or a macro.
+		//====================================================================
+		bool isKeyword(const std::string & name) {
+			static const char * const keywords[] = {
+				"alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand",
+				"bitor", "bool", "break", "case", "catch", "char", "char8_t",
+				"char16_t", "char32_t", "class", "co_await", "co_return",
+				"co_yield", "compl", "concept", "const", "const_cast", "consteval",
+				"constexpr", "constinit", "continue", "decltype", "default",
+				"delete", "do", "double", "dynamic_cast", "else", "enum",
+				"explicit", "export", "extern", "false", "float", "for", "friend",
+				"goto", "if", "inline", "int", "long", "mutable", "namespace",
+				"new", "noexcept", "not", "not_eq", "nullptr", "operator", "or",
+				"or_eq", "private", "protected", "public", "register",
+				"reinterpret_cast", "requires", "return", "short", "signed",
+				"sizeof", "static", "static_assert", "static_cast", "struct",
+				"switch", "template", "this", "thread_local", "throw", "true",
+				"try", "typedef", "typeid", "typename", "union", "unsigned",
+				"using", "virtual", "void", "volatile", "wchar_t", "while", "xor",
+				"xor_eq"
+			};
+			return std::any_of(std::begin(keywords), std::end(keywords),
+				[&name](const char * keyword) { return name == keyword; });
+		}
+
+		bool isIdentifier(const std::string & name) {
+			if (name.empty()) return false;
+			if (std::isdigit(static_cast<unsigned char>(name.front()))) return false;
+			return std::all_of(name.begin(), name.end(), [](char c) {
+				return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+			}) && !isKeyword(name);
+		}
+
+		//====================================================================
+		// Writes the given value as a float literal that reads back to the
+		// same float. Scientific notation always yields a valid literal
+		// for the 'f' suffix, even for integral values.
+		//====================================================================
+		void writeFloat(std::ostream & out, double value) {
+			out << static_cast<float>(value) << 'f';
+		}
+	}
+
+	void exportInferenceHeader(
+		const NeuralNet & net, std::ostream & out,
+		const HeaderExportOptions & options
+	) {
+		using namespace std::string_literals;
+		if (!isIdentifier(options.name_space)) {
+			throw std::invalid_argument{"invalid namespace for the exported header: "s + options.name_space};
+		}
+		auto guard = options.include_guard;
+		if (guard.empty()) {
+			guard = options.name_space + "_H";
+			std::transform(guard.begin(), guard.end(), guard.begin(), [](char c) {
+				return static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+			});
+		}
+		if (!isIdentifier(guard)) {
+			throw std::invalid_argument{"invalid include guard for the exported header: "s + guard};
+		}
+
+		const auto& layers = net.getLayers();
+		assert(layers.size() >= 2 &&
+			"there must be at least one layer besides the input layer.");
+		for (auto& layer : layers) {
+			if (layer.isConvolutional()) {
+				throw std::invalid_argument{"convolutional layers can't be exported to a header."};
+			}
+			// NaN, infinity and doubles beyond the range of float have no
+			// float literal, and nothing may be written before failing.
+			for (auto weight : layer.getWeights()) {
+				if (!std::isfinite(static_cast<float>(weight))) {
+					throw std::invalid_argument{"weights that aren't finite floats can't be exported to a header."};
+				}
+			}
+		}
+		auto maxWidth = size_t{0};
+		for (auto l = size_t{1}; l + 1 < layers.size(); ++l) {
+			maxWidth = std::max(maxWidth, layers[l].size());
+		}
+
+		const auto flags     = out.flags();
+		const auto precision = out.precision(std::numeric_limits<float>::max_digits10 - 1);
+		out.setf(std::ios::scientific, std::ios::floatfield);
+
+		out << "// Generated by neuronet from a trained neural net; do not edit.\n"
+		    << "#ifndef " << guard << '\n'
+		    << "#define " << guard << "\n\n"
+		    << "#include <cmath>\n"
+		    << "#include <cstddef>\n\n"
+		    << "namespace " << options.name_space << " {\n"
+		    << "\tconstexpr std::size_t topology[] = {";
+		for (auto l = size_t{0}; l < layers.size(); ++l) {
+			out << (l == 0 ? "" : ", ") << layers[l].size();
+		}
+		out << "};\n"
+		    << "\tconstexpr std::size_t input_size  = " << layers.front().size() << ";\n"
+		    << "\tconstexpr std::size_t output_size = " << layers.back().size() << ";\n\n"
+		    << "\tnamespace detail {\n";
+
+		// The weights of a layer are row-major with the bias weight
+		// within the last column; they are emitted split into a
+		// weight matrix and a bias vector.
+		for (auto l = size_t{1}; l < layers.size(); ++l) {
+			const auto& weights = layers[l].getWeights();
+			const auto  rows    = layers[l].size();
+			const auto  cols    = layers[l].countIncConnections();
+			out << "\t\tconstexpr float weights_" << l
+			    << '[' << rows << "][" << cols - 1 << "] = {\n";
+			for (auto row = size_t{0}; row < rows; ++row) {
+				out << "\t\t\t{";
+				for (auto col = size_t{0}; col + 1 < cols; ++col) {
+					out << (col == 0 ? "" : ", ");
+					writeFloat(out, weights[row * cols + col]);
+				}
+				out << "},\n";
+			}
+			out << "\t\t};\n"
+			    << "\t\tconstexpr float bias_" << l << '[' << rows << "] = {";
+			for (auto row = size_t{0}; row < rows; ++row) {
+				out << (row == 0 ? "" : ", ");
+				writeFloat(out, weights[row * cols + cols - 1]);
+			}
+			out << "};\n\n";
+		}
+
+		out << "\t\tinline float activate(float x) {\n"
+		    << "\t\t\treturn std::tanh(x);\n"
+		    << "\t\t}\n\n"
+		    << "\t\ttemplate <std::size_t Rows, std::size_t Cols>\n"
+		    << "\t\tinline void dense(\n"
+		    << "\t\t\tconst float (&weights)[Rows][Cols], const float (&bias)[Rows],\n"
+		    << "\t\t\tconst float * input, float * output\n"
+		    << "\t\t) {\n"
+		    << "\t\t\tfor (std::size_t row = 0; row < Rows; ++row) {\n"
+		    << "\t\t\t\tfloat sum = bias[row];\n"
+		    << "\t\t\t\tfor (std::size_t col = 0; col < Cols; ++col) {\n"
+		    << "\t\t\t\t\tsum += weights[row][col] * input[col];\n"
+		    << "\t\t\t\t}\n"
+		    << "\t\t\t\toutput[row] = activate(sum);\n"
+		    << "\t\t\t}\n"
+		    << "\t\t}\n"
+		    << "\t}\n\n"
+		    << "\t// Computes the output_size outputs of the net for its input_size inputs.\n"
+		    << "\tinline void predict(const float * input, float * output) {\n";
+
+		// Hidden layers alternate between two buffers; the output
+		// layer writes directly into the output of predict.
+		if (layers.size() > 2) {
+			out << "\t\tfloat buffers[2][" << maxWidth << "];\n";
+		}
+		for (auto l = size_t{1}; l < layers.size(); ++l) {
+			const auto source = l == 1 ? "input"s : "buffers["s + std::to_string(l % 2) + "]";
+			const auto target = l + 1 == layers.size() ? "output"s : "buffers["s + std::to_string((l + 1) % 2) + "]";
+			out << "\t\tdetail::dense(detail::weights_" << l << ", detail::bias_" << l
+			    << ", " << source << ", " << target << ");\n";
+		}
+		out << "\t}\n"
+		    << "}\n\n"
+		    << "#endif\n";
+
+		out.precision(precision);
+		out.flags(flags);
+	}
+}
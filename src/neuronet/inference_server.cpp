@@ -0,0 +1,352 @@
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <limits>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "neuronet/inference_server.hpp"
+#include "neuronet/neural_net.hpp"
+#include "neuronet/neural_layer.hpp"
+
+namespace neuronet {
+	//===========================================================
+	// BatchScheduler Implementation
+	//===========================================================
+	BatchScheduler::BatchScheduler(const NeuralNet & net, const ServerOptions & options):
+		m_net(net),
+		m_options(options),
+		m_stopped{false},
+		m_count_batches{0},
+		m_count_samples{0},
+		m_busy_time{clock::duration::zero()}
+	{
+		assert(m_options.max_batch_size >= 1 &&
+			"a batch must be able to hold at least one request.");
+		m_worker = std::thread{[this] { run(); }};
+	}
+
+	BatchScheduler::~BatchScheduler() {
+		shutdown();
+	}
+
+	auto BatchScheduler::submit(std::vector<double> inputValues)
+		-> std::future<std::vector<double>>
+	{
+		auto request = Request{std::move(inputValues), {}, clock::now()};
+		auto future  = request.result.get_future();
+		{
+			std::lock_guard<std::mutex> lock{m_mutex};
+			if (m_stopped) {
+				request.result.set_exception(std::make_exception_ptr(std::runtime_error{
+					"the server is shutting down."}));
+				return future;
+			}
+			m_pending.push_back(std::move(request));
+		}
+		m_wakeup.notify_one();
+		return future;
+	}
+
+	void BatchScheduler::shutdown() {
+		{
+			std::lock_guard<std::mutex> lock{m_mutex};
+			m_stopped = true;
+		}
+		m_wakeup.notify_one();
+		if (m_worker.joinable()) {
+			m_worker.join();
+		}
+	}
+
+	void BatchScheduler::run() {
+		auto batch = std::vector<Request>{};
+		batch.reserve(m_options.max_batch_size);
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> lock{m_mutex};
+				m_wakeup.wait(lock, [this] { return m_stopped || !m_pending.empty(); });
+				if (m_pending.empty()) break;
+				// Give other requests the chance to join the batch of the
+				// oldest pending request until its latency budget is spent.
+				const auto deadline = m_pending.front().arrival + m_options.max_latency;
+				m_wakeup.wait_until(lock, deadline, [this] {
+					return m_stopped || m_pending.size() >= m_options.max_batch_size;
+				});
+				while (!m_pending.empty() && batch.size() < m_options.max_batch_size) {
+					batch.push_back(std::move(m_pending.front()));
+					m_pending.pop_front();
+				}
+			}
+			computeBatch(batch);
+			batch.clear();
+		}
+		if (m_options.report != nullptr && m_count_batches > 0) {
+			const auto busy = std::chrono::duration<double>(m_busy_time).count();
+			*m_options.report
+				<< "served " << m_count_samples << " requests in "
+				<< m_count_batches << " batches, "
+				<< "average batch size " << double(m_count_samples) / m_count_batches << ", "
+				<< "throughput " << m_count_samples / busy << " requests/s\n";
+		}
+	}
+
+	void BatchScheduler::computeBatch(std::vector<Request> & batch) {
+		const auto countInputs  = m_net.getLayers().front().size();
+		const auto countOutputs = m_net.getLayers().back().size();
+		const auto start        = clock::now();
+		auto inputValues  = std::vector<double>{};
+		auto outputValues = std::vector<double>{};
+		inputValues.reserve(batch.size() * countInputs);
+		for (auto& request : batch) {
+			inputValues.insert(inputValues.end(), request.input.begin(), request.input.end());
+		}
+		try {
+			m_net.feedForwardBatch(inputValues, batch.size(), outputValues);
+		}
+		catch (...) {
+			// Every request of the batch fails instead of the scheduler
+			// thread, which would take the whole server down with it.
+			for (auto& request : batch) {
+				request.result.set_exception(std::current_exception());
+			}
+			return;
+		}
+		const auto end = clock::now();
+		for (auto i = size_t{0}; i < batch.size(); ++i) {
+			const auto first = outputValues.begin() + i * countOutputs;
+			batch[i].result.set_value(std::vector<double>(first, first + countOutputs));
+		}
+		++m_count_batches;
+		m_count_samples += batch.size();
+		m_busy_time     += end - start;
+		if (m_options.report != nullptr) {
+			using microseconds = std::chrono::duration<double, std::micro>;
+			const auto compute = microseconds(end - start).count();
+			*m_options.report
+				<< "batch size " << batch.size()
+				<< ", latency " << microseconds(end - batch.front().arrival).count() << "us"
+				<< ", compute " << compute << "us"
+				<< ", throughput " << batch.size() / compute * 1.0e6 << " requests/s\n";
+		}
+	}
+
+	//===========================================================
+	// InferenceServer Implementation
+	//===========================================================
+	namespace {
+		auto formatResult(std::future<std::vector<double>> & result)
+			-> std::string
+		{
+			auto line = std::ostringstream{};
+			line.precision(std::numeric_limits<double>::max_digits10);
+			try {
+				const auto outputValues = result.get();
+				line << "output";
+				for (auto value : outputValues) {
+					line << ' ' << value;
+				}
+			}
+			catch (const std::exception & error) {
+				line.str("");
+				line << "error " << error.what();
+			}
+			line << '\n';
+			return line.str();
+		}
+
+		void writeAll(int fd, const std::string & data) {
+			auto written = size_t{0};
+			while (written < data.size()) {
+				// Without MSG_NOSIGNAL a client that hung up would kill the
+				// whole server with SIGPIPE instead of failing its thread.
+				const auto count = ::send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+				if (count < 0) {
+					if (errno == EINTR) continue;
+					throw std::system_error{errno, std::generic_category(), "send"};
+				}
+				written += static_cast<size_t>(count);
+			}
+		}
+	}
+
+	InferenceServer::InferenceServer(const NeuralNet & net, ServerOptions options):
+		m_net(net),
+		m_options(std::move(options)),
+		m_scheduler{m_net, m_options}
+	{}
+
+	void InferenceServer::run() {
+		if (m_options.socket_path.empty()) {
+			serveStream();
+		}
+		else {
+			serveSocket();
+		}
+		m_scheduler.shutdown();
+	}
+
+	auto InferenceServer::answer(const std::string & request)
+		-> std::future<std::vector<double>>
+	{
+		using namespace std::string_literals;
+		auto stream  = std::istringstream{request};
+		auto keyword = ""s;
+		stream >> keyword;
+		auto inputValues = std::vector<double>{};
+		auto value       = 0.0;
+		while (stream >> value) {
+			inputValues.push_back(value);
+		}
+		if (keyword != "input"s || !stream.eof()
+			|| inputValues.size() != m_net.getLayers().front().size())
+		{
+			auto failed = std::promise<std::vector<double>>{};
+			failed.set_exception(std::make_exception_ptr(std::invalid_argument{
+				"expected 'input' followed by one value per input neuron."}));
+			return failed.get_future();
+		}
+		return m_scheduler.submit(std::move(inputValues));
+	}
+
+	void InferenceServer::serveStream() {
+		// Requests are read and submitted without waiting for their
+		// results, so that consecutive lines of stdin can share a batch.
+		// A writer thread answers them in the order they arrived.
+		std::mutex mutex;
+		std::condition_variable ready;
+		auto results = std::deque<std::future<std::vector<double>>>{};
+		auto done    = false;
+		auto writer  = std::thread{[&] {
+			for (;;) {
+				auto result = std::future<std::vector<double>>{};
+				auto last   = false;
+				{
+					std::unique_lock<std::mutex> lock{mutex};
+					ready.wait(lock, [&] { return done || !results.empty(); });
+					if (results.empty()) break;
+					result = std::move(results.front());
+					results.pop_front();
+					last   = results.empty();
+				}
+				std::cout << formatResult(result);
+				if (last) std::cout.flush();
+			}
+			std::cout.flush();
+		}};
+		auto line = std::string{};
+		while (std::getline(std::cin, line)) {
+			if (line.empty()) continue;
+			auto result = answer(line);
+			{
+				std::lock_guard<std::mutex> lock{mutex};
+				results.push_back(std::move(result));
+			}
+			ready.notify_one();
+		}
+		{
+			std::lock_guard<std::mutex> lock{mutex};
+			done = true;
+		}
+		ready.notify_one();
+		writer.join();
+	}
+
+	void InferenceServer::serveSocket() {
+		const auto server = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		if (server < 0) {
+			throw std::system_error{errno, std::generic_category(), "socket"};
+		}
+		auto address = sockaddr_un{};
+		address.sun_family = AF_UNIX;
+		if (m_options.socket_path.size() >= sizeof(address.sun_path)) {
+			::close(server);
+			throw std::invalid_argument{"the path of the socket is too long."};
+		}
+		std::strcpy(address.sun_path, m_options.socket_path.c_str());
+		::unlink(address.sun_path);
+		if (::bind(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0
+			|| ::listen(server, SOMAXCONN) < 0)
+		{
+			const auto error = errno;
+			::close(server);
+			throw std::system_error{error, std::generic_category(), "bind"};
+		}
+		for (;;) {
+			const auto socket = ::accept(server, nullptr, nullptr);
+			if (socket < 0) {
+				if (errno == EINTR) continue;
+				const auto error = errno;
+				::close(server);
+				// The clients use the scheduler, which is shut down and
+				// destroyed with this server.
+				reapClients(true);
+				throw std::system_error{error, std::generic_category(), "accept"};
+			}
+			reapClients(false);
+			m_clients.emplace_back(socket);
+			auto& client = m_clients.back();
+			client.thread = std::thread{[this, &client] {
+				serveClient(client.socket);
+				client.done.store(true, std::memory_order_release);
+			}};
+		}
+	}
+
+	void InferenceServer::reapClients(bool force) {
+		for (auto client = m_clients.begin(); client != m_clients.end();) {
+			if (force) {
+				::shutdown(client->socket, SHUT_RDWR);
+			}
+			else if (!client->done.load(std::memory_order_acquire)) {
+				++client;
+				continue;
+			}
+			client->thread.join();
+			::close(client->socket);
+			client = m_clients.erase(client);
+		}
+	}
+
+	void InferenceServer::serveClient(int client) {
+		char chunk[4096];
+		auto buffer = std::string{};
+		try {
+			for (;;) {
+				const auto count = ::read(client, chunk, sizeof(chunk));
+				if (count < 0 && errno == EINTR) continue;
+				if (count <= 0) break;
+				buffer.append(chunk, static_cast<size_t>(count));
+				// All complete lines of the read are submitted before waiting
+				// for any of their results, so that lines pipelined by the
+				// client can share a batch.
+				auto results = std::vector<std::future<std::vector<double>>>{};
+				auto begin   = size_t{0};
+				auto end     = buffer.find('\n');
+				while (end != std::string::npos) {
+					const auto line = buffer.substr(begin, end - begin);
+					if (!line.empty()) {
+						results.push_back(answer(line));
+					}
+					begin = end + 1;
+					end   = buffer.find('\n', begin);
+				}
+				buffer.erase(0, begin);
+				auto replies = std::string{};
+				for (auto& result : results) {
+					replies += formatResult(result);
+				}
+				writeAll(client, replies);
+			}
+		}
+		catch (const std::exception & error) {
+			std::cerr << "client connection failed: " << error.what() << '\n';
+		}
+	}
+}
@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <vector>
+#include <cassert>
+
+#include "neuronet/kernels.hpp"
+
+namespace neuronet {
+	namespace kernels {
+		namespace {
+			//====================================================================
+			// Adds the dot products of Rows consecutive rows of A with x to y.
+			// Every row keeps lanes independent partial sums, so the loop over
+			// the columns carries no dependency between neighbouring columns
+			// and can be vectorized without reassociating the additions.
+			//====================================================================
+			template <size_t Rows>
+			void dotRows(
+				const double * a, size_t lda,
+				const double * x, size_t count,
+				double * y
+			) {
+				double sums[Rows][lanes] = {};
+				auto column = size_t{0};
+				for (; column + lanes <= count; column += lanes) {
+					for (auto row = size_t{0}; row < Rows; ++row) {
+						const auto values = a + row * lda + column;
+						for (auto lane = size_t{0}; lane < lanes; ++lane) {
+							sums[row][lane] += values[lane] * x[column + lane];
+						}
+					}
+				}
+				for (; column < count; ++column) {
+					for (auto row = size_t{0}; row < Rows; ++row) {
+						sums[row][0] += a[row * lda + column] * x[column];
+					}
+				}
+				for (auto row = size_t{0}; row < Rows; ++row) {
+					y[row] += (sums[row][0] + sums[row][1]) + (sums[row][2] + sums[row][3]);
+				}
+			}
+
+			//====================================================================
+			// Adds the rows of Rows consecutive rows of A scaled by the
+			// corresponding elements of x to y.
+			//====================================================================
+			template <size_t Rows>
+			void axpyRows(
+				const double * a, size_t lda,
+				const double * x, size_t count,
+				double * y
+			) {
+				for (auto column = size_t{0}; column < count; ++column) {
+					auto sum = 0.0;
+					for (auto row = size_t{0}; row < Rows; ++row) {
+						sum += a[row * lda + column] * x[row];
+					}
+					y[column] += sum;
+				}
+			}
+
+			//====================================================================
+			// Packs the mc x kc block of A starting at a into panels of
+			// row_tile rows stored column after column; missing rows of the
+			// last panel are padded with zeros.
+			//====================================================================
+			void packA(
+				size_t mc, size_t kc,
+				const double * a, size_t lda,
+				double * packed
+			) {
+				for (auto row = size_t{0}; row < mc; row += row_tile) {
+					const auto rows = std::min(row_tile, mc - row);
+					for (auto depth = size_t{0}; depth < kc; ++depth) {
+						for (auto i = size_t{0}; i < row_tile; ++i) {
+							*packed++ = i < rows ? a[(row + i) * lda + depth] : 0.0;
+						}
+					}
+				}
+			}
+
+			//====================================================================
+			// Packs the kc x nc block of B starting at b into panels of
+			// col_tile columns stored row after row; missing columns of the
+			// last panel are padded with zeros.
+			//====================================================================
+			void packB(
+				size_t kc, size_t nc,
+				const double * b, size_t ldb,
+				double * packed
+			) {
+				for (auto column = size_t{0}; column < nc; column += col_tile) {
+					const auto columns = std::min(col_tile, nc - column);
+					for (auto depth = size_t{0}; depth < kc; ++depth) {
+						const auto values = b + depth * ldb + column;
+						for (auto j = size_t{0}; j < col_tile; ++j) {
+							*packed++ = j < columns ? values[j] : 0.0;
+						}
+					}
+				}
+			}
+
+			//====================================================================
+			// Multiplies a packed panel of A with a packed panel of B into
+			// a row_tile x col_tile tile held in registers and adds it to
+			// the rows x columns corner of C.
+			//====================================================================
+			void microKernel(
+				size_t kc,
+				const double * packedA, const double * packedB,
+				double * c, size_t ldc,
+				size_t rows, size_t columns
+			) {
+				double tile[row_tile][col_tile] = {};
+				for (auto depth = size_t{0}; depth < kc; ++depth) {
+					for (auto i = size_t{0}; i < row_tile; ++i) {
+						const auto value = packedA[i];
+						for (auto j = size_t{0}; j < col_tile; ++j) {
+							tile[i][j] += value * packedB[j];
+						}
+					}
+					packedA += row_tile;
+					packedB += col_tile;
+				}
+				for (auto i = size_t{0}; i < rows; ++i) {
+					for (auto j = size_t{0}; j < columns; ++j) {
+						c[i * ldc + j] += tile[i][j];
+					}
+				}
+			}
+		}
+
+		void gemv(
+			size_t rows, size_t cols,
+			const double * a, size_t lda,
+			const double * x, double * y,
+			const Blocking & blocking
+		) {
+			assert(blocking.vector_block > 0 &&
+				"the block size must not be zero.");
+			std::fill(y, y + rows, 0.0);
+			for (auto first = size_t{0}; first < cols; first += blocking.vector_block) {
+				const auto count = std::min(blocking.vector_block, cols - first);
+				auto row = size_t{0};
+				for (; row + row_tile <= rows; row += row_tile) {
+					dotRows<row_tile>(a + row * lda + first, lda, x + first, count, y + row);
+				}
+				for (; row < rows; ++row) {
+					dotRows<1>(a + row * lda + first, lda, x + first, count, y + row);
+				}
+			}
+		}
+
+		void gemvTransposed(
+			size_t rows, size_t cols,
+			const double * a, size_t lda,
+			const double * x, double * y,
+			const Blocking & blocking
+		) {
+			assert(blocking.vector_block > 0 &&
+				"the block size must not be zero.");
+			std::fill(y, y + cols, 0.0);
+			for (auto first = size_t{0}; first < cols; first += blocking.vector_block) {
+				const auto count = std::min(blocking.vector_block, cols - first);
+				auto row = size_t{0};
+				for (; row + row_tile <= rows; row += row_tile) {
+					axpyRows<row_tile>(a + row * lda + first, lda, x + row, count, y + first);
+				}
+				for (; row < rows; ++row) {
+					axpyRows<1>(a + row * lda + first, lda, x + row, count, y + first);
+				}
+			}
+		}
+
+		void gemm(
+			size_t m, size_t n, size_t k,
+			const double * a, size_t lda,
+			const double * b, size_t ldb,
+			double * c, size_t ldc,
+			const Blocking & blocking
+		) {
+			assert(blocking.gemm_mc > 0 && blocking.gemm_kc > 0 && blocking.gemm_nc > 0 &&
+				"the block sizes must not be zero.");
+			for (auto row = size_t{0}; row < m; ++row) {
+				std::fill(c + row * ldc, c + row * ldc + n, 0.0);
+			}
+			// Rounded up to whole panels since packing pads with zeros.
+			const auto roundUp = [](size_t value, size_t multiple) {
+				return (value + multiple - 1) / multiple * multiple;
+			};
+			thread_local std::vector<double> packedA;
+			thread_local std::vector<double> packedB;
+			packedA.resize(roundUp(blocking.gemm_mc, row_tile) * blocking.gemm_kc);
+			packedB.resize(roundUp(blocking.gemm_nc, col_tile) * blocking.gemm_kc);
+			for (auto jc = size_t{0}; jc < n; jc += blocking.gemm_nc) {
+				const auto nc = std::min(blocking.gemm_nc, n - jc);
+				for (auto pc = size_t{0}; pc < k; pc += blocking.gemm_kc) {
+					const auto kc = std::min(blocking.gemm_kc, k - pc);
+					packB(kc, nc, b + pc * ldb + jc, ldb, packedB.data());
+					for (auto ic = size_t{0}; ic < m; ic += blocking.gemm_mc) {
+						const auto mc = std::min(blocking.gemm_mc, m - ic);
+						packA(mc, kc, a + ic * lda + pc, lda, packedA.data());
+						for (auto jr = size_t{0}; jr < nc; jr += col_tile) {
+							for (auto ir = size_t{0}; ir < mc; ir += row_tile) {
+								microKernel(
+									kc,
+									packedA.data() + ir * kc,
+									packedB.data() + jr * kc,
+									c + (ic + ir) * ldc + jc + jr, ldc,
+									std::min(row_tile, mc - ir),
+									std::min(col_tile, nc - jr));
+							}
+						}
+					}
+				}
+			}
+		}
+
+		void rankOneUpdate(
+			size_t rows, size_t cols,
+			double * a, size_t lda,
+			const double * gradients, const double * x,
+			const Blocking & blocking
+		) {
+			for (auto first = size_t{0}; first < cols; first += blocking.vector_block) {
+				const auto count = std::min(blocking.vector_block, cols - first);
+				for (auto row = size_t{0}; row < rows; ++row) {
+					const auto gradient = gradients[row];
+					const auto values   = a + row * lda + first;
+					for (auto column = size_t{0}; column < count; ++column) {
+						values[column] += x[first + column] * gradient;
+					}
+				}
+			}
+		}
+
+		void updateWithMomentum(
+			size_t rows, size_t cols,
+			double * a, double * d, size_t lda,
+			double eta, const double * gradients, const double * x,
+			double alpha,
+			const Blocking & blocking
+		) {
+			for (auto first = size_t{0}; first < cols; first += blocking.vector_block) {
+				const auto count = std::min(blocking.vector_block, cols - first);
+				for (auto row = size_t{0}; row < rows; ++row) {
+					const auto gradient = gradients[row];
+					const auto weights  = a + row * lda + first;
+					const auto deltas   = d + row * lda + first;
+					for (auto column = size_t{0}; column < count; ++column) {
+						// Same operations as NeuralConnection::setWeight so that
+						// the recorded change is bitwise the one of the reference.
+						const auto newDelta = eta * x[first + column] * gradient + alpha * deltas[column];
+						const auto weight   = weights[column] + newDelta;
+						deltas[column]  = weight - weights[column];
+						weights[column] = weight;
+					}
+				}
+			}
+		}
+
+		void commitWithMomentum(
+			size_t rows, size_t cols,
+			double * a, double * d, double * g, size_t lda,
+			double eta, double alpha
+		) {
+			for (auto row = size_t{0}; row < rows; ++row) {
+				const auto weights   = a + row * lda;
+				const auto deltas    = d + row * lda;
+				const auto gradients = g + row * lda;
+				for (auto column = size_t{0}; column < cols; ++column) {
+					const auto newDelta = eta * gradients[column] + alpha * deltas[column];
+					const auto weight   = weights[column] + newDelta;
+					deltas[column]    = weight - weights[column];
+					weights[column]   = weight;
+					gradients[column] = 0.0;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,30 @@
+#include "neuronet/memory_usage.hpp"
+
+namespace neuronet {
+	auto MemoryUsage::total() const
+		-> size_t
+	{
+		return weights + optimizer_state + activations + connection_metadata;
+	}
+
+	auto MemoryUsage::operator+=(const MemoryUsage & rhs)
+		-> MemoryUsage &
+	{
+		weights             += rhs.weights;
+		optimizer_state     += rhs.optimizer_state;
+		activations         += rhs.activations;
+		connection_metadata += rhs.connection_metadata;
+		return *this;
+	}
+
+	auto NetMemoryUsage::total() const
+		-> MemoryUsage
+	{
+		auto sum = bias;
+		sum += network;
+		for (auto& layer : layers) {
+			sum += layer;
+		}
+		return sum;
+	}
+}
@@ -7,29 +7,37 @@
 
 namespace neuronet {
 	NeuralConnection::NeuralConnection(
-		Neuron & source, Neuron & target
+		Neuron & source, Neuron & target,
+		double & weight, double & deltaWeight
 	):
-		m_weight{randomWeight()},
-		m_delta_weight{0.0},
+		m_weight{std::addressof(weight)},
+		m_delta_weight{std::addressof(deltaWeight)},
 		m_source{std::addressof(source)},
 		m_target{std::addressof(target)}
-	{}
+	{
+		resetWeight(randomWeight());
+	}
 
 	void NeuralConnection::setWeight(double newWeight) {
-		m_delta_weight = newWeight - m_weight;
-		m_weight = newWeight;
+		*m_delta_weight = newWeight - *m_weight;
+		*m_weight = newWeight;
+	}
+
+	void NeuralConnection::resetWeight(double newWeight) {
+		*m_delta_weight = 0.0;
+		*m_weight = newWeight;
 	}
 
 	auto NeuralConnection::getWeight() const
 		-> double
 	{
-		return m_weight;
+		return *m_weight;
 	}
 
 	auto NeuralConnection::getDeltaWeight() const
 		-> double
 	{
-		return m_delta_weight;
+		return *m_delta_weight;
 	}
 
 	auto NeuralConnection::getSource()
@@ -1,17 +1,70 @@
 #include <cstddef>
 #include <cassert>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <numeric>
 
 #include "neuronet/neural_layer.hpp"
+#include "neuronet/worker_pool.hpp"
 
 namespace neuronet {
-	NeuralLayer::NeuralLayer(NeuralNet & net, uint64_t countNeurons, NeuralLayer::Kind kind):
+	NeuralLayer::NeuralLayer(
+		NeuralNet & net, uint64_t countNeurons, uint64_t countPrevNeurons, NeuralLayer::Kind kind
+	):
+		NeuralLayer{net, countNeurons, countPrevNeurons, kind, nullptr}
+	{}
+
+	NeuralLayer::NeuralLayer(
+		NeuralNet & net, const Convolution & convolution, NeuralLayer::Kind kind
+	):
+		NeuralLayer{net, convolution.countOutputs(), convolution.countInputs(), kind, &convolution}
+	{
+		assert(kind != Kind::input &&
+			"the input layer can't be a convolutional layer.");
+		// Without incoming connections nothing else initializes the
+		// kernels.
+		for (auto& weight : m_weights) {
+			weight = NeuralConnection::randomWeight();
+		}
+		const auto countColumns = m_convolution.outputHeight() * m_convolution.outputWidth();
+		m_columns.resize(m_convolution.countKernelWeights() * countColumns);
+		m_column_gradients.resize(m_columns.size());
+		m_kernel_gradients.resize(m_weights.size());
+		m_transposed_kernels.resize(m_convolution.countKernelWeights() * m_convolution.channels);
+	}
+
+	NeuralLayer::NeuralLayer(
+		NeuralNet & net, uint64_t countNeurons, uint64_t countPrevNeurons, NeuralLayer::Kind kind,
+		const Convolution * convolution
+	):
 		m_prev_layer{nullptr},
 		m_next_layer{nullptr},
 		m_net{std::addressof(net)},
-		m_kind{kind}
+		m_kind{kind},
+		m_convolutional{convolution != nullptr},
+		m_convolution{convolution != nullptr ? *convolution : Convolution{}},
+		m_engine{Engine::reference},
+		m_pool{nullptr},
+		m_threads{1},
+		m_training_rate{0.15},
+		m_momentum{0.5},
+		m_count_inc_connections{m_convolutional
+			? m_convolution.countKernelWeights() + 1
+			: countPrevNeurons + 1},
+		m_weights((m_convolutional ? m_convolution.channels : countNeurons) * m_count_inc_connections),
+		m_delta_weights(m_weights.size()),
+		m_weight_format{WeightFormat::fp64},
+		m_half_inputs{false},
+		m_half_weights_stale{true},
+		m_inputs(m_convolutional ? countPrevNeurons : m_count_inc_connections),
+		m_sums(countNeurons + 1),
+		m_gradients(countNeurons)
 	{
 		assert(countNeurons >= 1 &&
 			"there must be a minimum of one neuron in any neural layer.");
+		assert((countPrevNeurons == 0) == (kind == Kind::input) &&
+			"only the input layer is without a previous layer.");
 		m_neurons.reserve(countNeurons);
 		while (m_neurons.size() < countNeurons) {
 			m_neurons.push_back(Neuron::createOnLayer(*this));
@@ -19,11 +72,12 @@ namespace neuronet {
 	}
 
 	void NeuralLayer::initializeConnections() {
-		if (!isOutputLayer())
+		if (!isOutputLayer() && !nextLayer().isConvolutional())
 			// Connections are always established from the current
 			// neural layer to the next layer. Since the ouput layer
 			// shouldn't have a next layer there are no connections
-			// to initialize.
+			// to initialize, neither are there for the shared
+			// kernels of a convolutional next layer.
 		{
 			for (auto& neuron : m_neurons) {
 				neuron.fullyConnect(nextLayer());
@@ -50,7 +104,7 @@ namespace neuronet {
 	auto NeuralLayer::nextLayer() const
 		-> const NeuralLayer &
 	{
-		assert(isOutputLayer() &&
+		assert(!isOutputLayer() &&
 			"can't get the next layer of the output layer.");
 		return *m_next_layer;
 	}
@@ -58,7 +112,7 @@ namespace neuronet {
 	auto NeuralLayer::prevLayer()
 		-> NeuralLayer &
 	{
-		assert(isInputLayer() &&
+		assert(!isInputLayer() &&
 			"can't get the previous layer of the input layer.");
 		return *m_prev_layer;
 	}
@@ -66,7 +120,7 @@ namespace neuronet {
 	auto NeuralLayer::prevLayer() const
 		-> const NeuralLayer &
 	{
-		assert(isInputLayer() &&
+		assert(!isInputLayer() &&
 			"can't get the previous layer of the input layer.");
 		return *m_prev_layer;
 	}
@@ -79,12 +133,545 @@ namespace neuronet {
 		m_next_layer = std::addressof(layer);
 	}
 
+	void NeuralLayer::gatherInputs() {
+		auto input = m_inputs.begin();
+		for (auto& neuron : prevLayer()) {
+			*input++ = neuron.getOutput();
+		}
+		// The bias is the last incoming connection of every neuron.
+		const auto& bias = m_neurons.front().getIncConnections().back()->getSource();
+		assert(bias.isBias() &&
+			"the last incoming connection of a neuron must come from the bias.");
+		*input = bias.getOutput();
+	}
+
+	void NeuralLayer::gatherGradients() {
+		auto gradient = m_gradients.begin();
+		for (auto& neuron : m_neurons) {
+			*gradient++ = neuron.getGradient();
+		}
+	}
+
 	void NeuralLayer::feedForward() {
-		if (!isInputLayer()) {
+		if (isInputLayer()) return;
+		if (m_convolutional) {
+			feedForwardConvolution();
+			return;
+		}
+		if (m_weight_format != WeightFormat::fp64) {
+			feedForwardHalf();
+			return;
+		}
+		if (m_engine == Engine::reference) {
 			for (auto& neuron : m_neurons) {
 				neuron.feedForward();
 			}
+			return;
+		}
+		gatherInputs();
+		splitRows(size(), [this](size_t first, size_t last) {
+			kernels::gemv(
+				last - first, m_count_inc_connections,
+				m_weights.data() + first * m_count_inc_connections, m_count_inc_connections,
+				m_inputs.data(), m_sums.data() + first,
+				m_blocking);
+		});
+		auto sum = m_sums.begin();
+		for (auto& neuron : m_neurons) {
+			neuron.setOutput(Neuron::transferFunction(*sum++));
+		}
+	}
+
+	void NeuralLayer::computePreActivations() {
+		assert(!isInputLayer() &&
+			"the input layer has no pre-activations.");
+		gatherInputs();
+		m_pre_activations.resize(size());
+		kernels::gemv(
+			size(), m_count_inc_connections,
+			m_weights.data(), m_count_inc_connections,
+			m_inputs.data(), m_pre_activations.data(),
+			m_blocking);
+	}
+
+	void NeuralLayer::updatePreActivations(size_t input, double delta) {
+		assert(m_pre_activations.size() == size() &&
+			"pre-activations must be computed before they can be updated.");
+		assert(input < m_count_inc_connections &&
+			"there is no such input of this layer.");
+		const auto column = m_weights.data() + input;
+		for (auto row = size_t{0}; row < size(); ++row) {
+			m_pre_activations[row] += column[row * m_count_inc_connections] * delta;
+		}
+	}
+
+	void NeuralLayer::applyPreActivations() {
+		auto sum = m_pre_activations.begin();
+		for (auto& neuron : m_neurons) {
+			neuron.setOutput(Neuron::transferFunction(*sum++));
+		}
+	}
+
+	void NeuralLayer::feedForwardBatch(
+		const double * prevOutputs, size_t batchSize, double * outputs
+	) const {
+		feedForwardBatch(prevOutputs, batchSize, outputs, m_weights.data());
+	}
+
+	void NeuralLayer::feedForwardBatch(
+		const double * prevOutputs, size_t batchSize, double * outputs,
+		const double * weights
+	) const {
+		assert(!isInputLayer() &&
+			"the input layer has no previous layer to compute its outputs from.");
+		if (m_convolutional) {
+			const auto countColumns = m_convolution.outputHeight() * m_convolution.outputWidth() * batchSize;
+			thread_local std::vector<double> columns;
+			columns.resize(m_convolution.countKernelWeights() * countColumns);
+			im2col(m_convolution, prevOutputs, batchSize, columns.data());
+			convolveKernels(0, m_convolution.channels, weights, columns.data(), countColumns, outputs);
+			return;
+		}
+		if (m_engine == Engine::reference) {
+			for (auto& neuron : m_neurons) {
+				neuron.feedForwardBatch(prevOutputs, batchSize, outputs);
+				outputs += batchSize;
+			}
+			return;
+		}
+		const auto countPrevNeurons = m_count_inc_connections - 1;
+		if (batchSize == 1) {
+			// Packing panels doesn't pay off for a single sample,
+			// e.g. in the stages of a pipeline.
+			kernels::gemv(
+				size(), countPrevNeurons,
+				weights, m_count_inc_connections,
+				prevOutputs, outputs,
+				m_blocking);
+		}
+		else {
+			kernels::gemm(
+				size(), batchSize, countPrevNeurons,
+				weights, m_count_inc_connections,
+				prevOutputs, batchSize,
+				outputs, batchSize,
+				m_blocking);
+		}
+		const auto& bias = m_neurons.front().getIncConnections().back()->getSource();
+		for (auto row = size_t{0}; row < size(); ++row) {
+			const auto biasInput = weights[row * m_count_inc_connections + countPrevNeurons]
+			                     * bias.getOutput();
+			for (auto sample = size_t{0}; sample < batchSize; ++sample) {
+				auto& output = outputs[row * batchSize + sample];
+				output = Neuron::transferFunction(output + biasInput);
+			}
+		}
+	}
+
+	void NeuralLayer::feedForwardHalf() {
+		const auto format = m_weight_format == WeightFormat::fp16
+			? kernels::HalfFormat::fp16
+			: kernels::HalfFormat::bf16;
+		if (m_half_weights_stale) {
+			kernels::toHalf(format, m_weights.data(), m_weights.size(), m_half_weights.data());
+			m_half_weights_stale = false;
+		}
+		gatherInputs();
+		splitRows(size(), [this, format](size_t first, size_t last) {
+			kernels::gemvHalf(
+				format, last - first, m_count_inc_connections,
+				m_half_weights.data() + first * m_count_inc_connections, m_count_inc_connections,
+				m_inputs.data(), m_half_inputs, m_sums.data() + first);
+		});
+		auto sum = m_sums.begin();
+		for (auto& neuron : m_neurons) {
+			neuron.setOutput(Neuron::transferFunction(*sum++));
+		}
+	}
+
+	void NeuralLayer::convolveKernels(
+		size_t first, size_t last,
+		const double * weights, const double * columns, size_t countColumns,
+		double * outputs
+	) const {
+		const auto countKernelWeights = m_count_inc_connections - 1;
+		kernels::gemm(
+			last - first, countColumns, countKernelWeights,
+			weights + first * m_count_inc_connections, m_count_inc_connections,
+			columns, countColumns,
+			outputs + first * countColumns, countColumns,
+			m_blocking);
+		// The bias always outputs one.
+		for (auto kernel = first; kernel < last; ++kernel) {
+			const auto bias   = weights[kernel * m_count_inc_connections + countKernelWeights];
+			const auto output = outputs + kernel * countColumns;
+			for (auto column = size_t{0}; column < countColumns; ++column) {
+				output[column] = Neuron::transferFunction(output[column] + bias);
+			}
+		}
+	}
+
+	void NeuralLayer::feedForwardConvolution() {
+		auto input = m_inputs.begin();
+		for (auto& neuron : prevLayer()) {
+			*input++ = neuron.getOutput();
+		}
+		im2col(m_convolution, m_inputs.data(), 1, m_columns.data());
+		const auto countColumns = m_columns.size() / m_convolution.countKernelWeights();
+		splitRows(m_convolution.channels, [this, countColumns](size_t first, size_t last) {
+			convolveKernels(first, last, m_weights.data(), m_columns.data(), countColumns, m_sums.data());
+		});
+		auto sum = m_sums.begin();
+		for (auto& neuron : m_neurons) {
+			neuron.setOutput(*sum++);
+		}
+	}
+
+	void NeuralLayer::calculateKernelGradients() {
+		// Lowers the inputs again instead of keeping those of the
+		// forward pass, as the dense engines gather them again.
+		auto input = m_inputs.begin();
+		for (auto& neuron : prevLayer()) {
+			*input++ = neuron.getOutput();
+		}
+		im2col(m_convolution, m_inputs.data(), 1, m_columns.data());
+		gatherGradients();
+		// Every weight of a kernel is shared by all positions of the
+		// kernel, so its gradient sums the products of the gradients
+		// of all outputs of the kernel with the inputs they saw: a
+		// row of the lowered inputs.
+		const auto countKernelWeights = m_count_inc_connections - 1;
+		const auto countColumns       = m_columns.size() / countKernelWeights;
+		splitRows(m_convolution.channels, [=](size_t first, size_t last) {
+			for (auto kernel = first; kernel < last; ++kernel) {
+				const auto gradients = m_gradients.data() + kernel * countColumns;
+				const auto weights   = m_kernel_gradients.data() + kernel * m_count_inc_connections;
+				kernels::gemv(
+					countKernelWeights, countColumns,
+					m_columns.data(), countColumns,
+					gradients, weights,
+					m_blocking);
+				weights[countKernelWeights] = std::accumulate(gradients, gradients + countColumns, 0.0);
+			}
+		});
+	}
+
+	void NeuralLayer::backPropagateConvolution(double * prevSums) {
+		gatherGradients();
+		const auto countKernelWeights = m_count_inc_connections - 1;
+		const auto countColumns       = m_columns.size() / countKernelWeights;
+		const auto channels           = m_convolution.channels;
+		for (auto kernel = size_t{0}; kernel < channels; ++kernel) {
+			for (auto weight = size_t{0}; weight < countKernelWeights; ++weight) {
+				m_transposed_kernels[weight * channels + kernel] =
+					m_weights[kernel * m_count_inc_connections + weight];
+			}
+		}
+		// The gradients of the lowered inputs, scattered back onto the
+		// inputs they were lowered from.
+		kernels::gemm(
+			countKernelWeights, countColumns, channels,
+			m_transposed_kernels.data(), channels,
+			m_gradients.data(), countColumns,
+			m_column_gradients.data(), countColumns,
+			m_blocking);
+		std::fill(prevSums, prevSums + m_convolution.countInputs(), 0.0);
+		col2im(m_convolution, m_column_gradients.data(), 1, prevSums);
+	}
+
+	void NeuralLayer::calculateHiddenGradients() {
+		assert(isHiddenLayer() &&
+			"this operation is only defined for hidden layers.");
+		auto& next = nextLayer();
+		if (next.m_convolutional) {
+			next.backPropagateConvolution(m_sums.data());
+			auto sum = m_sums.begin();
+			for (auto& neuron : m_neurons) {
+				neuron.calculateHiddenGradient(*sum++);
+			}
+			return;
+		}
+		if (m_engine == Engine::reference) {
+			for (auto& neuron : m_neurons) {
+				neuron.calculateHiddenGradient();
+			}
+			return;
+		}
+		// The weights of the outgoing connections of this layer are the
+		// columns of the weight matrix of the next layer, so the sums of
+		// all neurons are given by its transposed product with the
+		// gradients of the next layer.
+		next.gatherGradients();
+		splitRows(next.m_count_inc_connections, [this, &next](size_t first, size_t last) {
+			kernels::gemvTransposed(
+				next.size(), last - first,
+				next.m_weights.data() + first, next.m_count_inc_connections,
+				next.m_gradients.data(), m_sums.data() + first,
+				m_blocking);
+		});
+		auto sum = m_sums.begin();
+		for (auto& neuron : m_neurons) {
+			neuron.calculateHiddenGradient(*sum++);
+		}
+	}
+
+	void NeuralLayer::updateInputWeights() {
+		if (isInputLayer()) return;
+		m_half_weights_stale = true;
+		if (m_convolutional) {
+			calculateKernelGradients();
+			splitRows(m_convolution.channels, [this](size_t first, size_t last) {
+				const auto offset = first * m_count_inc_connections;
+				kernels::commitWithMomentum(
+					last - first, m_count_inc_connections,
+					m_weights.data() + offset, m_delta_weights.data() + offset,
+					m_kernel_gradients.data() + offset, m_count_inc_connections,
+					m_training_rate, m_momentum);
+			});
+			return;
+		}
+		if (m_engine == Engine::reference) {
+			for (auto& neuron : m_neurons) {
+				neuron.updateInputWeights();
+			}
+			return;
+		}
+		gatherInputs();
+		gatherGradients();
+		splitRows(size(), [this](size_t first, size_t last) {
+			const auto offset = first * m_count_inc_connections;
+			kernels::updateWithMomentum(
+				last - first, m_count_inc_connections,
+				m_weights.data() + offset, m_delta_weights.data() + offset, m_count_inc_connections,
+				m_training_rate, m_gradients.data() + first, m_inputs.data(),
+				m_momentum,
+				m_blocking);
+		});
+	}
+
+	void NeuralLayer::setAccumulateGradients(bool enabled) {
+		if (!enabled || isInputLayer()) {
+			m_accumulated_gradients = std::vector<double>{};
+			return;
+		}
+		m_accumulated_gradients.assign(m_weights.size(), 0.0);
+	}
+
+	void NeuralLayer::accumulateGradients() {
+		if (isInputLayer()) return;
+		assert(!m_accumulated_gradients.empty() &&
+			"gradient accumulators are not allocated for this layer.");
+		if (m_convolutional) {
+			calculateKernelGradients();
+			std::transform(
+				m_accumulated_gradients.begin(), m_accumulated_gradients.end(),
+				m_kernel_gradients.begin(), m_accumulated_gradients.begin(),
+				std::plus<double>{});
+			return;
+		}
+		if (m_engine == Engine::reference) {
+			auto accumulators = m_accumulated_gradients.data();
+			for (auto& neuron : m_neurons) {
+				neuron.accumulateInputGradients(accumulators);
+				accumulators += m_count_inc_connections;
+			}
+			return;
+		}
+		gatherInputs();
+		gatherGradients();
+		splitRows(size(), [this](size_t first, size_t last) {
+			kernels::rankOneUpdate(
+				last - first, m_count_inc_connections,
+				m_accumulated_gradients.data() + first * m_count_inc_connections, m_count_inc_connections,
+				m_gradients.data() + first, m_inputs.data(),
+				m_blocking);
+		});
+	}
+
+	void NeuralLayer::commitGradients(double scale) {
+		if (isInputLayer()) return;
+		m_half_weights_stale = true;
+		if (m_engine == Engine::reference && !m_convolutional) {
+			auto accumulators = m_accumulated_gradients.data();
+			for (auto& neuron : m_neurons) {
+				neuron.commitInputGradients(accumulators, scale);
+				accumulators += m_count_inc_connections;
+			}
+			return;
+		}
+		splitRows(m_weights.size() / m_count_inc_connections, [this, scale](size_t first, size_t last) {
+			const auto offset = first * m_count_inc_connections;
+			kernels::commitWithMomentum(
+				last - first, m_count_inc_connections,
+				m_weights.data() + offset, m_delta_weights.data() + offset,
+				m_accumulated_gradients.data() + offset, m_count_inc_connections,
+				m_training_rate * scale, m_momentum);
+		});
+	}
+
+	void NeuralLayer::takeGradients(double * gradients) {
+		if (isInputLayer()) return;
+		assert(!m_accumulated_gradients.empty() &&
+			"gradient accumulators are not allocated for this layer.");
+		std::copy(m_accumulated_gradients.begin(), m_accumulated_gradients.end(), gradients);
+		std::fill(m_accumulated_gradients.begin(), m_accumulated_gradients.end(), 0.0);
+	}
+
+	void NeuralLayer::addGradients(const double * gradients) {
+		if (isInputLayer()) return;
+		assert(!m_accumulated_gradients.empty() &&
+			"gradient accumulators are not allocated for this layer.");
+		for (auto& accumulator : m_accumulated_gradients) {
+			accumulator += *gradients++;
+		}
+	}
+
+	void NeuralLayer::setWeights(const double * weights) {
+		if (isInputLayer()) return;
+		m_half_weights_stale = true;
+		std::copy(weights, weights + m_weights.size(), m_weights.begin());
+	}
+
+	void NeuralLayer::splitRows(
+		size_t count, const std::function<void(size_t, size_t)> & task
+	) {
+		if (m_pool == nullptr || m_threads <= 1) {
+			task(0, count);
+			return;
 		}
+		m_pool->parallelFor(count, m_threads, [&task](size_t first, size_t last, size_t) {
+			task(first, last);
+		});
+	}
+
+	void NeuralLayer::setWorkerPool(WorkerPool * pool, size_t threads) {
+		m_pool = pool;
+		setThreads(threads);
+	}
+
+	void NeuralLayer::setThreads(size_t threads) {
+		assert(threads >= 1 &&
+			"a layer needs at least one thread.");
+		m_threads = m_pool == nullptr ? 1 : std::min(threads, m_pool->size());
+	}
+
+	auto NeuralLayer::getThreads() const
+		-> size_t
+	{
+		return m_threads;
+	}
+
+	void NeuralLayer::setTrainingRate(double eta) {
+		assert(eta >= 0.0 &&
+			"the training rate must not be negative.");
+		m_training_rate = eta;
+	}
+
+	auto NeuralLayer::getTrainingRate() const
+		-> double
+	{
+		return m_training_rate;
+	}
+
+	void NeuralLayer::setMomentum(double alpha) {
+		assert(alpha >= 0.0 &&
+			"the momentum must not be negative.");
+		m_momentum = alpha;
+	}
+
+	auto NeuralLayer::getMomentum() const
+		-> double
+	{
+		return m_momentum;
+	}
+
+	void NeuralLayer::setWeightFormat(WeightFormat format, bool halfInputs) {
+		m_weight_format      = format;
+		m_half_inputs        = halfInputs;
+		m_half_weights_stale = true;
+		if (format == WeightFormat::fp64 || isInputLayer() || m_convolutional) {
+			m_half_weights = std::vector<uint16_t>{};
+			return;
+		}
+		m_half_weights.resize(m_weights.size());
+	}
+
+	auto NeuralLayer::getWeightFormat() const
+		-> WeightFormat
+	{
+		return m_weight_format;
+	}
+
+	void NeuralLayer::setEngine(Engine engine) {
+		m_engine = engine;
+	}
+
+	auto NeuralLayer::getEngine() const
+		-> Engine
+	{
+		return m_engine;
+	}
+
+	void NeuralLayer::setBlocking(const kernels::Blocking & blocking) {
+		m_blocking = blocking;
+	}
+
+	auto NeuralLayer::getBlocking() const
+		-> const kernels::Blocking &
+	{
+		return m_blocking;
+	}
+
+	auto NeuralLayer::countIncConnections() const
+		-> size_t
+	{
+		return m_count_inc_connections;
+	}
+
+	auto NeuralLayer::getWeights() const
+		-> const std::vector<double> &
+	{
+		return m_weights;
+	}
+
+	auto NeuralLayer::memoryUsage() const
+		-> MemoryUsage
+	{
+		auto usage = MemoryUsage{};
+		for (auto& neuron : m_neurons) {
+			usage += neuron.memoryUsage();
+		}
+		usage.connection_metadata += sizeof(NeuralLayer);
+		usage.connection_metadata += (m_neurons.capacity() - m_neurons.size()) * sizeof(Neuron);
+		usage.weights             += m_weights.capacity() * sizeof(double);
+		usage.weights             += m_half_weights.capacity() * sizeof(uint16_t);
+		usage.optimizer_state     += m_delta_weights.capacity() * sizeof(double);
+		usage.optimizer_state     += m_accumulated_gradients.capacity() * sizeof(double);
+		usage.activations         += m_inputs.capacity() * sizeof(double);
+		usage.activations         += m_sums.capacity() * sizeof(double);
+		usage.activations         += m_gradients.capacity() * sizeof(double);
+		usage.activations         += m_pre_activations.capacity() * sizeof(double);
+		usage.activations         += m_columns.capacity() * sizeof(double);
+		usage.activations         += m_column_gradients.capacity() * sizeof(double);
+		usage.activations         += m_transposed_kernels.capacity() * sizeof(double);
+		usage.optimizer_state     += m_kernel_gradients.capacity() * sizeof(double);
+		return usage;
+	}
+
+	auto NeuralLayer::weightOf(size_t neuron, size_t input)
+		-> double &
+	{
+		assert(neuron < size() && input < m_count_inc_connections &&
+			"there is no such connection within this layer.");
+		return m_weights[neuron * m_count_inc_connections + input];
+	}
+
+	auto NeuralLayer::deltaWeightOf(size_t neuron, size_t input)
+		-> double &
+	{
+		assert(neuron < size() && input < m_count_inc_connections &&
+			"there is no such connection within this layer.");
+		return m_delta_weights[neuron * m_count_inc_connections + input];
 	}
 
 	bool NeuralLayer::isInputLayer() const {
@@ -105,12 +692,33 @@ namespace neuronet {
 		return m_kind;
 	}
 
+	bool NeuralLayer::isConvolutional() const {
+		return m_convolutional;
+	}
+
+	auto NeuralLayer::getConvolution() const
+		-> const Convolution &
+	{
+		assert(m_convolutional &&
+			"only convolutional layers have the shape of a convolution.");
+		return m_convolution;
+	}
+
 	auto NeuralLayer::size() const
 		-> size_t
 	{
 		return m_neurons.size();
 	}
 
+	auto NeuralLayer::indexOf(const Neuron & neuron) const
+		-> size_t
+	{
+		const auto index = std::addressof(neuron) - m_neurons.data();
+		assert(index >= 0 && static_cast<size_t>(index) < m_neurons.size() &&
+			"the given neuron is not placed within this layer.");
+		return static_cast<size_t>(index);
+	}
+
 	//=========================================================================
 	// Iterator Wrappers
 	//=========================================================================
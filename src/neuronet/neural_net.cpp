@@ -1,30 +1,241 @@
 #include <cmath>
 #include <cassert>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <limits>
+#include <mutex>
+#include <algorithm>
+#include <functional>
 
 #include "utility/reverse_adapter.hpp"
-#include "utility/zip_range.hpp"
+#include "utility/training_data.hpp"
 
 #include "neuronet/neural_net.hpp"
 #include "neuronet/neural_layer.hpp"
+#include "neuronet/worker_pool.hpp"
+#include "neuronet/profiler.hpp"
+#include "neuronet/execution_plan.hpp"
+#include "neuronet/telemetry.hpp"
 
 namespace neuronet {
+	//========================================================
+	// Copies of the weight matrices of all layers, one copy
+	// per NUMA node, each written by a worker of its node.
+	// A copy is refreshed lazily once its version falls
+	// behind the weights version of the neural net.
+	//========================================================
+	struct WeightReplicas {
+		explicit WeightReplicas(size_t countNodes):
+			versions(countNodes, std::numeric_limits<size_t>::max()),
+			weights(countNodes)
+		{}
+
+		std::mutex mutex;
+		std::vector<size_t> versions;
+		std::vector<std::vector<std::vector<double>>> weights;
+	};
+
+	namespace {
+		// Wide layers are split among workers with at least
+		// this many weights for every worker.
+		constexpr size_t min_weights_per_thread = size_t{1} << 15;
+
+		// Incrementally kept pre-activations are recomputed after
+		// this many passes or if more than one in this many inputs
+		// changed since the last pass.
+		constexpr size_t incremental_refresh_passes = 1024;
+		constexpr size_t incremental_max_changed    = 4;
+	}
+
 	NeuralNet::NeuralNet(const std::vector<uint64_t> & neuronsPerLayer):
+		NeuralNet{neuronsPerLayer, std::vector<Convolution>{}}
+	{}
+
+	NeuralNet::NeuralNet(
+		const std::vector<uint64_t> & neuronsPerLayer,
+		const std::vector<Convolution> & convolutions
+	):
 		m_error{0.0},
 		m_recent_avg_error{0.0},
 		m_recent_avg_smoothing_factor{0.0},
+		m_update_mode{UpdateMode::immediate},
+		m_pending_gradients{0},
+		m_weights_version{0},
+		m_incremental{false},
+		m_incremental_version{0},
+		m_incremental_passes{0},
 		m_bias{Neuron::createBias()}
 	{
 		assert(neuronsPerLayer.size() >= 2 &&
 			"there need to be a minimum of two layers in a neural network.");
+		auto convolutionOf = std::vector<const Convolution *>(neuronsPerLayer.size(), nullptr);
+		for (auto& convolution : convolutions) {
+			convolution.validate();
+			if (convolution.layer >= neuronsPerLayer.size() || convolutionOf[convolution.layer] != nullptr) {
+				throw std::invalid_argument{
+					"a convolution must belong to a distinct layer of the neural net."};
+			}
+			if (convolution.countOutputs() != neuronsPerLayer[convolution.layer]
+				|| convolution.countInputs() != neuronsPerLayer[convolution.layer - 1])
+			{
+				throw std::invalid_argument{
+					"the inputs and outputs of a convolution must match the neurons of its layers."};
+			}
+			convolutionOf[convolution.layer] = &convolution;
+		}
 		m_layers.reserve(neuronsPerLayer.size());
 		for (auto countNeurons : neuronsPerLayer) {
 			const auto layerKind =
 				m_layers.empty()                              ? NeuralLayer::Kind::input :
 				m_layers.size() == neuronsPerLayer.size() - 1 ? NeuralLayer::Kind::output :
 				                                                NeuralLayer::Kind::hidden;
-			m_layers.emplace_back(*this, countNeurons, layerKind);
+			const auto countPrevNeurons =
+				m_layers.empty() ? uint64_t{0} : uint64_t{m_layers.back().size()};
+			const auto convolution = convolutionOf[m_layers.size()];
+			if (convolution != nullptr) {
+				m_layers.emplace_back(*this, *convolution, layerKind);
+				continue;
+			}
+			m_layers.emplace_back(*this, countNeurons, countPrevNeurons, layerKind);
 		}
 		initializeLayers();
+		setProfiler(nullptr);
+	}
+
+	NeuralNet::NeuralNet(const Topology & topology):
+		NeuralNet{topology.neurons_per_layer, topology.convolutions}
+	{}
+
+	NeuralNet::NeuralNet(std::istream & model):
+		NeuralNet{readTopology(model)}
+	{
+		readWeights(model);
+	}
+
+	auto NeuralNet::readTopology(std::istream & model)
+		-> Topology
+	{
+		using namespace std::string_literals;
+		auto line = ""s;
+		while (std::getline(model, line) && line.empty()) {}
+		auto stream   = std::istringstream{line};
+		auto keyword  = ""s;
+		stream >> keyword;
+		if (keyword != "topology"s) {
+			throw std::invalid_argument{
+				"expected keyword 'topology' at this point of the model."};
+		}
+		auto topology = Topology{};
+		auto count    = uint64_t{0};
+		while (stream >> count) {
+			topology.neurons_per_layer.push_back(count);
+		}
+		if (topology.neurons_per_layer.size() < 2) {
+			throw std::invalid_argument{
+				"a model needs a minimum of two layers."};
+		}
+		// Only peeks at the line after, which starts the weights
+		// unless it is a convolution.
+		while ((model >> std::ws).peek() == 'c') {
+			std::getline(model, line);
+			stream = std::istringstream{line};
+			stream >> keyword;
+			auto c = Convolution{};
+			if (keyword != "convolution"s
+				|| !(stream
+					>> c.layer >> c.input_channels >> c.input_height >> c.input_width
+					>> c.channels >> c.kernel_height >> c.kernel_width
+					>> c.stride_height >> c.stride_width >> c.padding_height >> c.padding_width))
+			{
+				throw std::invalid_argument{
+					"expected a convolution at this point of the model."};
+			}
+			topology.convolutions.push_back(c);
+		}
+		return topology;
+	}
+
+	void NeuralNet::readWeights(std::istream & model) {
+		++m_weights_version;
+		using namespace std::string_literals;
+		auto line = ""s;
+		auto readLine = [&]() -> std::istringstream {
+			while (std::getline(model, line) && line.empty()) {}
+			auto stream  = std::istringstream{line};
+			auto keyword = ""s;
+			stream >> keyword;
+			if (keyword != "weights"s) {
+				throw std::invalid_argument{
+					"expected keyword 'weights' at this point of the model."};
+			}
+			return stream;
+		};
+		for (auto& layer : m_layers) {
+			if (layer.isInputLayer()) continue;
+			if (layer.isConvolutional()) {
+				auto weights = std::vector<double>(layer.getWeights().size());
+				auto weight  = weights.begin();
+				while (weight != weights.end()) {
+					auto stream = readLine();
+					for (auto w = size_t{0}; w < layer.countIncConnections(); ++w) {
+						if (!(stream >> *weight++)) {
+							throw std::invalid_argument{
+								"too few weights for a kernel in the model."};
+						}
+					}
+				}
+				layer.setWeights(weights.data());
+				continue;
+			}
+			for (auto& neuron : layer) {
+				auto stream = readLine();
+				for (auto connection : neuron.getIncConnections()) {
+					auto weight = 0.0;
+					if (!(stream >> weight)) {
+						throw std::invalid_argument{
+							"too few weights for the connections of a neuron in the model."};
+					}
+					connection->resetWeight(weight);
+				}
+			}
+		}
+	}
+
+	void NeuralNet::save(std::ostream & model) const {
+		const auto precision = model.precision(
+			std::numeric_limits<double>::max_digits10);
+		model << "topology";
+		for (auto& layer : m_layers) {
+			model << ' ' << layer.size();
+		}
+		model << '\n';
+		for (auto& convolution : getConvolutions()) {
+			model << "convolution " << convolution << '\n';
+		}
+		model << '\n';
+		for (auto& layer : m_layers) {
+			if (layer.isInputLayer()) continue;
+			if (layer.isConvolutional()) {
+				const auto& weights = layer.getWeights();
+				for (auto kernel = weights.begin(); kernel != weights.end(); kernel += layer.countIncConnections()) {
+					model << "weights";
+					for (auto weight = kernel; weight != kernel + layer.countIncConnections(); ++weight) {
+						model << ' ' << *weight;
+					}
+					model << '\n';
+				}
+				continue;
+			}
+			for (auto& neuron : layer) {
+				model << "weights";
+				for (auto connection : neuron.getIncConnections()) {
+					model << ' ' << connection->getWeight();
+				}
+				model << '\n';
+			}
+		}
+		model.precision(precision);
 	}
 
 	void NeuralNet::initializeLayersAdjacency() {
@@ -46,6 +257,9 @@ namespace neuronet {
 
 	void NeuralNet::initializeBiasConnection() {
 		for (auto& layer : m_layers) {
+			// Convolutional layers keep the weights of the bias
+			// with their kernels.
+			if (layer.isConvolutional()) continue;
 			m_bias.fullyConnect(layer);
 		}
 	}
@@ -64,46 +278,256 @@ namespace neuronet {
 		initializeBackConnections();
 	}
 
-	void NeuralNet::setInput(const std::vector<double> & inputValues) {
-		assert(inputValues.size() == getInputLayer().size() &&
+	void NeuralNet::setInput(const double * inputValues, size_t count) {
+		assert(count == getInputLayer().size() &&
 			"inputValues must have the same size as the input layer of this neural network.");
-		/*
-		auto inputIt = inputValues.begin();
+		(void) count;
 		for (auto& neuron : getInputLayer()) {
-			neuron.setOutput(*inputIt);
-			++inputIt;
+			neuron.setOutput(*inputValues++);
+		}
+	}
+
+	void NeuralNet::setInput(const std::vector<double> & inputValues) {
+		setInput(inputValues.data(), inputValues.size());
+	}
+
+	void NeuralNet::feedForward(const double * inputValues, size_t count) {
+		if (m_incremental) {
+			assert(count == getInputLayer().size() &&
+				"inputValues must have the same size as the input layer of this neural network.");
+			feedForwardIncremental(inputValues);
+			return;
+		}
+		if (m_plan != nullptr) {
+			assert(count == getInputLayer().size() &&
+				"inputValues must have the same size as the input layer of this neural network.");
+			m_plan->setInputs(inputValues);
+			for (auto l = size_t{1}; l < m_layers.size(); ++l) {
+				profile(m_profile_layers[l], [&] { m_plan->feedForward(l - 1); });
+			}
+			auto output = m_plan->getOutputs();
+			for (auto& neuron : getOutputLayer()) {
+				neuron.setOutput(*output++);
+			}
+			return;
+		}
+		setInput(inputValues, count);
+		for (auto l = size_t{1}; l < m_layers.size(); ++l) {
+			profile(m_profile_layers[l], [&] { m_layers[l].feedForward(); });
+		}
+	}
+
+	template <typename Phase>
+	void NeuralNet::profile(size_t region, Phase && phase) {
+		if (m_profiler == nullptr) {
+			phase();
+			return;
+		}
+		m_profiler->start();
+		phase();
+		m_profiler->stop(region);
+	}
+
+	void NeuralNet::setProfiler(std::shared_ptr<Profiler> profiler) {
+		m_profiler = std::move(profiler);
+		m_profile_layers.assign(m_layers.size(), 0);
+		std::fill(std::begin(m_profile_phases), std::end(m_profile_phases), 0);
+		if (m_profiler == nullptr) return;
+		auto weights = size_t{0};
+		for (auto l = size_t{1}; l < m_layers.size(); ++l) {
+			const auto& layer = m_layers[l];
+			const auto  count = layer.size() * layer.countIncConnections();
+			m_profile_layers[l] = m_profiler->addRegion(
+				"forward layer " + std::to_string(l), count);
+			weights += count;
+		}
+		const auto outputWeights = getOutputLayer().size() * getOutputLayer().countIncConnections();
+		m_profile_phases[phase_error] =
+			m_profiler->addRegion("backprop error", 0);
+		m_profile_phases[phase_output_gradients] =
+			m_profiler->addRegion("backprop output gradients", 0);
+		m_profile_phases[phase_hidden_gradients] =
+			m_profiler->addRegion("backprop hidden gradients", weights - outputWeights);
+		m_profile_phases[phase_weight_updates] =
+			m_profiler->addRegion("backprop weight updates", weights);
+	}
+
+	void NeuralNet::feedForwardIncremental(const double * inputValues) {
+		auto& inputLayer = getInputLayer();
+		auto& firstLayer = m_layers[1];
+		auto  recompute  =
+			m_incremental_version != m_weights_version
+			|| ++m_incremental_passes >= incremental_refresh_passes;
+		if (!recompute) {
+			m_changed_inputs.clear();
+			auto input = size_t{0};
+			for (auto& neuron : inputLayer) {
+				if (neuron.getOutput() != inputValues[input]) {
+					m_changed_inputs.push_back(input);
+				}
+				++input;
+			}
+			recompute = m_changed_inputs.size() * incremental_max_changed > inputLayer.size();
+		}
+		if (recompute) {
+			setInput(inputValues, inputLayer.size());
+			firstLayer.computePreActivations();
+			m_incremental_version = m_weights_version;
+			m_incremental_passes  = 0;
+		}
+		else {
+			for (auto input : m_changed_inputs) {
+				auto& neuron = *(inputLayer.begin() + input);
+				firstLayer.updatePreActivations(input, inputValues[input] - neuron.getOutput());
+				neuron.setOutput(inputValues[input]);
+			}
 		}
-		*/
-		for (auto&& zipped : utility::zip_range(getInputLayer(), inputValues)) {
-			zipped.get<0>().setOutput(zipped.get<1>());
+		firstLayer.applyPreActivations();
+		for (auto l = size_t{2}; l < m_layers.size(); ++l) {
+			profile(m_profile_layers[l], [&] { m_layers[l].feedForward(); });
 		}
 	}
 
+	void NeuralNet::setIncremental(bool enabled) {
+		if (enabled && m_layers[1].isConvolutional()) {
+			throw std::invalid_argument{
+				"a convolutional first hidden layer can't be evaluated incrementally."};
+		}
+		if (enabled) decompile();
+		m_incremental = enabled;
+		// Forces a full computation on the next pass.
+		m_incremental_version = m_weights_version - 1;
+		m_changed_inputs.reserve(getInputLayer().size());
+	}
+
+	bool NeuralNet::isIncremental() const {
+		return m_incremental;
+	}
+
 	void NeuralNet::feedForward(const std::vector<double> & inputValues) {
-		assert(inputValues.size() == getInputLayer().size() &&
-			"inputValues must have the same size as the input layer of this neural network.");
-		setInput(inputValues);
+		feedForward(inputValues.data(), inputValues.size());
+	}
+
+	void NeuralNet::feedForwardBatch(
+		const std::vector<double> & inputValues,
+		size_t batchSize,
+		std::vector<double> & outputValues
+	) const {
+		assert(inputValues.size() == batchSize * getInputLayer().size() &&
+			"inputValues must hold batchSize times as many values as the input layer has neurons.");
+		const auto countInputs  = getInputLayer().size();
+		const auto countOutputs = getOutputLayer().size();
+		auto widest = size_t{0};
 		for (auto& layer : m_layers) {
-			layer.feedForward();
+			widest = std::max(widest, layer.size());
 		}
+		outputValues.resize(countOutputs * batchSize);
+		if (m_pool == nullptr || m_pool->size() <= 1 || batchSize < 2 || m_pool->runsOnWorker()) {
+			auto activations = std::vector<double>(widest * batchSize);
+			auto next        = std::vector<double>(widest * batchSize);
+			feedForwardBatchSlice(
+				inputValues.data(), batchSize, outputValues.data(),
+				activations.data(), next.data(),
+				replicatedWeights(0));
+			return;
+		}
+		m_pool->parallelFor(batchSize, m_pool->size(),
+			[&](size_t first, size_t last, size_t worker) {
+				const auto count = last - first;
+				feedForwardBatchSlice(
+					inputValues.data() + first * countInputs, count,
+					outputValues.data() + first * countOutputs,
+					m_pool->scratch(worker, 0, widest * count),
+					m_pool->scratch(worker, 1, widest * count),
+					replicatedWeights(m_pool->nodeOf(worker)));
+			});
 	}
 
-	void NeuralNet::calculateOverallNetError(
-		const std::vector<double> & targetValues
-	) {
-		assert(targetValues.size() == getOutputLayer().size() &&
-			"there must be equally many target values as neurons in the output layer.");
+	void NeuralNet::feedForwardBatchSlice(
+		const double * inputValues, size_t batchSize,
+		double * outputValues,
+		double * activations, double * next,
+		const std::vector<const double *> & weights
+	) const {
+		// The activations of a layer are stored neuron after neuron
+		// with the values of all samples of the batch next to each
+		// other, so that the inner loop over the batch is contiguous.
+		const auto countInputs = getInputLayer().size();
+		for (auto sample = size_t{0}; sample < batchSize; ++sample) {
+			for (auto i = size_t{0}; i < countInputs; ++i) {
+				activations[i * batchSize + sample] =
+					inputValues[sample * countInputs + i];
+			}
+		}
+		for (auto l = size_t{1}; l < m_layers.size(); ++l) {
+			m_layers[l].feedForwardBatch(activations, batchSize, next, weights[l]);
+			std::swap(activations, next);
+		}
+		const auto countOutputs = getOutputLayer().size();
+		for (auto sample = size_t{0}; sample < batchSize; ++sample) {
+			for (auto o = size_t{0}; o < countOutputs; ++o) {
+				outputValues[sample * countOutputs + o] =
+					activations[o * batchSize + sample];
+			}
+		}
+	}
+
+	auto NeuralNet::replicatedWeights(size_t node) const
+		-> std::vector<const double *>
+	{
+		auto weights = std::vector<const double *>{};
+		weights.reserve(m_layers.size());
+		if (m_replicas == nullptr) {
+			for (auto& layer : m_layers) {
+				weights.push_back(layer.getWeights().data());
+			}
+			return weights;
+		}
+		std::lock_guard<std::mutex> lock{m_replicas->mutex};
+		auto& replica = m_replicas->weights[node];
+		if (m_replicas->versions[node] != m_weights_version) {
+			// Written by the calling worker so that the pages of the
+			// copy are placed on its node.
+			replica.resize(m_layers.size());
+			for (auto l = size_t{0}; l < m_layers.size(); ++l) {
+				replica[l].assign(
+					m_layers[l].getWeights().begin(),
+					m_layers[l].getWeights().end());
+			}
+			m_replicas->versions[node] = m_weights_version;
+		}
+		for (auto& layer : replica) {
+			weights.push_back(layer.data());
+		}
+		return weights;
+	}
+
+	void NeuralNet::setWorkerPool(std::shared_ptr<WorkerPool> pool) {
+		m_pool = std::move(pool);
+		for (auto& layer : m_layers) {
+			if (m_pool == nullptr) {
+				layer.setWorkerPool(nullptr, 1);
+				continue;
+			}
+			const auto countWeights = layer.size() * layer.countIncConnections();
+			layer.setWorkerPool(m_pool.get(),
+				std::max(size_t{1}, countWeights / min_weights_per_thread));
+		}
+		m_replicas = m_pool != nullptr && m_pool->getOptions().replicate_weights
+			? std::make_shared<WeightReplicas>(m_pool->countNodes())
+			: nullptr;
+	}
+
+	auto NeuralNet::getWorkerPool() const
+		-> const std::shared_ptr<WorkerPool> &
+	{
+		return m_pool;
+	}
+
+	void NeuralNet::calculateOverallNetError(const double * targetValues) {
 		m_error = 0.0;
-		/*
-		auto targetValuesIt = targetValues.begin();
 		for (auto& neuron : getOutputLayer()) {
-			const auto delta = *targetValuesIt - neuron.getOutput();
-			m_error += delta * delta;
-			++targetValuesIt;
-		}
-		*/
-		for (auto&& zipped : utility::zip_range(getOutputLayer(), targetValues)) {
-			const auto delta = zipped.get<1>() - zipped.get<0>().getOutput();
+			const auto delta = *targetValues++ - neuron.getOutput();
 			m_error += delta * delta;
 		}
 		m_error /= getOutputLayer().size();
@@ -116,63 +540,494 @@ namespace neuronet {
 			/ (m_recent_avg_smoothing_factor + 1.0);
 	}
 
-	void NeuralNet::calculateOutputLayerGradients(
-		const std::vector<double> & targetValues
-	) {
-		assert(targetValues.size() == getOutputLayer().size() &&
-			"there must be equally many target values as neurons in the output layer.");
-		for (auto&& zipped : utility::zip_range(getOutputLayer(), targetValues)) {
-			zipped.get<0>().calculateOutputGradient(zipped.get<1>());
+	void NeuralNet::calculateOutputLayerGradients(const double * targetValues) {
+		for (auto& neuron : getOutputLayer()) {
+			neuron.calculateOutputGradient(*targetValues++);
 		}
 	}
 
 	void NeuralNet::calculateHiddenLayerGradients() {
 		for (auto& layer : utility::make_reverse(m_layers)) {
 			if (layer.isHiddenLayer()) {
-				for (auto& neuron : layer) {
-					neuron.calculateHiddenGradient();
-				}
+				layer.calculateHiddenGradients();
 			}
 		}
 	}
 
 	void NeuralNet::updateConnectionWeights() {
+		++m_weights_version;
 		for (auto& layer : utility::make_reverse(m_layers)) {
-			if (!layer.isInputLayer()) {
-				for (auto& neuron : layer) {
-					neuron.updateInputWeights();
+			layer.updateInputWeights();
+		}
+	}
+
+	void NeuralNet::accumulateGradients() {
+		for (auto& layer : m_layers) {
+			layer.accumulateGradients();
+		}
+		++m_pending_gradients;
+	}
+
+	void NeuralNet::commitGradients() {
+		assert(m_update_mode == UpdateMode::deferred &&
+			"gradients are only accumulated in deferred update mode.");
+		if (m_pending_gradients == 0) return;
+		++m_weights_version;
+		const auto scale = 1.0 / m_pending_gradients;
+		for (auto& layer : m_layers) {
+			layer.commitGradients(scale);
+		}
+		m_pending_gradients = 0;
+	}
+
+	auto NeuralNet::countParameters() const
+		-> size_t
+	{
+		auto count = size_t{0};
+		for (auto l = size_t{1}; l < m_layers.size(); ++l) {
+			count += m_layers[l].getWeights().size();
+		}
+		return count;
+	}
+
+	void NeuralNet::copyWeights(double * weights) const {
+		for (auto l = size_t{1}; l < m_layers.size(); ++l) {
+			const auto& layerWeights = m_layers[l].getWeights();
+			weights = std::copy(layerWeights.begin(), layerWeights.end(), weights);
+		}
+	}
+
+	void NeuralNet::setWeights(const double * weights) {
+		++m_weights_version;
+		for (auto l = size_t{1}; l < m_layers.size(); ++l) {
+			m_layers[l].setWeights(weights);
+			weights += m_layers[l].getWeights().size();
+		}
+	}
+
+	auto NeuralNet::takeGradients(double * gradients)
+		-> size_t
+	{
+		assert(m_update_mode == UpdateMode::deferred &&
+			"gradients are only accumulated in deferred update mode.");
+		for (auto l = size_t{1}; l < m_layers.size(); ++l) {
+			m_layers[l].takeGradients(gradients);
+			gradients += m_layers[l].getWeights().size();
+		}
+		const auto passes = m_pending_gradients;
+		m_pending_gradients = 0;
+		return passes;
+	}
+
+	void NeuralNet::addGradients(const double * gradients, size_t passes) {
+		assert(m_update_mode == UpdateMode::deferred &&
+			"gradients are only accumulated in deferred update mode.");
+		for (auto l = size_t{1}; l < m_layers.size(); ++l) {
+			m_layers[l].addGradients(gradients);
+			gradients += m_layers[l].getWeights().size();
+		}
+		m_pending_gradients += passes;
+	}
+
+	void NeuralNet::setUpdateMode(UpdateMode mode) {
+		assert(m_pending_gradients == 0 &&
+			"pending gradients must be committed before switching the update mode.");
+		m_update_mode = mode;
+		if (mode == UpdateMode::deferred) decompile();
+		for (auto& layer : m_layers) {
+			layer.setAccumulateGradients(mode == UpdateMode::deferred);
+		}
+	}
+
+	auto NeuralNet::getUpdateMode() const
+		-> UpdateMode
+	{
+		return m_update_mode;
+	}
+
+	auto NeuralNet::countPendingGradients() const
+		-> size_t
+	{
+		return m_pending_gradients;
+	}
+
+	void NeuralNet::backPropagation(const double * targetValues, size_t count) {
+		assert(count == getOutputLayer().size() &&
+			"targetValues must have the same size as the output layer of this neural network.");
+		(void) count;
+		profile(m_profile_phases[phase_error], [&] {
+			calculateOverallNetError(targetValues);
+			calculateAverageError();
+		});
+		if (m_telemetry != nullptr) {
+			m_telemetry->record(*this, m_error);
+		}
+		if (m_plan != nullptr) {
+			profile(m_profile_phases[phase_output_gradients], [&] {
+				m_plan->calculateOutputGradients(targetValues);
+			});
+			profile(m_profile_phases[phase_hidden_gradients], [&] {
+				m_plan->calculateHiddenGradients();
+			});
+			profile(m_profile_phases[phase_weight_updates], [&] {
+				++m_weights_version;
+				m_plan->updateWeights();
+			});
+			return;
+		}
+		profile(m_profile_phases[phase_output_gradients], [&] {
+			calculateOutputLayerGradients(targetValues);
+		});
+		profile(m_profile_phases[phase_hidden_gradients], [&] {
+			calculateHiddenLayerGradients();
+		});
+		profile(m_profile_phases[phase_weight_updates], [&] {
+			if (m_update_mode == UpdateMode::deferred) {
+				accumulateGradients();
+			}
+			else {
+				updateConnectionWeights();
+			}
+		});
+	}
+
+	void NeuralNet::backPropagation(const std::vector<double> & targetValues) {
+		backPropagation(targetValues.data(), targetValues.size());
+	}
+
+	void NeuralNet::trainStep(
+		const double * inputValues,  size_t countInputs,
+		const double * targetValues, size_t countTargets
+	) {
+		feedForward(inputValues, countInputs);
+		backPropagation(targetValues, countTargets);
+	}
+
+	void NeuralNet::trainStep(
+		const std::vector<double> & inputValues,
+		const std::vector<double> & targetValues
+	) {
+		trainStep(
+			inputValues.data(),  inputValues.size(),
+			targetValues.data(), targetValues.size());
+	}
+
+	auto NeuralNet::evaluate(
+		const utility::TrainingData & data,
+		const EvaluationOptions & options
+	) const
+		-> EvaluationResult
+	{
+		const auto countInputs  = getInputLayer().size();
+		const auto countOutputs = getOutputLayer().size();
+		if (data.getTopology().front() != countInputs || data.getTopology().back() != countOutputs) {
+			throw std::invalid_argument{
+				"the data set doesn't match the input and output layers of the neural net."};
+		}
+		if (options.batch_size == 0) {
+			throw std::invalid_argument{"a batch needs at least one pass."};
+		}
+		const auto batchSize    = options.batch_size;
+		const auto countPasses  = static_cast<size_t>(data.end() - data.begin());
+		const auto countBatches = (countPasses + batchSize - 1) / batchSize;
+		const auto classes      = !options.confusion ? size_t{0} : countOutputs > 1 ? countOutputs : size_t{2};
+		auto widest = size_t{0};
+		for (auto& layer : m_layers) {
+			widest = std::max(widest, layer.size());
+		}
+
+		// Passes of a data set may differ from its topology, and a batch
+		// reads them without further checks.
+		for (auto& pass : data) {
+			if (pass.getInputValues().size() != countInputs
+				|| pass.getExpectedValues().size() != countOutputs)
+			{
+				throw std::invalid_argument{
+					"a pass of the data set doesn't match the input and output layers of the neural net."};
+			}
+		}
+
+		const auto classOf = [&](const double * values) -> size_t {
+			if (countOutputs == 1) return values[0] > options.threshold ? 1 : 0;
+			return static_cast<size_t>(std::max_element(values, values + countOutputs) - values);
+		};
+
+		// Every batch sums the squared errors per output and the errors
+		// of its passes on its own. The sums are added up in batch order
+		// afterwards, so that the rounding doesn't depend on which worker
+		// evaluated which batch. Counts are exact in any order.
+		const auto stride   = countOutputs + 1;
+		auto sums           = std::vector<double>(countBatches * stride, 0.0);
+		const auto countWorkers =
+			m_pool == nullptr || m_pool->size() <= 1 || countBatches < 2 || m_pool->runsOnWorker()
+			? size_t{1}
+			: m_pool->size();
+		auto confusions = std::vector<std::vector<size_t>>(countWorkers, std::vector<size_t>(classes * classes, 0));
+
+		const auto evaluateBatches = [&](
+			size_t first, size_t last, size_t worker,
+			double * inputs, double * outputs, double * activations, double * next,
+			const std::vector<const double *> & weights
+		) {
+			auto& confusion = confusions[worker];
+			for (auto batch = first; batch < last; ++batch) {
+				const auto begin = data.begin() + batch * batchSize;
+				const auto count = std::min(batchSize, countPasses - batch * batchSize);
+				for (auto sample = size_t{0}; sample < count; ++sample) {
+					const auto& values = begin[sample].getInputValues();
+					std::copy(values.begin(), values.end(), inputs + sample * countInputs);
 				}
+				feedForwardBatchSlice(inputs, count, outputs, activations, next, weights);
+				const auto batchSums = sums.data() + batch * stride;
+				for (auto sample = size_t{0}; sample < count; ++sample) {
+					const auto& expected = begin[sample].getExpectedValues();
+					const auto  results  = outputs + sample * countOutputs;
+					auto passError = 0.0;
+					for (auto o = size_t{0}; o < countOutputs; ++o) {
+						const auto delta = expected[o] - results[o];
+						batchSums[o] += delta * delta;
+						passError    += delta * delta;
+					}
+					batchSums[countOutputs] += std::sqrt(passError / countOutputs);
+					if (classes > 0) {
+						++confusion[classOf(expected.data()) * classes + classOf(results)];
+					}
+				}
+			}
+		};
+
+		if (countWorkers == 1) {
+			auto inputs      = std::vector<double>(batchSize * countInputs);
+			auto outputs     = std::vector<double>(batchSize * countOutputs);
+			auto activations = std::vector<double>(widest * batchSize);
+			auto next        = std::vector<double>(widest * batchSize);
+			evaluateBatches(
+				0, countBatches, 0,
+				inputs.data(), outputs.data(), activations.data(), next.data(),
+				replicatedWeights(0));
+		}
+		else {
+			m_pool->parallelFor(countBatches, countWorkers,
+				[&](size_t first, size_t last, size_t worker) {
+					evaluateBatches(
+						first, last, worker,
+						m_pool->scratch(worker, 2, batchSize * countInputs),
+						m_pool->scratch(worker, 3, batchSize * countOutputs),
+						m_pool->scratch(worker, 0, widest * batchSize),
+						m_pool->scratch(worker, 1, widest * batchSize),
+						replicatedWeights(m_pool->nodeOf(worker)));
+				});
+		}
+
+		auto result = EvaluationResult{};
+		result.passes  = countPasses;
+		result.classes = classes;
+		result.output_errors.assign(countOutputs, 0.0);
+		result.confusion.assign(classes * classes, 0);
+		if (countPasses == 0) return result;
+		auto squared = 0.0;
+		for (auto batch = size_t{0}; batch < countBatches; ++batch) {
+			const auto batchSums = sums.data() + batch * stride;
+			for (auto o = size_t{0}; o < countOutputs; ++o) {
+				result.output_errors[o] += batchSums[o];
+				squared                 += batchSums[o];
 			}
+			result.mean_pass_error += batchSums[countOutputs];
+		}
+		for (auto& error : result.output_errors) {
+			error = std::sqrt(error / countPasses);
+		}
+		result.rms_error        = std::sqrt(squared / (countPasses * countOutputs));
+		result.mean_pass_error /= countPasses;
+		for (auto& confusion : confusions) {
+			std::transform(
+				confusion.begin(), confusion.end(), result.confusion.begin(),
+				result.confusion.begin(), std::plus<size_t>{});
 		}
+		for (auto c = size_t{0}; c < classes; ++c) {
+			result.correct += result.confusion[c * classes + c];
+		}
+		return result;
 	}
 
-	void NeuralNet::backPropagation(const std::vector<double> & targetValues) {
-		assert(targetValues.size() == getOutputLayer().size() &&
-			"targetValues must have the same size as the output layer of this neural network.");
-		calculateOverallNetError(targetValues);
-		calculateAverageError();
-		calculateOutputLayerGradients(targetValues);
-		calculateHiddenLayerGradients();
-		updateConnectionWeights();
+	auto NeuralNet::trainAsync(const utility::TrainingData & data, TrainingOptions options)
+		-> TrainingHandle
+	{
+		return TrainingHandle{*this, data, std::move(options)};
+	}
+
+	void NeuralNet::results(double * outputValues, size_t count) const {
+		assert(count == getOutputLayer().size() &&
+			"outputValues must have the same size as the output layer of this neural network.");
+		(void) count;
+		for (auto& neuron : getOutputLayer()) {
+			*outputValues++ = neuron.getOutput();
+		}
 	}
 
 	auto NeuralNet::results() const
 		-> std::vector<double>
 	{
-		auto result = std::vector<double>{};
-		     result.reserve(getOutputLayer().size());
-		for (auto& neuron : getOutputLayer()) {
-			result.push_back(neuron.getOutput());
-		}
+		auto result = std::vector<double>(getOutputLayer().size());
+		results(result.data(), result.size());
 		return result;
 	}
 
+	auto NeuralNet::getWeightsVersion() const
+		-> size_t
+	{
+		return m_weights_version;
+	}
+
 	auto NeuralNet::getRecentAverageError() const
 		-> double
 	{
 		return m_recent_avg_error;
 	}
 
+	void NeuralNet::setErrorSmoothing(double window) {
+		assert(window >= 0.0 &&
+			"the smoothing window must not be negative.");
+		m_recent_avg_smoothing_factor = window;
+	}
+
+	auto NeuralNet::getErrorSmoothing() const
+		-> double
+	{
+		return m_recent_avg_smoothing_factor;
+	}
+
+	void NeuralNet::setTelemetry(std::shared_ptr<Telemetry> telemetry) {
+		m_telemetry = std::move(telemetry);
+	}
+
+	void NeuralNet::setEngine(NeuralLayer::Engine engine) {
+		for (auto& layer : m_layers) {
+			layer.setEngine(engine);
+		}
+	}
+
+	void NeuralNet::compile() {
+		if (m_update_mode != UpdateMode::immediate || m_incremental) {
+			throw std::invalid_argument{
+				"only the immediate update mode without incremental evaluation can be compiled."};
+		}
+		for (auto& layer : m_layers) {
+			if (layer.getWeightFormat() != NeuralLayer::WeightFormat::fp64) {
+				throw std::invalid_argument{"only fp64 weights can be compiled."};
+			}
+			if (layer.isConvolutional()) {
+				throw std::invalid_argument{"convolutional layers can't be compiled."};
+			}
+		}
+		m_plan = std::make_shared<ExecutionPlan>(*this, m_layers);
+	}
+
+	void NeuralNet::decompile() {
+		m_plan = nullptr;
+	}
+
+	bool NeuralNet::isCompiled() const {
+		return m_plan != nullptr;
+	}
+
+	void NeuralNet::setWeightFormat(NeuralLayer::WeightFormat format, bool halfInputs) {
+		if (format != NeuralLayer::WeightFormat::fp64) decompile();
+		for (auto& layer : m_layers) {
+			layer.setWeightFormat(format, halfInputs);
+		}
+	}
+
+	void NeuralNet::setTrainingRate(double eta) {
+		for (auto& layer : m_layers) {
+			layer.setTrainingRate(eta);
+		}
+	}
+
+	auto NeuralNet::getTrainingRate() const
+		-> double
+	{
+		return getOutputLayer().getTrainingRate();
+	}
+
+	void NeuralNet::setMomentum(double alpha) {
+		for (auto& layer : m_layers) {
+			layer.setMomentum(alpha);
+		}
+	}
+
+	auto NeuralNet::getMomentum() const
+		-> double
+	{
+		return getOutputLayer().getMomentum();
+	}
+
+	void NeuralNet::setLayerEngine(size_t layer, NeuralLayer::Engine engine) {
+		assert(layer < m_layers.size() &&
+			"there is no layer with the given index.");
+		m_layers[layer].setEngine(engine);
+	}
+
+	void NeuralNet::setLayerBlocking(size_t layer, const kernels::Blocking & blocking) {
+		assert(layer < m_layers.size() &&
+			"there is no layer with the given index.");
+		m_layers[layer].setBlocking(blocking);
+	}
+
+	void NeuralNet::setLayerThreads(size_t layer, size_t threads) {
+		assert(layer < m_layers.size() &&
+			"there is no layer with the given index.");
+		m_layers[layer].setThreads(threads);
+	}
+
+	auto NeuralNet::memoryUsage() const
+		-> NetMemoryUsage
+	{
+		auto usage = NetMemoryUsage{};
+		usage.layers.reserve(m_layers.size());
+		for (auto& layer : m_layers) {
+			usage.layers.push_back(layer.memoryUsage());
+		}
+		usage.bias = m_bias.memoryUsage();
+		// The bias is a member of the net object and thus
+		// accounted there already.
+		usage.bias.connection_metadata -= sizeof(Neuron) - usage.bias.activations;
+		usage.bias.activations = 0;
+		usage.network.connection_metadata = sizeof(NeuralNet)
+			+ (m_layers.capacity() - m_layers.size()) * sizeof(NeuralLayer);
+		if (m_replicas != nullptr) {
+			std::lock_guard<std::mutex> lock{m_replicas->mutex};
+			usage.network.connection_metadata += sizeof(WeightReplicas);
+			for (auto& replica : m_replicas->weights) {
+				for (auto& weights : replica) {
+					usage.network.weights += weights.capacity() * sizeof(double);
+				}
+			}
+		}
+		if (m_plan != nullptr) {
+			usage.network += m_plan->memoryUsage();
+		}
+		return usage;
+	}
+
+	auto NeuralNet::getLayers() const
+		-> const std::vector<NeuralLayer> &
+	{
+		return m_layers;
+	}
+
+	auto NeuralNet::getConvolutions() const
+		-> std::vector<Convolution>
+	{
+		auto convolutions = std::vector<Convolution>{};
+		for (auto& layer : m_layers) {
+			if (layer.isConvolutional()) {
+				convolutions.push_back(layer.getConvolution());
+			}
+		}
+		return convolutions;
+	}
+
 	auto NeuralNet::getInputLayer()
 		-> NeuralLayer &
 	{
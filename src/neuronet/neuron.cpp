@@ -21,9 +21,18 @@ namespace neuronet {
 	}
 
 	void Neuron::fullyConnect(NeuralLayer & layer) {
-		m_connections.reserve(layer.size());
+		// The weights are stored within the column of this neuron in the
+		// weight matrix of the target layer; the bias owns the last column.
+		const auto input = isBias()
+			? layer.countIncConnections() - 1
+			: getLayer().indexOf(*this);
+		m_connections.reserve(m_connections.size() + layer.size());
+		auto target = size_t{0};
 		for (auto& neuron : layer) {
-			m_connections.emplace_back(*this, neuron);
+			m_connections.emplace_back(*this, neuron,
+				layer.weightOf(target, input),
+				layer.deltaWeightOf(target, input));
+			++target;
 		}
 	}
 
@@ -51,6 +60,30 @@ namespace neuronet {
 		m_output = Neuron::transferFunction(sumWeights);
 	}
 
+	void Neuron::feedForwardBatch(
+		const double * prevOutputs, size_t batchSize, double * outputs
+	) const {
+		std::fill(outputs, outputs + batchSize, 0.0);
+		for (auto&& connection : m_inc_connections) {
+			const auto& source = connection->getSource();
+			const auto  weight = connection->getWeight();
+			if (source.isBias()) {
+				for (auto sample = size_t{0}; sample < batchSize; ++sample) {
+					outputs[sample] += weight * source.getOutput();
+				}
+				continue;
+			}
+			const auto sourceOutputs =
+				prevOutputs + source.getLayer().indexOf(source) * batchSize;
+			for (auto sample = size_t{0}; sample < batchSize; ++sample) {
+				outputs[sample] += weight * sourceOutputs[sample];
+			}
+		}
+		for (auto sample = size_t{0}; sample < batchSize; ++sample) {
+			outputs[sample] = Neuron::transferFunction(outputs[sample]);
+		}
+	}
+
 	void Neuron::calculateOutputGradient(double targetValue) {
 		assert(getLayer().isOutputLayer() &&
 			"this operation is only defined for neurons within the output layer.");
@@ -64,6 +97,18 @@ namespace neuronet {
 		m_gradient = sumDeltaOutputWeights() * Neuron::transferFunctionDerivate(m_output);
 	}
 
+	void Neuron::calculateHiddenGradient(double sumDeltaOutputWeights) {
+		assert(getLayer().isHiddenLayer() &&
+			"this operation is only defined for neurons within the hidden layer.");
+		m_gradient = sumDeltaOutputWeights * Neuron::transferFunctionDerivate(m_output);
+	}
+
+	auto Neuron::getGradient() const
+		-> double
+	{
+		return m_gradient;
+	}
+
 	auto Neuron::sumDeltaOutputWeights() const
 		-> double
 	{
@@ -77,6 +122,8 @@ namespace neuronet {
 	void Neuron::updateInputWeights() {
 		assert(!getLayer().isInputLayer() &&
 			"this operation is not defined for neurons within the input layer.");
+		const auto eta   = getLayer().getTrainingRate();
+		const auto alpha = getLayer().getMomentum();
 		for (auto& connection : m_inc_connections) {
 			const double newDeltaWeight =
 				// Individual input, megnified by the gradient and train rate
@@ -90,6 +137,28 @@ namespace neuronet {
 		}
 	}
 
+	void Neuron::accumulateInputGradients(double * accumulators) const {
+		assert(!getLayer().isInputLayer() &&
+			"this operation is not defined for neurons within the input layer.");
+		for (auto& connection : m_inc_connections) {
+			*accumulators++ += connection->getSource().getOutput() * m_gradient;
+		}
+	}
+
+	void Neuron::commitInputGradients(double * accumulators, double scale) {
+		assert(!getLayer().isInputLayer() &&
+			"this operation is not defined for neurons within the input layer.");
+		const auto eta   = getLayer().getTrainingRate();
+		const auto alpha = getLayer().getMomentum();
+		for (auto& connection : m_inc_connections) {
+			const double newDeltaWeight =
+				eta * scale * *accumulators
+				+ alpha * connection->getDeltaWeight();
+			connection->setWeight(connection->getWeight() + newDeltaWeight);
+			*accumulators++ = 0.0;
+		}
+	}
+
 	auto Neuron::getLayer()
 		-> NeuralLayer &
 	{
@@ -110,8 +179,26 @@ namespace neuronet {
 		m_inc_connections.push_back(std::addressof(connection));
 	}
 
-	double Neuron::eta   = 0.15;
-	double Neuron::alpha = 0.5;
+	auto Neuron::getIncConnections() const
+		-> const std::vector<NeuralConnection*> &
+	{
+		return m_inc_connections;
+	}
+
+	bool Neuron::isBias() const {
+		return m_layer == nullptr;
+	}
+
+	auto Neuron::memoryUsage() const
+		-> MemoryUsage
+	{
+		auto usage = MemoryUsage{};
+		usage.activations          = sizeof(m_output) + sizeof(m_gradient);
+		usage.connection_metadata  = sizeof(Neuron) - usage.activations;
+		usage.connection_metadata += m_connections.capacity() * sizeof(NeuralConnection);
+		usage.connection_metadata += m_inc_connections.capacity() * sizeof(NeuralConnection*);
+		return usage;
+	}
 
 	auto Neuron::transferFunction(double x)
 		-> double
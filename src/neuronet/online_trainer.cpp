@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "neuronet/online_trainer.hpp"
+#include "neuronet/neural_net.hpp"
+#include "neuronet/neural_layer.hpp"
+
+#include "utility/training_stream.hpp"
+
+namespace neuronet {
+	OnlineTrainer::OnlineTrainer(NeuralNet & net, OnlineTrainingOptions options):
+		m_net(net),
+		m_options(std::move(options)),
+		m_random{m_options.seed},
+		m_count_inputs{net.getLayers().front().size()},
+		m_count_outputs{net.getLayers().back().size()},
+		m_buffer((m_options.buffer_capacity + 1) * (m_count_inputs + m_count_outputs))
+	{}
+
+	auto OnlineTrainer::getStats() const
+		-> const OnlineTrainingStats &
+	{
+		return m_stats;
+	}
+
+	auto OnlineTrainer::slot(size_t index)
+		-> double *
+	{
+		return m_buffer.data() + index * (m_count_inputs + m_count_outputs);
+	}
+
+	void OnlineTrainer::trainOn(const double * pass) {
+		m_net.trainStep(
+			pass,                  m_count_inputs,
+			pass + m_count_inputs, m_count_outputs);
+		++m_stats.passes_trained;
+		if (m_options.publish_interval > 0
+			&& m_stats.passes_trained % m_options.publish_interval == 0)
+		{
+			publish();
+		}
+	}
+
+	void OnlineTrainer::publish() {
+		if (m_net.getUpdateMode() == NeuralNet::UpdateMode::deferred
+			&& m_net.countPendingGradients() > 0)
+		{
+			m_net.commitGradients();
+		}
+		m_stats.recent_average_error = m_net.getRecentAverageError();
+		if (!m_options.publish) return;
+		++m_stats.publications;
+		m_published_at = m_stats.passes_trained;
+		m_options.publish(m_net, m_stats);
+	}
+
+	void OnlineTrainer::train(utility::TrainingStream & stream) {
+		const auto& topology = stream.getTopology();
+		const auto& layers   = m_net.getLayers();
+		if (topology.size() != layers.size()
+			|| !std::equal(topology.begin(), topology.end(), layers.begin(),
+				[](uint64_t count, const NeuralLayer & layer) { return count == layer.size(); }))
+		{
+			throw std::invalid_argument{
+				"the topology of the training stream does not match the neural net."};
+		}
+		const auto capacity = m_options.buffer_capacity;
+		const auto incoming = slot(capacity);
+		while (stream.next(incoming, incoming + m_count_inputs)) {
+			++m_stats.passes_read;
+			if (capacity == 0) {
+				trainOn(incoming);
+			}
+			else if (m_count_buffered < capacity) {
+				// Trains from the first pass on instead of only once the
+				// buffer is full, on the part of it filled so far.
+				std::copy(incoming, slot(capacity + 1), slot(m_count_buffered++));
+				trainOn(slot(std::uniform_int_distribution<size_t>{0, m_count_buffered - 1}(m_random)));
+			}
+			else {
+				const auto chosen = slot(
+					std::uniform_int_distribution<size_t>{0, capacity - 1}(m_random));
+				trainOn(chosen);
+				std::copy(incoming, slot(capacity + 1), chosen);
+			}
+			for (auto i = size_t{0}; i < m_options.replays && m_count_buffered > 0; ++i) {
+				trainOn(slot(std::uniform_int_distribution<size_t>{0, m_count_buffered - 1}(m_random)));
+			}
+		}
+
+		// Drains the buffer in random order by moving every chosen pass
+		// behind the passes that are still to be trained.
+		while (m_count_buffered > 0) {
+			const auto chosen = std::uniform_int_distribution<size_t>{0, m_count_buffered - 1}(m_random);
+			--m_count_buffered;
+			std::swap_ranges(slot(chosen), slot(chosen + 1), slot(m_count_buffered));
+			trainOn(slot(m_count_buffered));
+		}
+		if (m_stats.publications == 0 || m_published_at != m_stats.passes_trained) {
+			publish();
+		}
+	}
+}
@@ -0,0 +1,403 @@
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "neuronet/parameter_server.hpp"
+#include "neuronet/neural_net.hpp"
+#include "neuronet/kernels.hpp"
+#include "utility/training_data.hpp"
+
+namespace neuronet {
+	namespace {
+		//====================================================================
+		// Every message starts with this header followed by count values
+		// of the payload; value carries the version of the weights or the
+		// passes of the pushed gradients.
+		//====================================================================
+		enum class MessageType : uint32_t {
+			hello,
+			topology,
+			weights,
+			push,
+			done
+		};
+
+		struct MessageHeader {
+			MessageType type;
+			uint32_t    format;
+			uint64_t    count;
+			uint64_t    value;
+		};
+
+		// Closes the descriptor it owns on destruction.
+		class Socket {
+		public:
+			explicit Socket(int fd): m_fd(fd) {}
+			~Socket() { if (m_fd >= 0) ::close(m_fd); }
+
+			Socket(const Socket &) = delete;
+			Socket & operator=(const Socket &) = delete;
+
+			auto get() const -> int { return m_fd; }
+
+		private:
+			int m_fd;
+		};
+
+		void sendAll(int fd, const void * data, size_t size) {
+			auto bytes = static_cast<const char *>(data);
+			while (size > 0) {
+				const auto count = ::send(fd, bytes, size, MSG_NOSIGNAL);
+				if (count < 0) {
+					if (errno == EINTR) continue;
+					throw std::system_error{errno, std::generic_category(), "send"};
+				}
+				bytes += count;
+				size  -= static_cast<size_t>(count);
+			}
+		}
+
+		void receiveAll(int fd, void * data, size_t size) {
+			auto bytes = static_cast<char *>(data);
+			while (size > 0) {
+				const auto count = ::recv(fd, bytes, size, 0);
+				if (count < 0) {
+					if (errno == EINTR) continue;
+					throw std::system_error{errno, std::generic_category(), "recv"};
+				}
+				if (count == 0) {
+					throw std::runtime_error{"the connection was closed in the middle of a message"};
+				}
+				bytes += count;
+				size  -= static_cast<size_t>(count);
+			}
+		}
+
+		// Sends a message and returns its size in bytes.
+		auto sendMessage(
+			int fd, MessageType type, uint32_t format, uint64_t value,
+			const void * payload, uint64_t count, size_t valueSize)
+			-> uint64_t
+		{
+			const auto header = MessageHeader{type, format, count, value};
+			sendAll(fd, &header, sizeof(header));
+			sendAll(fd, payload, count * valueSize);
+			return sizeof(header) + count * valueSize;
+		}
+
+		auto receiveHeader(int fd)
+			-> MessageHeader
+		{
+			auto header = MessageHeader{};
+			receiveAll(fd, &header, sizeof(header));
+			return header;
+		}
+
+		void expect(const MessageHeader & header, MessageType type, uint64_t count) {
+			if (header.type != type || header.count != count) {
+				throw std::runtime_error{"unexpected message from the peer"};
+			}
+		}
+
+		//====================================================================
+		// Resolves "unix:<path>" or "<host>:<port>" into a socket address.
+		//====================================================================
+		struct Address {
+			sockaddr_storage storage;
+			socklen_t        length;
+			bool             tcp;
+		};
+
+		auto resolve(const std::string & address)
+			-> Address
+		{
+			auto result = Address{};
+			if (address.compare(0, 5, "unix:") == 0) {
+				const auto path = address.substr(5);
+				auto& local = reinterpret_cast<sockaddr_un &>(result.storage);
+				if (path.size() >= sizeof(local.sun_path)) {
+					throw std::invalid_argument{"the path of the socket is too long."};
+				}
+				local.sun_family = AF_UNIX;
+				std::strcpy(local.sun_path, path.c_str());
+				result.length = sizeof(sockaddr_un);
+				result.tcp    = false;
+				return result;
+			}
+			const auto colon = address.rfind(':');
+			if (colon == std::string::npos) {
+				throw std::invalid_argument{"expected unix:<path> or <host>:<port> as address: " + address};
+			}
+			const auto host = address.substr(0, colon);
+			const auto port = address.substr(colon + 1);
+			auto hints = addrinfo{};
+			hints.ai_family   = AF_UNSPEC;
+			hints.ai_socktype = SOCK_STREAM;
+			addrinfo * found  = nullptr;
+			const auto error  = ::getaddrinfo(host.c_str(), port.c_str(), &hints, &found);
+			if (error != 0) {
+				throw std::runtime_error{"can't resolve " + address + ": " + ::gai_strerror(error)};
+			}
+			std::memcpy(&result.storage, found->ai_addr, found->ai_addrlen);
+			result.length = found->ai_addrlen;
+			result.tcp    = true;
+			::freeaddrinfo(found);
+			return result;
+		}
+
+		auto openSocket(const Address & address)
+			-> int
+		{
+			const auto fd = ::socket(address.storage.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			if (fd < 0) {
+				throw std::system_error{errno, std::generic_category(), "socket"};
+			}
+			return fd;
+		}
+
+		// Small messages must not wait for more data to come.
+		void disableNagle(int fd, const Address & address) {
+			if (!address.tcp) return;
+			const auto enabled = 1;
+			::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+		}
+
+		auto valueSizeOf(GradientCompression compression)
+			-> size_t
+		{
+			return compression == GradientCompression::none ? sizeof(double) : sizeof(uint16_t);
+		}
+
+		auto halfFormatOf(GradientCompression compression)
+			-> kernels::HalfFormat
+		{
+			return compression == GradientCompression::fp16
+				? kernels::HalfFormat::fp16
+				: kernels::HalfFormat::bf16;
+		}
+	}
+
+	ParameterServer::ParameterServer(NeuralNet & net, const ParameterServerOptions & options):
+		m_net(net),
+		m_options(options),
+		m_listener{-1}
+	{
+		if (options.workers == 0) {
+			throw std::invalid_argument{"the parameter server needs at least one worker"};
+		}
+		if (!net.getConvolutions().empty()) {
+			// Workers create their neural nets from the topology alone.
+			throw std::invalid_argument{"the parameter server doesn't support convolutional layers"};
+		}
+		const auto address = resolve(options.address);
+		m_listener = openSocket(address);
+		const auto reuse = 1;
+		::setsockopt(m_listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+		if (!address.tcp) {
+			::unlink(reinterpret_cast<const sockaddr_un &>(address.storage).sun_path);
+		}
+		if (::bind(m_listener, reinterpret_cast<const sockaddr *>(&address.storage), address.length) != 0
+			|| ::listen(m_listener, static_cast<int>(options.workers)) != 0)
+		{
+			const auto error = errno;
+			::close(m_listener);
+			throw std::system_error{error, std::generic_category(), "listen on " + options.address};
+		}
+		if (m_net.getUpdateMode() != NeuralNet::UpdateMode::deferred) {
+			m_net.setUpdateMode(NeuralNet::UpdateMode::deferred);
+		}
+	}
+
+	ParameterServer::~ParameterServer() {
+		::close(m_listener);
+	}
+
+	auto ParameterServer::run()
+		-> ParameterServerStats
+	{
+		auto threads = std::vector<std::thread>{};
+		auto errors  = std::vector<std::string>(m_options.workers);
+		auto acceptError = 0;
+		for (auto worker = size_t{0}; worker < m_options.workers; ++worker) {
+			const auto connection = ::accept4(m_listener, nullptr, nullptr, SOCK_CLOEXEC);
+			if (connection < 0) {
+				if (errno == EINTR) { --worker; continue; }
+				acceptError = errno;
+				break;
+			}
+			// Fails harmlessly on unix domain sockets.
+			const auto enabled = 1;
+			::setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+			threads.emplace_back([this, connection, worker, &errors] {
+				try {
+					serve(connection, worker);
+				}
+				catch (const std::exception & error) {
+					errors[worker] = error.what();
+				}
+			});
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		if (acceptError != 0) {
+			throw std::system_error{acceptError, std::generic_category(), "accept"};
+		}
+		for (auto worker = size_t{0}; worker < errors.size(); ++worker) {
+			if (!errors[worker].empty() && m_options.report != nullptr) {
+				*m_options.report << "worker " << worker << " failed: " << errors[worker] << '\n';
+			}
+		}
+		return m_stats;
+	}
+
+	void ParameterServer::serve(int fd, size_t worker) {
+		const Socket connection{fd};
+		const auto count      = m_net.countParameters();
+		auto weights   = std::vector<double>(count);
+		auto gradients = std::vector<double>(count);
+		auto halves    = std::vector<uint16_t>{};
+		auto received  = uint64_t{0};
+		auto sent      = uint64_t{0};
+		auto pushes    = uint64_t{0};
+		auto passes    = uint64_t{0};
+
+		expect(receiveHeader(fd), MessageType::hello, 0);
+		received += sizeof(MessageHeader);
+		const auto& layers = m_net.getLayers();
+		auto topology = std::vector<uint64_t>{};
+		for (auto& layer : layers) topology.push_back(layer.size());
+		auto version = uint64_t{0};
+		{
+			std::lock_guard<std::mutex> lock{m_mutex};
+			m_net.copyWeights(weights.data());
+			version = m_net.getWeightsVersion();
+		}
+		sent += sendMessage(fd, MessageType::topology, 0, 0, topology.data(), topology.size(), sizeof(uint64_t));
+		sent += sendMessage(fd, MessageType::weights, 0, version, weights.data(), count, sizeof(double));
+
+		for (;;) {
+			const auto header = receiveHeader(fd);
+			received += sizeof(header);
+			if (header.type == MessageType::done) break;
+			expect(header, MessageType::push, count);
+			const auto compression = static_cast<GradientCompression>(header.format);
+			if (compression == GradientCompression::none) {
+				receiveAll(fd, gradients.data(), count * sizeof(double));
+			}
+			else if (compression == GradientCompression::fp16 || compression == GradientCompression::bf16) {
+				halves.resize(count);
+				receiveAll(fd, halves.data(), count * sizeof(uint16_t));
+				kernels::fromHalf(halfFormatOf(compression), halves.data(), count, gradients.data());
+			}
+			else {
+				throw std::runtime_error{"unknown gradient compression"};
+			}
+			received += count * valueSizeOf(compression);
+			++pushes;
+			passes += header.value;
+			{
+				std::lock_guard<std::mutex> lock{m_mutex};
+				m_net.addGradients(gradients.data(), header.value);
+				m_net.commitGradients();
+				m_net.copyWeights(weights.data());
+				version = m_net.getWeightsVersion();
+			}
+			sent += sendMessage(fd, MessageType::weights, 0, version, weights.data(), count, sizeof(double));
+		}
+
+		std::lock_guard<std::mutex> lock{m_mutex};
+		m_stats.pushes         += pushes;
+		m_stats.passes         += passes;
+		m_stats.bytes_received += received;
+		m_stats.bytes_sent     += sent;
+		if (m_options.report != nullptr) {
+			*m_options.report << "worker " << worker << " done after " << pushes << " pushes of "
+			                  << passes << " passes\n";
+		}
+	}
+
+	auto runTrainingWorker(const utility::TrainingData & data, const TrainingWorkerOptions & options)
+		-> TrainingWorkerStats
+	{
+		if (options.shards == 0 || options.shard >= options.shards || options.batch_passes == 0) {
+			throw std::invalid_argument{"invalid shard or batch size of a training worker"};
+		}
+		const auto address    = resolve(options.address);
+		const Socket connection{openSocket(address)};
+		const auto fd         = connection.get();
+		if (::connect(fd, reinterpret_cast<const sockaddr *>(&address.storage), address.length) != 0) {
+			throw std::system_error{errno, std::generic_category(), "connect to " + options.address};
+		}
+		disableNagle(fd, address);
+
+		auto stats = TrainingWorkerStats{};
+		stats.bytes_sent += sendMessage(fd, MessageType::hello, 0, 0, nullptr, 0, 0);
+		const auto topologyHeader = receiveHeader(fd);
+		if (topologyHeader.type != MessageType::topology) {
+			throw std::runtime_error{"unexpected message from the parameter server"};
+		}
+		auto topology = std::vector<uint64_t>(topologyHeader.count);
+		receiveAll(fd, topology.data(), topology.size() * sizeof(uint64_t));
+		if (topology != data.getTopology()) {
+			throw std::invalid_argument{"the training data doesn't match the topology of the parameter server"};
+		}
+
+		NeuralNet net{topology};
+		net.setUpdateMode(NeuralNet::UpdateMode::deferred);
+		const auto count = net.countParameters();
+		auto weights   = std::vector<double>(count);
+		auto gradients = std::vector<double>(count);
+		auto halves    = std::vector<uint16_t>(count);
+		const auto pullWeights = [&] {
+			expect(receiveHeader(fd), MessageType::weights, count);
+			receiveAll(fd, weights.data(), count * sizeof(double));
+			net.setWeights(weights.data());
+		};
+		const auto pushGradients = [&] {
+			const auto passes = net.takeGradients(gradients.data());
+			const auto format = static_cast<uint32_t>(options.compression);
+			if (options.compression == GradientCompression::none) {
+				stats.bytes_sent += sendMessage(fd, MessageType::push, format, passes,
+					gradients.data(), count, sizeof(double));
+			}
+			else {
+				kernels::toHalf(halfFormatOf(options.compression), gradients.data(), count, halves.data());
+				stats.bytes_sent += sendMessage(fd, MessageType::push, format, passes,
+					halves.data(), count, sizeof(uint16_t));
+			}
+			++stats.pushes;
+			pullWeights();
+		};
+
+		pullWeights();
+		for (auto epoch = size_t{0}; epoch < options.epochs; ++epoch) {
+			auto index = size_t{0};
+			for (auto& pass : data) {
+				if (index++ % options.shards != options.shard) continue;
+				net.feedForward(pass.getInputValues());
+				net.backPropagation(pass.getExpectedValues());
+				++stats.passes;
+				if (net.countPendingGradients() == options.batch_passes) {
+					pushGradients();
+				}
+			}
+		}
+		if (net.countPendingGradients() > 0) {
+			pushGradients();
+		}
+		stats.bytes_sent += sendMessage(fd, MessageType::done, 0, 0, nullptr, 0, 0);
+		stats.recent_average_error = net.getRecentAverageError();
+		return stats;
+	}
+}
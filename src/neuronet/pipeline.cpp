@@ -0,0 +1,298 @@
+#include <cassert>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef __linux__
+	#include <pthread.h>
+	#include <sched.h>
+#endif
+
+#include "neuronet/pipeline.hpp"
+#include "neuronet/neural_net.hpp"
+#include "neuronet/neural_layer.hpp"
+
+namespace neuronet {
+	namespace {
+		constexpr size_t cache_line = 64;
+
+		void pinCurrentThread(int cpu) {
+#ifdef __linux__
+			if (cpu < 0) return;
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(cpu, &set);
+			pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+			(void) cpu;
+#endif
+		}
+
+		void relax() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+			__builtin_ia32_pause();
+#endif
+		}
+
+		//====================================================================
+		// Spins on the given condition for a while, then yields the cpu for
+		// a while and finally sleeps between checks, doubling the sleep up
+		// to max_sleep, until it holds or stop is set. Busy stages thus hand
+		// over activations within the spin phase while idle stages cost
+		// almost no cpu. Returns the condition.
+		//====================================================================
+		constexpr auto spin_rounds  = 256;
+		constexpr auto yield_rounds = 256;
+		constexpr auto max_sleep    = std::chrono::microseconds{500};
+
+		template <typename Condition>
+		auto waitFor(Condition condition, const std::atomic<bool> & stop)
+			-> bool
+		{
+			auto sleep = std::chrono::microseconds{1};
+			for (auto rounds = 0; !condition(); ++rounds) {
+				if (stop.load(std::memory_order_relaxed)) return false;
+				if (rounds < spin_rounds) {
+					relax();
+				}
+				else if (rounds < spin_rounds + yield_rounds) {
+					std::this_thread::yield();
+				}
+				else {
+					std::this_thread::sleep_for(sleep);
+					sleep = std::min(sleep * 2, max_sleep);
+				}
+			}
+			return true;
+		}
+
+		//====================================================================
+		// Splits the layers [1, countLayers) into count contiguous stages of
+		// about the same number of weights each.
+		//====================================================================
+		auto splitStages(const NeuralNet & net, size_t count)
+			-> std::vector<size_t>
+		{
+			const auto& layers = net.getLayers();
+			auto total = size_t{0};
+			for (auto l = size_t{1}; l < layers.size(); ++l) {
+				total += layers[l].size() * layers[l].countIncConnections();
+			}
+			auto firsts = std::vector<size_t>{1};
+			auto sum    = size_t{0};
+			for (auto l = size_t{1}; l + 1 < layers.size(); ++l) {
+				sum += layers[l].size() * layers[l].countIncConnections();
+				const auto layersLeft = layers.size() - 1 - l;
+				const auto stagesLeft = count - firsts.size();
+				if (stagesLeft == 0) break;
+				if (sum * count >= total * firsts.size() || layersLeft == stagesLeft) {
+					firsts.push_back(l + 1);
+				}
+			}
+			return firsts;
+		}
+	}
+
+	//====================================================================
+	// Bounded ring of activation vectors of equal width. The producer
+	// writes into the slot at tail and publishes it by advancing tail,
+	// the consumer reads the slot at head and frees it by advancing
+	// head. Both positions live on their own cache line.
+	//====================================================================
+	struct Pipeline::Queue {
+		Queue(size_t capacity, size_t width):
+			m_head{0},
+			m_tail{0},
+			m_closed{false},
+			m_mask(capacity - 1),
+			m_width(width),
+			m_values(capacity * width)
+		{}
+
+		// Returns the slot to write or null if the ring is full.
+		auto writable()
+			-> double *
+		{
+			const auto tail = m_tail.load(std::memory_order_relaxed);
+			if (tail - m_head.load(std::memory_order_acquire) > m_mask) return nullptr;
+			return m_values.data() + (tail & m_mask) * m_width;
+		}
+
+		void publish() {
+			m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		// Returns the slot to read or null if the ring is empty.
+		auto readable()
+			-> const double *
+		{
+			const auto head = m_head.load(std::memory_order_relaxed);
+			if (head == m_tail.load(std::memory_order_acquire)) return nullptr;
+			return m_values.data() + (head & m_mask) * m_width;
+		}
+
+		void release() {
+			m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		void close() {
+			m_closed.store(true, std::memory_order_release);
+		}
+
+		// True once the producer closed the ring and the consumer
+		// read everything published before.
+		bool isDrained() {
+			return m_closed.load(std::memory_order_acquire) && readable() == nullptr;
+		}
+
+		auto width() const
+			-> size_t
+		{
+			return m_width;
+		}
+
+	private:
+		std::atomic<size_t> m_head;
+		char m_head_padding[cache_line - sizeof(std::atomic<size_t>)];
+		std::atomic<size_t> m_tail;
+		char m_tail_padding[cache_line - sizeof(std::atomic<size_t>)];
+		std::atomic<bool>   m_closed;
+		size_t              m_mask;
+		size_t              m_width;
+		std::vector<double> m_values;
+	};
+
+	Pipeline::Pipeline(const NeuralNet & net, const PipelineOptions & options):
+		m_net(net),
+		m_stopping{false}
+	{
+		const auto& layers = net.getLayers();
+		if (layers.size() < 2) {
+			throw std::invalid_argument{"a pipeline needs a neural net with at least two layers"};
+		}
+		if (options.queue_capacity == 0) {
+			throw std::invalid_argument{"the queues of a pipeline need a capacity"};
+		}
+		auto capacity = size_t{1};
+		while (capacity < options.queue_capacity) capacity *= 2;
+		const auto countStages = options.stages == 0
+			? layers.size() - 1
+			: std::min(options.stages, layers.size() - 1);
+		m_stage_layers = splitStages(net, countStages);
+		m_stage_layers.push_back(layers.size());
+		for (auto first : m_stage_layers) {
+			m_queues.emplace_back(new Queue{capacity, layers[first - 1].size()});
+		}
+		m_stage_layers.pop_back();
+		for (auto stage = size_t{0}; stage < m_stage_layers.size(); ++stage) {
+			const auto cpu = options.cpus.empty() ? -1 : options.cpus[stage % options.cpus.size()];
+			m_threads.emplace_back([this, stage, cpu] { runStage(stage, cpu); });
+		}
+	}
+
+	Pipeline::~Pipeline() {
+		m_stopping.store(true, std::memory_order_relaxed);
+		for (auto& thread : m_threads) {
+			thread.join();
+		}
+	}
+
+	void Pipeline::runStage(size_t stage, int cpu) {
+		pinCurrentThread(cpu);
+		const auto& layers = m_net.getLayers();
+		auto& input  = *m_queues[stage];
+		auto& output = *m_queues[stage + 1];
+		const auto first = m_stage_layers[stage];
+		const auto last  = stage + 1 < m_stage_layers.size() ? m_stage_layers[stage + 1] : layers.size();
+		auto widest = size_t{0};
+		for (auto l = first; l < last; ++l) {
+			widest = std::max(widest, layers[l].size());
+		}
+		auto activations = std::vector<double>(widest);
+		auto next        = std::vector<double>(widest);
+		for (;;) {
+			const double * values = nullptr;
+			double * results = nullptr;
+			const auto ready = waitFor([&] {
+				return (values = input.readable()) != nullptr || input.isDrained();
+			}, m_stopping);
+			if (!ready) return;
+			if (values == nullptr && (values = input.readable()) == nullptr) {
+				output.close();
+				return;
+			}
+			if (!waitFor([&] { return (results = output.writable()) != nullptr; }, m_stopping)) {
+				return;
+			}
+			// The last layer of the stage writes straight into the
+			// queue of the next stage, the others alternate between
+			// the local buffers.
+			for (auto l = first; l < last; ++l) {
+				auto target = l + 1 == last ? results : activations.data();
+				layers[l].feedForwardBatch(values, 1, target);
+				if (l + 1 < last) {
+					std::swap(activations, next);
+					values = next.data();
+				}
+			}
+			input.release();
+			output.publish();
+		}
+	}
+
+	void Pipeline::push(const double * inputValues, size_t count) {
+		auto& input = *m_queues.front();
+		if (count != input.width()) {
+			throw std::invalid_argument{"the input values don't match the input layer of the pipeline"};
+		}
+		double * slot = nullptr;
+		if (!waitFor([&] { return (slot = input.writable()) != nullptr; }, m_stopping)) return;
+		std::copy(inputValues, inputValues + count, slot);
+		input.publish();
+	}
+
+	void Pipeline::push(const std::vector<double> & inputValues) {
+		push(inputValues.data(), inputValues.size());
+	}
+
+	void Pipeline::close() {
+		m_queues.front()->close();
+	}
+
+	auto Pipeline::pop(double * outputValues, size_t count)
+		-> bool
+	{
+		auto& output = *m_queues.back();
+		assert(count == output.width() &&
+			"outputValues must have the same size as the output layer of the neural net.");
+		const double * slot = nullptr;
+		const auto ready = waitFor([&] {
+			return (slot = output.readable()) != nullptr || output.isDrained();
+		}, m_stopping);
+		if (!ready) return false;
+		if (slot == nullptr && (slot = output.readable()) == nullptr) return false;
+		std::copy(slot, slot + count, outputValues);
+		output.release();
+		return true;
+	}
+
+	auto Pipeline::pop(std::vector<double> & outputValues)
+		-> bool
+	{
+		outputValues.resize(m_queues.back()->width());
+		return pop(outputValues.data(), outputValues.size());
+	}
+
+	auto Pipeline::countStages() const
+		-> size_t
+	{
+		return m_stage_layers.size();
+	}
+
+	auto Pipeline::getStageLayers() const
+		-> const std::vector<size_t> &
+	{
+		return m_stage_layers;
+	}
+}
@@ -0,0 +1,203 @@
+#include <cstring>
+#include <cerrno>
+#include <iomanip>
+#include <utility>
+
+#ifdef __linux__
+	#include <unistd.h>
+	#include <sys/ioctl.h>
+	#include <sys/syscall.h>
+	#include <linux/perf_event.h>
+#endif
+
+#include "neuronet/profiler.hpp"
+
+namespace neuronet {
+	namespace {
+		auto indexOf(PerfEvent event)
+			-> size_t
+		{
+			return static_cast<size_t>(event);
+		}
+
+#ifdef __linux__
+		auto openEvent(uint64_t config, int leader)
+			-> int
+		{
+			auto attributes = perf_event_attr{};
+			std::memset(&attributes, 0, sizeof(attributes));
+			attributes.size           = sizeof(attributes);
+			attributes.type           = PERF_TYPE_HARDWARE;
+			attributes.config         = config;
+			attributes.disabled       = leader == -1 ? 1 : 0;
+			attributes.exclude_kernel = 1;
+			attributes.exclude_hv     = 1;
+			attributes.read_format    =
+				PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, leader, 0));
+		}
+#endif
+	}
+
+	//====================================================================
+	// All counters form one group led by the cycles counter, so that
+	// the kernel schedules them together and one read returns all of
+	// them. Counters that can't be opened are left out of the group.
+	//====================================================================
+	PerfCounters::PerfCounters():
+		m_leader{-1},
+		m_count_open{0}
+	{
+		m_descriptors.fill(-1);
+		m_slots.fill(0);
+#ifdef __linux__
+		const uint64_t configs[count_perf_events] = {
+			PERF_COUNT_HW_CPU_CYCLES,
+			PERF_COUNT_HW_INSTRUCTIONS,
+			PERF_COUNT_HW_CACHE_MISSES,
+			PERF_COUNT_HW_BRANCH_MISSES
+		};
+		for (auto event = size_t{0}; event < count_perf_events; ++event) {
+			const auto descriptor = openEvent(configs[event], m_leader);
+			if (descriptor == -1) {
+				if (event == 0) {
+					m_error = std::string{"perf_event_open failed: "} + std::strerror(errno);
+					return;
+				}
+				continue;
+			}
+			if (event == 0) m_leader = descriptor;
+			m_descriptors[event] = descriptor;
+			m_slots[event]       = m_count_open++;
+		}
+		ioctl(m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+		m_error = "hardware counters are only supported on Linux";
+#endif
+	}
+
+	PerfCounters::~PerfCounters() {
+#ifdef __linux__
+		for (auto descriptor : m_descriptors) {
+			if (descriptor != -1) close(descriptor);
+		}
+#endif
+	}
+
+	bool PerfCounters::available() const {
+		return m_leader != -1;
+	}
+
+	bool PerfCounters::has(PerfEvent event) const {
+		return m_descriptors[indexOf(event)] != -1;
+	}
+
+	auto PerfCounters::getError() const
+		-> const std::string &
+	{
+		return m_error;
+	}
+
+	auto PerfCounters::read() const
+		-> PerfValues
+	{
+		auto values = PerfValues{};
+#ifdef __linux__
+		if (!available()) return values;
+		// Layout of a group read: count, time enabled, time running and
+		// one value per counter of the group.
+		uint64_t buffer[3 + count_perf_events] = {};
+		if (::read(m_leader, buffer, sizeof(buffer)) < static_cast<ssize_t>(3 * sizeof(uint64_t))) {
+			return values;
+		}
+		const auto enabled = buffer[1];
+		const auto running = buffer[2];
+		for (auto event = size_t{0}; event < count_perf_events; ++event) {
+			if (m_descriptors[event] == -1) continue;
+			auto value = buffer[3 + m_slots[event]];
+			if (running > 0 && running < enabled) {
+				value = static_cast<uint64_t>(static_cast<double>(value) * enabled / running);
+			}
+			values[event] = value;
+		}
+#endif
+		return values;
+	}
+
+	auto Profiler::addRegion(std::string name, size_t weights)
+		-> size_t
+	{
+		auto region = ProfileRegion{};
+		region.name    = std::move(name);
+		region.weights = weights;
+		m_regions.push_back(std::move(region));
+		return m_regions.size() - 1;
+	}
+
+	void Profiler::start() {
+		m_start_time   = std::chrono::steady_clock::now();
+		m_start_values = m_counters.read();
+	}
+
+	void Profiler::stop(size_t region) {
+		const auto values = m_counters.read();
+		const auto time   = std::chrono::steady_clock::now();
+		auto& stats = m_regions.at(region);
+		++stats.calls;
+		stats.seconds += std::chrono::duration<double>(time - m_start_time).count();
+		for (auto event = size_t{0}; event < count_perf_events; ++event) {
+			stats.values[event] += values[event] - m_start_values[event];
+		}
+	}
+
+	auto Profiler::getRegions() const
+		-> const std::vector<ProfileRegion> &
+	{
+		return m_regions;
+	}
+
+	auto Profiler::getCounters() const
+		-> const PerfCounters &
+	{
+		return m_counters;
+	}
+
+	void Profiler::report(std::ostream & out) const {
+		const auto flags     = out.flags();
+		const auto precision = out.precision(3);
+		out << std::fixed;
+		if (!m_counters.available()) {
+			out << "hardware counters unavailable (" << m_counters.getError() << "), wall time only\n";
+		}
+		const auto ratio = [](uint64_t numerator, double denominator) {
+			return denominator > 0.0 ? numerator / denominator : 0.0;
+		};
+		for (auto& region : m_regions) {
+			out << std::left << std::setw(28) << region.name << std::right
+			    << " calls " << region.calls
+			    << " ms " << region.seconds * 1000.0;
+			if (m_counters.available()) {
+				const auto& values = region.values;
+				const auto  cycles = static_cast<double>(values[indexOf(PerfEvent::cycles)]);
+				if (m_counters.has(PerfEvent::instructions)) {
+					out << " ipc " << ratio(values[indexOf(PerfEvent::instructions)], cycles);
+				}
+				if (m_counters.has(PerfEvent::llc_misses)) {
+					const auto misses = values[indexOf(PerfEvent::llc_misses)];
+					out << " llc-misses " << misses;
+					if (region.weights > 0) {
+						out << " per-weight "
+						    << ratio(misses, static_cast<double>(region.weights) * region.calls);
+					}
+				}
+				if (m_counters.has(PerfEvent::branch_misses)) {
+					out << " branch-misses " << values[indexOf(PerfEvent::branch_misses)];
+				}
+			}
+			out << '\n';
+		}
+		out.precision(precision);
+		out.flags(flags);
+	}
+}
@@ -0,0 +1,201 @@
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "neuronet/result_cache.hpp"
+#include "neuronet/neural_net.hpp"
+#include "neuronet/neural_layer.hpp"
+
+namespace neuronet {
+	namespace {
+		using Key = std::vector<uint64_t>;
+
+		struct KeyHash {
+			auto operator()(const Key & key) const
+				-> size_t
+			{
+				auto hash = uint64_t{0x9e3779b97f4a7c15};
+				for (auto word : key) {
+					hash ^= word + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+				}
+				// Final mix of splitmix64 so that the low bits used to
+				// pick a shard depend on all bits of the key.
+				hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9;
+				hash = (hash ^ (hash >> 27)) * 0x94d049bb133111eb;
+				return static_cast<size_t>(hash ^ (hash >> 31));
+			}
+		};
+
+		struct Entry {
+			Key                 key;
+			std::vector<double> outputs;
+			size_t              version = 0;
+			bool                used    = false;
+			std::atomic<bool>   referenced{false};
+		};
+	}
+
+	//====================================================================
+	// A part of the cache with its own lock: a fixed ring of entries
+	// swept by the hand of the CLOCK algorithm and an index from keys
+	// to their entries.
+	//====================================================================
+	struct ResultCache::Shard {
+		std::shared_timed_mutex          mutex;
+		std::unordered_map<Key, size_t, KeyHash> index;
+		std::unique_ptr<Entry[]>         entries;
+		size_t                           capacity = 0;
+		size_t                           hand     = 0;
+	};
+
+	auto ResultCacheStats::hitRate() const
+		-> double
+	{
+		const auto lookups = hits + misses;
+		return lookups == 0 ? 0.0 : static_cast<double>(hits) / lookups;
+	}
+
+	ResultCache::ResultCache(const NeuralNet & net, const ResultCacheOptions & options):
+		m_net(net),
+		m_options(options),
+		m_hits{0},
+		m_misses{0},
+		m_stale{0},
+		m_evictions{0}
+	{
+		assert(options.capacity > 0 && options.shards > 0 &&
+			"the result cache needs a capacity and at least one shard.");
+		assert(options.quantization >= 0.0 &&
+			"the quantization must not be negative.");
+		m_options.shards = std::min(options.shards, options.capacity);
+		m_shards.reset(new Shard[m_options.shards]);
+		const auto perShard = (options.capacity + m_options.shards - 1) / m_options.shards;
+		for (auto i = size_t{0}; i < m_options.shards; ++i) {
+			m_shards[i].entries.reset(new Entry[perShard]);
+			m_shards[i].capacity = perShard;
+			m_shards[i].index.reserve(perShard);
+		}
+	}
+
+	ResultCache::~ResultCache() = default;
+
+	auto ResultCache::keyOf(const double * inputValues, std::vector<uint64_t> & key) const
+		-> size_t
+	{
+		const auto count = m_net.getLayers().front().size();
+		key.resize(count);
+		for (auto i = size_t{0}; i < count; ++i) {
+			if (m_options.quantization > 0.0) {
+				key[i] = static_cast<uint64_t>(std::llround(inputValues[i] / m_options.quantization));
+			}
+			else {
+				// +0.0 and -0.0 compute the same outputs.
+				const auto value = inputValues[i] == 0.0 ? 0.0 : inputValues[i];
+				std::memcpy(&key[i], &value, sizeof(value));
+			}
+		}
+		return KeyHash{}(key);
+	}
+
+	void ResultCache::predict(const double * inputValues, size_t count, double * outputValues) {
+		assert(count == m_net.getLayers().front().size() &&
+			"inputValues must have the same size as the input layer of the neural net.");
+		const auto countOutputs = m_net.getLayers().back().size();
+		const auto version      = m_net.getWeightsVersion();
+		thread_local Key key;
+		auto& shard = m_shards[keyOf(inputValues, key) % m_options.shards];
+		{
+			std::shared_lock<std::shared_timed_mutex> lock{shard.mutex};
+			const auto found = shard.index.find(key);
+			if (found != shard.index.end()) {
+				auto& entry = shard.entries[found->second];
+				if (entry.version == version) {
+					std::copy(entry.outputs.begin(), entry.outputs.end(), outputValues);
+					entry.referenced.store(true, std::memory_order_relaxed);
+					m_hits.fetch_add(1, std::memory_order_relaxed);
+					return;
+				}
+				m_stale.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		m_misses.fetch_add(1, std::memory_order_relaxed);
+
+		thread_local std::vector<double> inputs;
+		thread_local std::vector<double> outputs;
+		inputs.assign(inputValues, inputValues + count);
+		m_net.feedForwardBatch(inputs, 1, outputs);
+		std::copy(outputs.begin(), outputs.begin() + countOutputs, outputValues);
+
+		std::unique_lock<std::shared_timed_mutex> lock{shard.mutex};
+		auto slot = size_t{0};
+		const auto found = shard.index.find(key);
+		if (found != shard.index.end()) {
+			slot = found->second;
+		}
+		else {
+			// Sweeps the hand over the entries: free and stale entries
+			// are taken at once, referenced ones get a second chance.
+			for (;;) {
+				slot = shard.hand;
+				shard.hand = (shard.hand + 1) % shard.capacity;
+				auto& entry = shard.entries[slot];
+				if (!entry.used) break;
+				if (entry.version == version && entry.referenced.exchange(false, std::memory_order_relaxed)) {
+					continue;
+				}
+				if (entry.version == version) {
+					m_evictions.fetch_add(1, std::memory_order_relaxed);
+				}
+				shard.index.erase(entry.key);
+				break;
+			}
+			shard.index.emplace(key, slot);
+		}
+		auto& entry = shard.entries[slot];
+		entry.key     = key;
+		entry.outputs.assign(outputs.begin(), outputs.begin() + countOutputs);
+		entry.version = version;
+		entry.used    = true;
+		entry.referenced.store(false, std::memory_order_relaxed);
+	}
+
+	auto ResultCache::predict(const std::vector<double> & inputValues)
+		-> std::vector<double>
+	{
+		auto outputValues = std::vector<double>(m_net.getLayers().back().size());
+		predict(inputValues.data(), inputValues.size(), outputValues.data());
+		return outputValues;
+	}
+
+	auto ResultCache::getStats() const
+		-> ResultCacheStats
+	{
+		auto stats = ResultCacheStats{};
+		stats.hits      = m_hits.load(std::memory_order_relaxed);
+		stats.misses    = m_misses.load(std::memory_order_relaxed);
+		stats.stale     = m_stale.load(std::memory_order_relaxed);
+		stats.evictions = m_evictions.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	void ResultCache::clear() {
+		for (auto i = size_t{0}; i < m_options.shards; ++i) {
+			auto& shard = m_shards[i];
+			std::unique_lock<std::shared_timed_mutex> lock{shard.mutex};
+			shard.index.clear();
+			for (auto slot = size_t{0}; slot < shard.capacity; ++slot) {
+				shard.entries[slot].used = false;
+				shard.entries[slot].referenced.store(false, std::memory_order_relaxed);
+			}
+			shard.hand = 0;
+		}
+		m_hits.store(0, std::memory_order_relaxed);
+		m_misses.store(0, std::memory_order_relaxed);
+		m_stale.store(0, std::memory_order_relaxed);
+		m_evictions.store(0, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,169 @@
+#include <cassert>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#include <immintrin.h>
+	#define NN_SPARSE_KERNELS_X86 1
+#else
+	#define NN_SPARSE_KERNELS_X86 0
+#endif
+
+#include "neuronet/sparse_layer.hpp"
+#include "neuronet/neuron.hpp"
+
+namespace neuronet {
+	namespace {
+		//====================================================================
+		// Computes the weighted sums of the rows [0, rows) of a CSR matrix
+		// with the given inputs.
+		//====================================================================
+		void sparseGemvScalar(
+			size_t rows, const uint32_t * offsets, const uint32_t * columns,
+			const double * weights, const double * in, double * sums
+		) {
+			for (auto row = size_t{0}; row < rows; ++row) {
+				auto k         = offsets[row];
+				const auto end = offsets[row + 1];
+				// Four independent accumulators break up the dependency chain
+				// of the additions.
+				auto sum0 = 0.0, sum1 = 0.0, sum2 = 0.0, sum3 = 0.0;
+				for (; k + 4 <= end; k += 4) {
+					sum0 += weights[k    ] * in[columns[k    ]];
+					sum1 += weights[k + 1] * in[columns[k + 1]];
+					sum2 += weights[k + 2] * in[columns[k + 2]];
+					sum3 += weights[k + 3] * in[columns[k + 3]];
+				}
+				for (; k < end; ++k) {
+					sum0 += weights[k] * in[columns[k]];
+				}
+				sums[row] = (sum0 + sum1) + (sum2 + sum3);
+			}
+		}
+
+#if NN_SPARSE_KERNELS_X86
+		// The masked gather with all lanes set, as the unmasked one makes
+		// some compilers warn about its uninitialized source operand.
+		__attribute__((target("avx2,fma")))
+		auto gather(const double * in, const uint32_t * columns)
+			-> __m256d
+		{
+			const auto indices = _mm_loadu_si128(reinterpret_cast<const __m128i *>(columns));
+			const auto all     = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+			return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), in, indices, all, 8);
+		}
+
+		//====================================================================
+		// Gathers 4 inputs of a row per instruction by their 32 bit columns
+		// and multiplies them with the contiguous weights, 8 per iteration.
+		//====================================================================
+		__attribute__((target("avx2,fma")))
+		void sparseGemvAvx2(
+			size_t rows, const uint32_t * offsets, const uint32_t * columns,
+			const double * weights, const double * in, double * sums
+		) {
+			for (auto row = size_t{0}; row < rows; ++row) {
+				auto k         = size_t{offsets[row]};
+				const auto end = size_t{offsets[row + 1]};
+				auto sum0 = _mm256_setzero_pd();
+				auto sum1 = _mm256_setzero_pd();
+				for (; k + 8 <= end; k += 8) {
+					sum0 = _mm256_fmadd_pd(_mm256_loadu_pd(weights + k),     gather(in, columns + k),     sum0);
+					sum1 = _mm256_fmadd_pd(_mm256_loadu_pd(weights + k + 4), gather(in, columns + k + 4), sum1);
+				}
+				if (k + 4 <= end) {
+					sum0 = _mm256_fmadd_pd(_mm256_loadu_pd(weights + k), gather(in, columns + k), sum0);
+					k += 4;
+				}
+				const auto sum   = _mm256_add_pd(sum0, sum1);
+				const auto pairs = _mm_add_pd(_mm256_castpd256_pd128(sum), _mm256_extractf128_pd(sum, 1));
+				auto total = _mm_cvtsd_f64(_mm_add_sd(pairs, _mm_unpackhi_pd(pairs, pairs)));
+				for (; k < end; ++k) {
+					total += weights[k] * in[columns[k]];
+				}
+				sums[row] = total;
+			}
+		}
+#endif
+
+		bool useAvx2() {
+#if NN_SPARSE_KERNELS_X86
+			static const auto supported =
+				__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+			return supported;
+#else
+			return false;
+#endif
+		}
+	}
+
+	auto describeSparseGemv()
+		-> const char *
+	{
+		return useAvx2() ? "avx2-gather" : "scalar";
+	}
+
+	SparseLayer::SparseLayer(size_t countInputs):
+		m_count_inputs{countInputs},
+		m_row_offsets{0}
+	{}
+
+	void SparseLayer::addNeuron(double biasWeight) {
+		m_row_offsets.push_back(m_row_offsets.back());
+		m_bias.push_back(biasWeight);
+	}
+
+	void SparseLayer::addWeight(uint32_t column, double weight) {
+		assert(!m_bias.empty() &&
+			"a neuron has to be added before weights can be assigned to it.");
+		assert(column < m_count_inputs &&
+			"the column of a weight must index a neuron of the previous layer.");
+		m_columns.push_back(column);
+		m_weights.push_back(weight);
+		++m_row_offsets.back();
+	}
+
+	void SparseLayer::feedForward(const double * in, double * out) const {
+		// The columns are gathered as signed 32 bit indices.
+		assert(m_count_inputs <= size_t{1} << 31 &&
+			"the previous layer is too wide for the gathers of the sparse kernel.");
+#if NN_SPARSE_KERNELS_X86
+		if (useAvx2()) {
+			sparseGemvAvx2(size(), m_row_offsets.data(), m_columns.data(), m_weights.data(), in, out);
+		}
+		else
+#endif
+		{
+			sparseGemvScalar(size(), m_row_offsets.data(), m_columns.data(), m_weights.data(), in, out);
+		}
+		for (auto row = size_t{0}; row < size(); ++row) {
+			out[row] = Neuron::transferFunction(out[row] + m_bias[row]);
+		}
+	}
+
+	auto SparseLayer::size() const
+		-> size_t
+	{
+		return m_bias.size();
+	}
+
+	auto SparseLayer::countInputs() const
+		-> size_t
+	{
+		return m_count_inputs;
+	}
+
+	auto SparseLayer::countNonZeros() const
+		-> size_t
+	{
+		return m_weights.size();
+	}
+
+	auto SparseLayer::memoryUsage() const
+		-> MemoryUsage
+	{
+		auto usage = MemoryUsage{};
+		usage.weights = (m_weights.capacity() + m_bias.capacity()) * sizeof(double);
+		usage.connection_metadata = sizeof(SparseLayer)
+			+ (m_row_offsets.capacity() + m_columns.capacity()) * sizeof(uint32_t);
+		return usage;
+	}
+}
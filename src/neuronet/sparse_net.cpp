@@ -0,0 +1,130 @@
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+
+#include "neuronet/sparse_net.hpp"
+#include "neuronet/neural_net.hpp"
+#include "neuronet/neural_layer.hpp"
+
+namespace neuronet {
+	SparseNet::SparseNet(size_t countInputs, std::vector<SparseLayer> layers):
+		m_count_inputs{countInputs},
+		m_layers{std::move(layers)}
+	{
+		assert(!m_layers.empty() &&
+			"there must be at least one layer besides the input layer.");
+		auto maxSize = m_count_inputs;
+		for (auto& layer : m_layers) {
+			maxSize = std::max(maxSize, layer.size());
+		}
+		m_input.resize(maxSize);
+		m_output.resize(maxSize);
+	}
+
+	void SparseNet::feedForward(const std::vector<double> & inputValues) {
+		assert(inputValues.size() == m_count_inputs &&
+			"inputValues must have the same size as the input layer of this neural network.");
+		std::copy(inputValues.begin(), inputValues.end(), m_input.begin());
+		for (auto& layer : m_layers) {
+			layer.feedForward(m_input.data(), m_output.data());
+			std::swap(m_input, m_output);
+		}
+	}
+
+	auto SparseNet::results() const
+		-> std::vector<double>
+	{
+		// After the last swap the output of the output layer
+		// is kept within the input buffer.
+		return std::vector<double>(
+			m_input.begin(),
+			m_input.begin() + m_layers.back().size());
+	}
+
+	auto SparseNet::getLayers() const
+		-> const std::vector<SparseLayer> &
+	{
+		return m_layers;
+	}
+
+	auto SparseNet::countNonZeros() const
+		-> size_t
+	{
+		auto count = size_t{0};
+		for (auto& layer : m_layers) {
+			count += layer.countNonZeros();
+		}
+		return count;
+	}
+
+	auto SparseNet::memoryUsage() const
+		-> MemoryUsage
+	{
+		auto usage = MemoryUsage{};
+		for (auto& layer : m_layers) {
+			usage += layer.memoryUsage();
+		}
+		usage.activations = (m_input.capacity() + m_output.capacity()) * sizeof(double);
+		usage.connection_metadata += sizeof(SparseNet)
+			+ (m_layers.capacity() - m_layers.size()) * sizeof(SparseLayer);
+		return usage;
+	}
+
+	auto prune(const NeuralNet & net, const PruningOptions & options)
+		-> SparseNet
+	{
+		const auto& layers = net.getLayers();
+		for (auto& layer : layers) {
+			if (layer.isConvolutional()) {
+				throw std::invalid_argument{"convolutional layers can't be pruned."};
+			}
+		}
+		auto sparseLayers  = std::vector<SparseLayer>{};
+		sparseLayers.reserve(layers.size() - 1);
+		auto candidates    = std::vector<std::pair<uint32_t, double>>{};
+		for (auto i = size_t{1}; i < layers.size(); ++i) {
+			const auto& prevLayer = layers[i - 1];
+			auto sparse = SparseLayer{prevLayer.size()};
+			for (auto& neuron : layers[i]) {
+				auto biasWeight = 0.0;
+				candidates.clear();
+				for (auto connection : neuron.getIncConnections()) {
+					const auto& source = connection->getSource();
+					if (source.isBias()) {
+						biasWeight = connection->getWeight();
+						continue;
+					}
+					const auto weight = connection->getWeight();
+					if (options.strategy == PruningOptions::Strategy::threshold
+						&& std::abs(weight) < options.threshold) {
+						continue;
+					}
+					candidates.emplace_back(
+						static_cast<uint32_t>(prevLayer.indexOf(source)), weight);
+				}
+				if (options.strategy == PruningOptions::Strategy::top_k
+					&& candidates.size() > options.keep_per_neuron) {
+					std::nth_element(
+						candidates.begin(),
+						candidates.begin() + options.keep_per_neuron,
+						candidates.end(),
+						[](const std::pair<uint32_t, double> & lhs,
+						   const std::pair<uint32_t, double> & rhs) {
+							return std::abs(lhs.second) > std::abs(rhs.second);
+						});
+					candidates.resize(options.keep_per_neuron);
+				}
+				// Ascending columns keep the gathers of a row in memory order.
+				std::sort(candidates.begin(), candidates.end());
+				sparse.addNeuron(biasWeight);
+				for (auto& candidate : candidates) {
+					sparse.addWeight(candidate.first, candidate.second);
+				}
+			}
+			sparseLayers.push_back(std::move(sparse));
+		}
+		return SparseNet{layers.front().size(), std::move(sparseLayers)};
+	}
+}
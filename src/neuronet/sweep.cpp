@@ -0,0 +1,87 @@
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+
+#include "neuronet/sweep.hpp"
+#include "neuronet/neural_net.hpp"
+#include "neuronet/worker_pool.hpp"
+
+#include "utility/training_data.hpp"
+
+namespace neuronet {
+	namespace {
+		void trainModel(
+			const utility::TrainingData & data, const SweepOptions & options, SweepResult & result
+		) {
+			using clock = std::chrono::steady_clock;
+			const auto start = clock::now();
+			auto& net = *result.net;
+			auto passes = size_t{0};
+			for (auto epoch = size_t{0}; epoch < options.epochs; ++epoch) {
+				for (auto& pass : data) {
+					net.trainStep(pass.getInputValues(), pass.getExpectedValues());
+					++passes;
+					if (options.record_interval > 0 && passes % options.record_interval == 0) {
+						result.error_curve.push_back(net.getRecentAverageError());
+					}
+				}
+				if (options.record_interval == 0) {
+					result.error_curve.push_back(net.getRecentAverageError());
+				}
+			}
+			result.seconds = std::chrono::duration<double>(clock::now() - start).count();
+		}
+	}
+
+	auto runSweep(
+		const utility::TrainingData     & data,
+		const std::vector<SweepConfig>  & configs,
+		const SweepOptions              & options,
+		WorkerPool                      & pool
+	)
+		-> std::vector<SweepResult>
+	{
+		const auto& topology = data.getTopology();
+		auto results = std::vector<SweepResult>(configs.size());
+		for (auto i = size_t{0}; i < configs.size(); ++i) {
+			const auto& config = configs[i];
+			if (config.topology.size() < 2
+				|| config.topology.front() != topology.front()
+				|| config.topology.back()  != topology.back())
+			{
+				throw std::invalid_argument{
+					"the topology of a sweep config does not match the training data."};
+			}
+			results[i].config = config;
+			results[i].net    = std::make_unique<NeuralNet>(config.topology);
+			results[i].net->setTrainingRate(config.training_rate);
+			results[i].net->setMomentum(config.momentum);
+		}
+
+		std::atomic<size_t> next{0};
+		pool.run(pool.size(), [&](size_t) {
+			for (auto i = next++; i < results.size(); i = next++) {
+				trainModel(data, options, results[i]);
+			}
+		});
+		return results;
+	}
+
+	void reportSweep(std::ostream & out, const std::vector<SweepResult> & results) {
+		for (auto& result : results) {
+			out << "topology";
+			for (auto count : result.config.topology) {
+				out << ' ' << count;
+			}
+			out << " eta " << result.config.training_rate
+			    << " alpha " << result.config.momentum
+			    << " error " << (result.error_curve.empty() ? 0.0 : result.error_curve.back())
+			    << " seconds " << result.seconds << '\n'
+			    << "\tcurve";
+			for (auto error : result.error_curve) {
+				out << ' ' << error;
+			}
+			out << '\n';
+		}
+	}
+}
@@ -0,0 +1,272 @@
+#include <cassert>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "neuronet/telemetry.hpp"
+#include "neuronet/neural_net.hpp"
+#include "neuronet/neural_layer.hpp"
+
+namespace neuronet {
+	namespace {
+		auto isSocket(const std::string & target)
+			-> bool
+		{
+			return target.compare(0, 5, "unix:") == 0;
+		}
+
+		auto openTarget(const std::string & target)
+			-> int
+		{
+			if (!isSocket(target)) {
+				const auto fd = ::open(target.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+				if (fd < 0) {
+					throw std::system_error{errno, std::generic_category(), "open " + target};
+				}
+				return fd;
+			}
+			const auto path = target.substr(5);
+			auto address = sockaddr_un{};
+			address.sun_family = AF_UNIX;
+			if (path.size() >= sizeof(address.sun_path)) {
+				throw std::invalid_argument{"the path of the socket is too long."};
+			}
+			std::strcpy(address.sun_path, path.c_str());
+			const auto fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			if (fd < 0) {
+				throw std::system_error{errno, std::generic_category(), "socket"};
+			}
+			if (::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+				const auto error = errno;
+				::close(fd);
+				throw std::system_error{error, std::generic_category(), "connect " + path};
+			}
+			return fd;
+		}
+
+		// Sockets are written with send to get an error instead of
+		// SIGPIPE once the collector went away.
+		void writeAll(int fd, bool socket, const std::string & data) {
+			auto written = size_t{0};
+			while (written < data.size()) {
+				const auto rest  = data.size() - written;
+				const auto count = socket
+					? ::send(fd, data.data() + written, rest, MSG_NOSIGNAL)
+					: ::write(fd, data.data() + written, rest);
+				if (count < 0) {
+					if (errno == EINTR) continue;
+					throw std::system_error{errno, std::generic_category(), "write"};
+				}
+				written += static_cast<size_t>(count);
+			}
+		}
+	}
+
+	//====================================================================
+	// Bounded ring of samples. The trainer fills the slot at tail and
+	// publishes it by advancing tail, the monitor copies the slot at
+	// head and frees it by advancing head. Both positions live on
+	// their own cache line.
+	//====================================================================
+	struct Telemetry::Ring {
+		explicit Ring(size_t capacity):
+			head{0},
+			tail{0},
+			mask(capacity - 1),
+			slots(capacity)
+		{}
+
+		std::atomic<uint64_t> head;
+		char head_padding[64 - sizeof(std::atomic<uint64_t>)];
+		std::atomic<uint64_t> tail;
+		char tail_padding[64 - sizeof(std::atomic<uint64_t>)];
+		uint64_t mask;
+		std::vector<TelemetrySample> slots;
+	};
+
+	auto operator<<(std::ostream & os, const TelemetrySample & sample) -> std::ostream & {
+		const auto isWindow = sample.kind == TelemetrySample::Kind::window;
+		os << "{\"kind\":\"" << (isWindow ? "window" : "pass") << '"'
+		   << ",\"pass\":" << sample.pass
+		   << ",\"seconds\":" << sample.seconds
+		   << ",\"error\":" << sample.error
+		   << ",\"smoothed_error\":" << sample.smoothed_error;
+		if (isWindow) {
+			os << ",\"passes_per_second\":" << sample.passes_per_second
+			   << ",\"weight_norms\":[";
+			for (auto i = size_t{0}; i < sample.weight_norms.size(); ++i) {
+				os << (i == 0 ? "" : ",") << sample.weight_norms[i];
+			}
+			os << ']';
+		}
+		return os << '}';
+	}
+
+	Telemetry::Telemetry(const TelemetryOptions & options):
+		m_options(options),
+		m_dropped{0},
+		m_passes{0},
+		m_window_error{0.0}
+	{
+		if (options.capacity == 0 || options.window == 0) {
+			throw std::invalid_argument{"the telemetry needs a capacity and a window of at least one pass"};
+		}
+		auto capacity = size_t{1};
+		while (capacity < options.capacity) capacity *= 2;
+		m_ring.reset(new Ring{capacity});
+	}
+
+	Telemetry::~Telemetry() = default;
+
+	void Telemetry::push(const TelemetrySample & sample) {
+		const auto tail = m_ring->tail.load(std::memory_order_relaxed);
+		if (tail - m_ring->head.load(std::memory_order_acquire) > m_ring->mask) {
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		auto& slot = m_ring->slots[tail & m_ring->mask];
+		slot.kind              = sample.kind;
+		slot.pass              = sample.pass;
+		slot.seconds           = sample.seconds;
+		slot.error             = sample.error;
+		slot.smoothed_error    = sample.smoothed_error;
+		slot.passes_per_second = sample.passes_per_second;
+		// Reuses the capacity of the slot from its previous lap.
+		slot.weight_norms.assign(sample.weight_norms.begin(), sample.weight_norms.end());
+		m_ring->tail.store(tail + 1, std::memory_order_release);
+	}
+
+	void Telemetry::record(const NeuralNet & net, double error) {
+		const auto now = Clock::now();
+		if (m_passes == 0) {
+			m_start        = now;
+			m_window_start = now;
+		}
+		++m_passes;
+		m_window_error += error;
+		m_sample.pass           = m_passes;
+		m_sample.seconds        = std::chrono::duration<double>(now - m_start).count();
+		m_sample.smoothed_error = net.getRecentAverageError();
+		if (m_options.record_passes) {
+			m_sample.kind              = TelemetrySample::Kind::pass;
+			m_sample.error             = error;
+			m_sample.passes_per_second = 0.0;
+			m_sample.weight_norms.clear();
+			push(m_sample);
+		}
+		if (m_passes % m_options.window != 0) return;
+
+		m_sample.kind  = TelemetrySample::Kind::window;
+		m_sample.error = m_window_error / m_options.window;
+		const auto elapsed = std::chrono::duration<double>(now - m_window_start).count();
+		m_sample.passes_per_second = elapsed > 0.0 ? m_options.window / elapsed : 0.0;
+		m_sample.weight_norms.clear();
+		const auto& layers = net.getLayers();
+		for (auto l = size_t{1}; l < layers.size(); ++l) {
+			auto sum = 0.0;
+			for (auto weight : layers[l].getWeights()) {
+				sum += weight * weight;
+			}
+			m_sample.weight_norms.push_back(std::sqrt(sum));
+		}
+		push(m_sample);
+		m_window_error = 0.0;
+		m_window_start = now;
+	}
+
+	auto Telemetry::drain(std::vector<TelemetrySample> & samples, size_t maxCount)
+		-> size_t
+	{
+		const auto head  = m_ring->head.load(std::memory_order_relaxed);
+		const auto tail  = m_ring->tail.load(std::memory_order_acquire);
+		const auto count = static_cast<size_t>(std::min<uint64_t>(tail - head, maxCount));
+		for (auto i = size_t{0}; i < count; ++i) {
+			samples.push_back(m_ring->slots[(head + i) & m_ring->mask]);
+		}
+		m_ring->head.store(head + count, std::memory_order_release);
+		return count;
+	}
+
+	auto Telemetry::countDropped() const
+		-> uint64_t
+	{
+		return m_dropped.load(std::memory_order_relaxed);
+	}
+
+	auto Telemetry::getOptions() const
+		-> const TelemetryOptions &
+	{
+		return m_options;
+	}
+
+	TelemetryExporter::TelemetryExporter(
+		std::shared_ptr<Telemetry> telemetry,
+		const std::string & target,
+		std::chrono::milliseconds interval
+	):
+		m_telemetry(std::move(telemetry)),
+		m_interval(interval),
+		m_fd(openTarget(target)),
+		m_socket(isSocket(target)),
+		m_stopping{false}
+	{
+		assert(m_telemetry != nullptr &&
+			"the exporter needs a telemetry to drain.");
+		m_thread = std::thread{[this] { run(); }};
+	}
+
+	TelemetryExporter::~TelemetryExporter() {
+		{
+			std::lock_guard<std::mutex> lock{m_mutex};
+			m_stopping = true;
+		}
+		m_wakeup.notify_one();
+		m_thread.join();
+		::close(m_fd);
+	}
+
+	void TelemetryExporter::run() {
+		auto lock = std::unique_lock<std::mutex>{m_mutex};
+		for (;;) {
+			m_wakeup.wait_for(lock, m_interval, [this] { return m_stopping; });
+			const auto stopping = m_stopping;
+			lock.unlock();
+			const auto written = flush();
+			lock.lock();
+			if (stopping || !written) return;
+		}
+	}
+
+	bool TelemetryExporter::flush() {
+		m_samples.clear();
+		m_telemetry->drain(m_samples);
+		if (m_samples.empty()) return true;
+		auto lines = std::ostringstream{};
+		for (auto& sample : m_samples) {
+			lines << sample << '\n';
+		}
+		try {
+			writeAll(m_fd, m_socket, lines.str());
+		}
+		catch (const std::exception & error) {
+			std::lock_guard<std::mutex> lock{m_mutex};
+			m_error = error.what();
+			return false;
+		}
+		return true;
+	}
+
+	auto TelemetryExporter::getError() const
+		-> std::string
+	{
+		std::lock_guard<std::mutex> lock{m_mutex};
+		return m_error;
+	}
+}
@@ -0,0 +1,298 @@
+#include <cassert>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <exception>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "neuronet/worker_pool.hpp"
+
+namespace neuronet {
+	namespace {
+		struct Cpu {
+			int    id;
+			size_t node;
+		};
+
+		// The pool whose task the current thread is running, if any.
+		thread_local const WorkerPool * s_current_pool = nullptr;
+
+		//====================================================================
+		// Parses a cpu list of sysfs, e.g. "0-3,8-11".
+		//====================================================================
+		auto parseCpuList(const std::string & list)
+			-> std::vector<int>
+		{
+			auto ids    = std::vector<int>{};
+			auto stream = std::istringstream{list};
+			auto range  = std::string{};
+			while (std::getline(stream, range, ',')) {
+				if (range.empty()) continue;
+				const auto dash  = range.find('-');
+				const auto first = std::stoi(range.substr(0, dash));
+				const auto last  = dash == std::string::npos
+					? first : std::stoi(range.substr(dash + 1));
+				for (auto id = first; id <= last; ++id) {
+					ids.push_back(id);
+				}
+			}
+			return ids;
+		}
+
+		auto readLine(const std::string & path)
+			-> std::string
+		{
+			auto file = std::ifstream{path};
+			auto line = std::string{};
+			std::getline(file, line);
+			return line;
+		}
+
+		//====================================================================
+		// Returns the cpus this process may run on together with their
+		// NUMA nodes, ordered by node. Without NUMA information in sysfs
+		// all cpus are placed on node 0.
+		//====================================================================
+		auto detectCpus()
+			-> std::vector<Cpu>
+		{
+			auto cpus = std::vector<Cpu>{};
+#ifdef __linux__
+			cpu_set_t allowed;
+			CPU_ZERO(&allowed);
+			if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+				return cpus;
+			}
+			const auto nodes = parseCpuList(readLine("/sys/devices/system/node/online"));
+			for (auto node : nodes) {
+				const auto path = "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+				for (auto id : parseCpuList(readLine(path))) {
+					if (id < CPU_SETSIZE && CPU_ISSET(id, &allowed)) {
+						cpus.push_back(Cpu{id, static_cast<size_t>(node)});
+					}
+				}
+			}
+			if (cpus.empty()) {
+				for (auto id = 0; id < CPU_SETSIZE; ++id) {
+					if (CPU_ISSET(id, &allowed)) {
+						cpus.push_back(Cpu{id, 0});
+					}
+				}
+			}
+#endif
+			return cpus;
+		}
+
+		void pinCurrentThread(int cpu) {
+#ifdef __linux__
+			if (cpu < 0) return;
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(cpu, &set);
+			pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+			(void) cpu;
+#endif
+		}
+	}
+
+	WorkerPool::WorkerPool(const WorkerPoolOptions & options):
+		m_options(options),
+		m_count_nodes{1},
+		m_task{nullptr},
+		m_count_active{0},
+		m_count_running{0},
+		m_generation{0},
+		m_stopped{false}
+	{
+		const auto cpus = detectCpus();
+		auto count = m_options.threads;
+		if (count == 0) {
+			count = !cpus.empty() ? cpus.size() : std::max(1u, std::thread::hardware_concurrency());
+		}
+		m_workers.resize(count, Worker{-1, 0, {}});
+		if (m_options.placement != WorkerPoolOptions::Placement::none && !cpus.empty()) {
+			auto order = std::vector<Cpu>{};
+			if (m_options.placement == WorkerPoolOptions::Placement::compact) {
+				order = cpus;
+			}
+			else {
+				// Take the first unused cpu of every node in turn.
+				auto byNode = std::vector<std::vector<Cpu>>{};
+				for (auto& cpu : cpus) {
+					if (byNode.size() <= cpu.node) byNode.resize(cpu.node + 1);
+					byNode[cpu.node].push_back(cpu);
+				}
+				for (auto round = size_t{0}; order.size() < cpus.size(); ++round) {
+					for (auto& node : byNode) {
+						if (round < node.size()) order.push_back(node[round]);
+					}
+				}
+			}
+			for (auto worker = size_t{0}; worker < count; ++worker) {
+				const auto& cpu = order[worker % order.size()];
+				m_workers[worker].cpu  = cpu.id;
+				m_workers[worker].node = cpu.node;
+				m_count_nodes = std::max(m_count_nodes, cpu.node + 1);
+			}
+		}
+		m_threads.reserve(count);
+		for (auto worker = size_t{0}; worker < count; ++worker) {
+			m_threads.emplace_back([this, worker] { work(worker); });
+		}
+	}
+
+	WorkerPool::~WorkerPool() {
+		{
+			std::lock_guard<std::mutex> lock{m_mutex};
+			m_stopped = true;
+		}
+		m_start.notify_all();
+		for (auto& thread : m_threads) {
+			thread.join();
+		}
+	}
+
+	void WorkerPool::work(size_t worker) {
+		pinCurrentThread(m_workers[worker].cpu);
+		s_current_pool = this;
+		auto seen = size_t{0};
+		for (;;) {
+			std::unique_lock<std::mutex> lock{m_mutex};
+			m_start.wait(lock, [&] { return m_stopped || m_generation != seen; });
+			if (m_stopped) return;
+			seen = m_generation;
+			if (worker >= m_count_active) continue;
+			const auto task = m_task;
+			lock.unlock();
+			(*task)(worker);
+			lock.lock();
+			if (--m_count_running == 0) {
+				m_done.notify_all();
+			}
+		}
+	}
+
+	void WorkerPool::run(size_t count, const std::function<void(size_t)> & task) {
+		assert(count <= size() &&
+			"can't run a task on more workers than there are in the pool.");
+		if (count == 0) return;
+		if (s_current_pool == this) {
+			for (auto worker = size_t{0}; worker < count; ++worker) {
+				task(worker);
+			}
+			return;
+		}
+		// Exceptions of the workers are passed on to the caller.
+		auto error   = std::exception_ptr{};
+		auto guarded = std::function<void(size_t)>{[&](size_t worker) {
+			try {
+				task(worker);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock{m_mutex};
+				if (!error) error = std::current_exception();
+			}
+		}};
+		std::lock_guard<std::mutex> runLock{m_run_mutex};
+		{
+			std::lock_guard<std::mutex> lock{m_mutex};
+			m_task          = &guarded;
+			m_count_active  = count;
+			m_count_running = count;
+			++m_generation;
+		}
+		m_start.notify_all();
+		{
+			std::unique_lock<std::mutex> lock{m_mutex};
+			m_done.wait(lock, [this] { return m_count_running == 0; });
+			m_task = nullptr;
+		}
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	void WorkerPool::parallelFor(
+		size_t total, size_t count,
+		const std::function<void(size_t, size_t, size_t)> & task
+	) {
+		count = std::max(size_t{1}, std::min(count, std::min(total, size())));
+		run(count, [&](size_t worker) {
+			const auto first = total * worker / count;
+			const auto last  = total * (worker + 1) / count;
+			task(first, last, worker);
+		});
+	}
+
+	bool WorkerPool::runsOnWorker() const {
+		return s_current_pool == this;
+	}
+
+	auto WorkerPool::scratch(size_t worker, size_t slot, size_t count)
+		-> double *
+	{
+		auto& buffers = m_workers[worker].scratch;
+		if (buffers.size() <= slot) {
+			buffers.resize(slot + 1);
+		}
+		if (buffers[slot].size() < count) {
+			buffers[slot].resize(count);
+		}
+		return buffers[slot].data();
+	}
+
+	auto WorkerPool::size() const
+		-> size_t
+	{
+		return m_workers.size();
+	}
+
+	auto WorkerPool::countNodes() const
+		-> size_t
+	{
+		return m_count_nodes;
+	}
+
+	auto WorkerPool::getOptions() const
+		-> const WorkerPoolOptions &
+	{
+		return m_options;
+	}
+
+	auto WorkerPool::nodeOf(size_t worker) const
+		-> size_t
+	{
+		return m_workers[worker].node;
+	}
+
+	auto WorkerPool::cpuOf(size_t worker) const
+		-> int
+	{
+		return m_workers[worker].cpu;
+	}
+
+	void WorkerPool::describePlacement(std::ostream & out) const {
+		static const char * placements[] = {"none", "compact", "spread"};
+		out << "worker pool: " << size() << " workers, placement "
+		    << placements[static_cast<int>(m_options.placement)]
+		    << ", " << m_count_nodes << " NUMA node(s)"
+		    << (m_options.replicate_weights ? ", weights replicated per node" : "")
+		    << '\n';
+		for (auto worker = size_t{0}; worker < size(); ++worker) {
+			out << "  worker " << worker << ": ";
+			if (m_workers[worker].cpu < 0) {
+				out << "not pinned\n";
+			}
+			else {
+				out << "cpu " << m_workers[worker].cpu
+				    << ", node " << m_workers[worker].node << '\n';
+			}
+		}
+	}
+}
@@ -0,0 +1,355 @@
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "utility/compressed_training_data.hpp"
+
+namespace utility {
+	namespace {
+		// Codes are read and written with memcpy, the columns
+		// of a block start at multiples of this many bytes.
+		constexpr size_t column_alignment = sizeof(double);
+
+		template <typename Code>
+		void appendCode(std::vector<uint8_t> & bytes, Code code) {
+			const auto offset = bytes.size();
+			bytes.resize(offset + sizeof(Code));
+			std::memcpy(bytes.data() + offset, &code, sizeof(Code));
+		}
+
+		template <typename Code>
+		auto readCode(const uint8_t * bytes, size_t index)
+			-> Code
+		{
+			auto code = Code{};
+			std::memcpy(&code, bytes + index * sizeof(Code), sizeof(Code));
+			return code;
+		}
+
+		auto bitsOf(double value)
+			-> uint64_t
+		{
+			auto bits = uint64_t{0};
+			std::memcpy(&bits, &value, sizeof(bits));
+			return bits;
+		}
+	}
+
+	CompressedTrainingData::CompressedTrainingData(
+		const TrainingData & data,
+		const CompressionOptions & options
+	):
+		m_options(options)
+	{
+		initialize(data.getTopology());
+		const auto stride = m_options.block_passes;
+		auto values = std::vector<double>((m_count_inputs + m_count_expected) * stride);
+		auto count  = size_t{0};
+		for (auto& pass : data) {
+			const auto& inputValues    = pass.getInputValues();
+			const auto& expectedValues = pass.getExpectedValues();
+			for (auto i = size_t{0}; i < m_count_inputs; ++i) {
+				values[i * stride + count] = inputValues[i];
+			}
+			for (auto e = size_t{0}; e < m_count_expected; ++e) {
+				values[(m_count_inputs + e) * stride + count] = expectedValues[e];
+			}
+			if (++count == stride) {
+				encodeBlock(values.data(), count);
+				count = 0;
+			}
+		}
+		if (count > 0) encodeBlock(values.data(), count);
+	}
+
+	CompressedTrainingData::CompressedTrainingData(
+		TrainingStream & stream,
+		const CompressionOptions & options
+	):
+		m_options(options)
+	{
+		initialize(stream.getTopology());
+		const auto stride = m_options.block_passes;
+		auto values         = std::vector<double>((m_count_inputs + m_count_expected) * stride);
+		auto inputValues    = std::vector<double>(m_count_inputs);
+		auto expectedValues = std::vector<double>(m_count_expected);
+		auto count = size_t{0};
+		while (stream.next(inputValues.data(), expectedValues.data())) {
+			for (auto i = size_t{0}; i < m_count_inputs; ++i) {
+				values[i * stride + count] = inputValues[i];
+			}
+			for (auto e = size_t{0}; e < m_count_expected; ++e) {
+				values[(m_count_inputs + e) * stride + count] = expectedValues[e];
+			}
+			if (++count == stride) {
+				encodeBlock(values.data(), count);
+				count = 0;
+			}
+		}
+		if (count > 0) encodeBlock(values.data(), count);
+	}
+
+	void CompressedTrainingData::initialize(const std::vector<uint64_t> & topology) {
+		if (m_options.block_passes == 0) {
+			throw std::invalid_argument{"a block of compressed training data needs at least one pass."};
+		}
+		if (m_options.quantization_bits != 0
+			&& m_options.quantization_bits != 8
+			&& m_options.quantization_bits != 16)
+		{
+			throw std::invalid_argument{"training data can only be quantized to 8 or 16 bits."};
+		}
+		m_topology       = topology;
+		m_count_inputs   = topology.front();
+		m_count_expected = topology.back();
+		m_count_passes   = 0;
+	}
+
+	void CompressedTrainingData::encodeBlock(const double * values, size_t count) {
+		const auto stride = m_options.block_passes;
+		auto block  = Block{};
+		block.first = m_count_passes;
+		block.count = count;
+		block.columns.reserve(m_count_inputs + m_count_expected);
+		auto codes  = std::unordered_map<uint64_t, uint32_t>{};
+		for (auto c = size_t{0}; c < m_count_inputs + m_count_expected; ++c) {
+			const auto column = values + c * stride;
+			// Collects the distinct values as long as they fit into a
+			// dictionary of 16 bit codes.
+			codes.clear();
+			auto minimum = column[0];
+			auto maximum = column[0];
+			auto finite  = true;
+			for (auto pass = size_t{0}; pass < count; ++pass) {
+				finite  = finite && std::isfinite(column[pass]);
+				minimum = std::min(minimum, column[pass]);
+				maximum = std::max(maximum, column[pass]);
+				if (codes.size() <= 65536) {
+					codes.emplace(bitsOf(column[pass]), static_cast<uint32_t>(codes.size()));
+				}
+			}
+			// Picks the smallest exact encoding, then quantizes if that
+			// at least halves the column.
+			const auto distinct = codes.size();
+			auto encoding = Encoding::raw;
+			auto size     = count * sizeof(double);
+			const auto consider = [&](Encoding candidate, size_t candidateSize) {
+				if (candidateSize < size) {
+					encoding = candidate;
+					size     = candidateSize;
+				}
+			};
+			if (distinct == 1)      consider(Encoding::constant, 0);
+			if (distinct <= 256)    consider(Encoding::dictionary8,  count     + distinct * sizeof(double));
+			if (distinct <= 65536)  consider(Encoding::dictionary16, count * 2 + distinct * sizeof(double));
+			const auto quantizedSize = count * m_options.quantization_bits / 8;
+			if (m_options.quantization_bits != 0 && finite && maximum > minimum && 2 * quantizedSize <= size) {
+				encoding = m_options.quantization_bits == 8 ? Encoding::quantized8 : Encoding::quantized16;
+			}
+
+			block.bytes.resize((block.bytes.size() + column_alignment - 1) / column_alignment * column_alignment);
+			auto code = Column{};
+			code.encoding   = encoding;
+			code.offset     = static_cast<uint32_t>(block.bytes.size());
+			code.dictionary = static_cast<uint32_t>(block.dictionary.size());
+			code.base       = column[0];
+			code.scale      = 0.0;
+			switch (encoding) {
+				case Encoding::constant:
+					break;
+				case Encoding::dictionary8:
+				case Encoding::dictionary16:
+					block.dictionary.resize(block.dictionary.size() + distinct);
+					for (auto pass = size_t{0}; pass < count; ++pass) {
+						const auto index = codes.at(bitsOf(column[pass]));
+						block.dictionary[code.dictionary + index] = column[pass];
+						if (encoding == Encoding::dictionary8) appendCode(block.bytes, static_cast<uint8_t>(index));
+						else                                   appendCode(block.bytes, static_cast<uint16_t>(index));
+					}
+					break;
+				case Encoding::quantized8:
+				case Encoding::quantized16: {
+					const auto levels = encoding == Encoding::quantized8 ? 255.0 : 65535.0;
+					code.base  = minimum;
+					code.scale = (maximum - minimum) / levels;
+					for (auto pass = size_t{0}; pass < count; ++pass) {
+						const auto level = std::lround((column[pass] - minimum) / code.scale);
+						if (encoding == Encoding::quantized8) appendCode(block.bytes, static_cast<uint8_t>(level));
+						else                                  appendCode(block.bytes, static_cast<uint16_t>(level));
+					}
+					break;
+				}
+				case Encoding::raw:
+					for (auto pass = size_t{0}; pass < count; ++pass) {
+						appendCode(block.bytes, column[pass]);
+					}
+					break;
+			}
+			block.columns.push_back(code);
+		}
+		block.bytes.shrink_to_fit();
+		block.dictionary.shrink_to_fit();
+		m_count_passes += count;
+		m_blocks.push_back(std::move(block));
+	}
+
+	void CompressedTrainingData::decode(
+		size_t first, size_t count, double * inputValues, double * expectedValues
+	) const {
+		assert(first + count <= m_count_passes &&
+			"there are not that many passes within the training data.");
+		// All blocks but the last hold block_passes passes.
+		auto index = first / m_options.block_passes;
+		while (count > 0) {
+			const auto& block  = m_blocks[index++];
+			const auto  offset = first - block.first;
+			const auto  passes = std::min(count, block.count - offset);
+			decodeBlock(block, offset, passes, inputValues, expectedValues);
+			first          += passes;
+			count          -= passes;
+			inputValues    += passes * m_count_inputs;
+			expectedValues += passes * m_count_expected;
+		}
+	}
+
+	void CompressedTrainingData::decodeBlock(
+		const Block & block, size_t first, size_t count,
+		double * inputValues, double * expectedValues
+	) const {
+		for (auto c = size_t{0}; c < block.columns.size(); ++c) {
+			const auto& column = block.columns[c];
+			const auto  stride = c < m_count_inputs ? m_count_inputs : m_count_expected;
+			const auto  output = c < m_count_inputs ? inputValues + c : expectedValues + (c - m_count_inputs);
+			const auto  bytes  = block.bytes.data() + column.offset;
+			const auto  values = block.dictionary.data() + column.dictionary;
+			// Switches once per column rather than once per value.
+			const auto store = [=](auto valueOf) {
+				for (auto pass = first; pass < first + count; ++pass) {
+					output[(pass - first) * stride] = valueOf(pass);
+				}
+			};
+			switch (column.encoding) {
+				case Encoding::constant:
+					store([&](size_t)      { return column.base; });
+					break;
+				case Encoding::dictionary8:
+					store([&](size_t pass) { return values[readCode<uint8_t>(bytes, pass)]; });
+					break;
+				case Encoding::dictionary16:
+					store([&](size_t pass) { return values[readCode<uint16_t>(bytes, pass)]; });
+					break;
+				case Encoding::quantized8:
+					store([&](size_t pass) { return column.base + readCode<uint8_t>(bytes, pass) * column.scale; });
+					break;
+				case Encoding::quantized16:
+					store([&](size_t pass) { return column.base + readCode<uint16_t>(bytes, pass) * column.scale; });
+					break;
+				case Encoding::raw:
+					store([&](size_t pass) { return readCode<double>(bytes, pass); });
+					break;
+			}
+		}
+	}
+
+	auto CompressedTrainingData::getTopology() const
+		-> const std::vector<uint64_t> &
+	{
+		return m_topology;
+	}
+
+	auto CompressedTrainingData::countPasses() const
+		-> size_t
+	{
+		return m_count_passes;
+	}
+
+	auto CompressedTrainingData::memoryUsage() const
+		-> DatasetMemoryUsage
+	{
+		auto usage = DatasetMemoryUsage{};
+		usage.container_overhead =
+			sizeof(CompressedTrainingData)
+			+ m_topology.capacity() * sizeof(uint64_t)
+			+ m_blocks.capacity()   * sizeof(Block);
+		usage.allocations =
+			(m_topology.capacity() > 0 ? 1 : 0) + (m_blocks.capacity() > 0 ? 1 : 0);
+		for (auto& block : m_blocks) {
+			usage.payload            += block.bytes.size() + block.dictionary.size() * sizeof(double);
+			usage.container_overhead += block.columns.capacity() * sizeof(Column);
+			usage.allocations        += 1
+				+ (block.bytes.capacity()      > 0 ? 1 : 0)
+				+ (block.dictionary.capacity() > 0 ? 1 : 0);
+		}
+		return usage;
+	}
+
+	//===========================================================
+	// Reader Implementation
+	//===========================================================
+	CompressedTrainingData::Reader::Reader(
+		const CompressedTrainingData & data, size_t batchPasses, bool prefetch
+	):
+		m_data(data),
+		m_batch_passes{batchPasses},
+		m_prefetch{prefetch},
+		m_next_pass{0}
+	{
+		assert(batchPasses >= 1 &&
+			"a batch needs at least one pass.");
+		for (auto buffer : {&m_current, &m_pending}) {
+			buffer->inputs.resize(batchPasses * data.m_count_inputs);
+			buffer->expected.resize(batchPasses * data.m_count_expected);
+		}
+		decodeNext();
+	}
+
+	CompressedTrainingData::Reader::~Reader() {
+		// A deferred decoding would run on wait.
+		if (m_prefetch && m_decoding.valid()) m_decoding.wait();
+	}
+
+	void CompressedTrainingData::Reader::decodeNext() {
+		const auto first = m_next_pass;
+		const auto count = std::min(m_batch_passes, m_data.countPasses() - first);
+		m_pending.count = count;
+		m_next_pass    += count;
+		if (count == 0) return;
+		m_decoding = std::async(
+			m_prefetch ? std::launch::async : std::launch::deferred,
+			[this, first, count] {
+				m_data.decode(first, count, m_pending.inputs.data(), m_pending.expected.data());
+			});
+	}
+
+	auto CompressedTrainingData::Reader::next()
+		-> size_t
+	{
+		if (m_decoding.valid()) m_decoding.get();
+		std::swap(m_current, m_pending);
+		m_pending.count = 0;
+		if (m_current.count > 0) decodeNext();
+		return m_current.count;
+	}
+
+	void CompressedTrainingData::Reader::rewind() {
+		if (m_decoding.valid()) m_decoding.get();
+		m_current.count = 0;
+		m_next_pass     = 0;
+		decodeNext();
+	}
+
+	auto CompressedTrainingData::Reader::getInputValues() const
+		-> const double *
+	{
+		return m_current.inputs.data();
+	}
+
+	auto CompressedTrainingData::Reader::getExpectedValues() const
+		-> const double *
+	{
+		return m_current.expected.data();
+	}
+}
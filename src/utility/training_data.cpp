@@ -9,6 +9,12 @@
 #include "utility/training_data.hpp"
 
 namespace utility {
+	auto DatasetMemoryUsage::total() const
+		-> size_t
+	{
+		return payload + container_overhead;
+	}
+
 	//===========================================================
 	// TrainingPass Implementation
 	//===========================================================
@@ -32,6 +38,19 @@ namespace utility {
 		return m_expected;
 	}
 
+	auto TrainingPass::memoryUsage() const
+		-> DatasetMemoryUsage
+	{
+		auto usage = DatasetMemoryUsage{};
+		usage.payload            = (m_input.size() + m_expected.size()) * sizeof(double);
+		usage.container_overhead =
+			(m_input.capacity()    - m_input.size()
+			+ m_expected.capacity() - m_expected.size()) * sizeof(double);
+		usage.allocations        =
+			(m_input.capacity() > 0 ? 1 : 0) + (m_expected.capacity() > 0 ? 1 : 0);
+		return usage;
+	}
+
 	//===========================================================
 	// TrainingData Implementation
 	//===========================================================
@@ -117,6 +136,25 @@ namespace utility {
 		return m_topology;
 	}
 
+	auto TrainingData::memoryUsage() const
+		-> DatasetMemoryUsage
+	{
+		auto usage = DatasetMemoryUsage{};
+		usage.container_overhead =
+			sizeof(TrainingData)
+			+ m_topology.capacity() * sizeof(uint64_t)
+			+ m_passes.capacity()   * sizeof(TrainingPass);
+		usage.allocations =
+			(m_topology.capacity() > 0 ? 1 : 0) + (m_passes.capacity() > 0 ? 1 : 0);
+		for (auto& pass : m_passes) {
+			const auto passUsage = pass.memoryUsage();
+			usage.payload            += passUsage.payload;
+			usage.container_overhead += passUsage.container_overhead;
+			usage.allocations        += passUsage.allocations;
+		}
+		return usage;
+	}
+
 	//=========================================================================
 	// Iterator Wrappers
 	//=======================================================================
@@ -0,0 +1,115 @@
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "utility/training_stream.hpp"
+
+namespace utility {
+	namespace {
+		auto skipSpaces(const char * text)
+			-> const char *
+		{
+			while (std::isspace(static_cast<unsigned char>(*text))) ++text;
+			return text;
+		}
+	}
+
+	TrainingStream::TrainingStream(std::istream & input):
+		m_input(input)
+	{
+		using namespace std::string_literals;
+		if (!nextLine()) {
+			throw std::invalid_argument{"the training stream ended before its topology."};
+		}
+		auto text = skipSpaces(m_line.c_str());
+		if (std::strncmp(text, "topology", 8) != 0) {
+			throw std::invalid_argument{
+				"expected keyword 'topology' at line "s + std::to_string(m_line_number)
+				+ " of the training stream."};
+		}
+		text = skipSpaces(text + 8);
+		while (*text != '\0') {
+			auto end   = static_cast<char *>(nullptr);
+			auto count = std::strtoull(text, &end, 10);
+			if (end == text || count == 0) {
+				throw std::invalid_argument{
+					"invalid layer size at line "s + std::to_string(m_line_number)
+					+ " of the training stream."};
+			}
+			m_topology.push_back(count);
+			text = skipSpaces(end);
+		}
+		if (m_topology.size() < 2) {
+			throw std::invalid_argument{"the topology of the training stream needs at least two layers."};
+		}
+	}
+
+	auto TrainingStream::getTopology() const
+		-> const std::vector<uint64_t> &
+	{
+		return m_topology;
+	}
+
+	auto TrainingStream::countPasses() const
+		-> size_t
+	{
+		return m_count_passes;
+	}
+
+	bool TrainingStream::nextLine() {
+		while (std::getline(m_input, m_line)) {
+			++m_line_number;
+			if (*skipSpaces(m_line.c_str()) != '\0') return true;
+		}
+		return false;
+	}
+
+	bool TrainingStream::next(double * inputValues, double * expectedValues) {
+		using namespace std::string_literals;
+		if (!nextLine()) return false;
+		parseValues("input", m_topology.front(), inputValues);
+		if (!nextLine()) {
+			throw std::invalid_argument{
+				"the training stream ended after the input values at line "s
+				+ std::to_string(m_line_number) + "."};
+		}
+		parseValues("expected", m_topology.back(), expectedValues);
+		++m_count_passes;
+		return true;
+	}
+
+	//====================================================================
+	// Parses a line of the given keyword followed by exactly count
+	// values. The values are parsed in place with strtod so that
+	// reading a pass does not allocate.
+	//====================================================================
+	void TrainingStream::parseValues(const char * keyword, size_t count, double * values) {
+		using namespace std::string_literals;
+		const auto length = std::strlen(keyword);
+		auto text = skipSpaces(m_line.c_str());
+		if (std::strncmp(text, keyword, length) != 0
+			|| !std::isspace(static_cast<unsigned char>(text[length])))
+		{
+			throw std::invalid_argument{
+				"expected keyword '"s + keyword + "' at line "s
+				+ std::to_string(m_line_number) + " of the training stream."};
+		}
+		text += length;
+		for (auto i = size_t{0}; i < count; ++i) {
+			auto end = static_cast<char *>(nullptr);
+			values[i] = std::strtod(text, &end);
+			if (end == text) {
+				throw std::invalid_argument{
+					"expected "s + std::to_string(count) + " valid values after '"s + keyword
+					+ "' at line "s + std::to_string(m_line_number) + " of the training stream."};
+			}
+			text = end;
+		}
+		if (*skipSpaces(text) != '\0') {
+			throw std::invalid_argument{
+				"more than "s + std::to_string(count) + " values after '"s + keyword
+				+ "' at line "s + std::to_string(m_line_number) + " of the training stream."};
+		}
+	}
+}